@@ -19,6 +19,8 @@
 #include <stb_image_resize.h>
 #include <gui/gui.h>
 #include <signal_path/signal_path.h>
+#include <dsp/scheduler.h>
+#include <dsp/fft/plan_cache.h>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -126,6 +128,15 @@ int sdrpp_main(int argc, char* argv[]) {
     defConfig["fftRate"] = 20;
     defConfig["fftSize"] = 65536;
     defConfig["fftWindow"] = 2;
+    defConfig["fftPlanRigor"] = 0;
+    defConfig["fftAveraging"] = 0;
+    defConfig["fftOverlap"] = 50;
+    defConfig["fftZoomMode"] = 0;
+    defConfig["waterfallHistoryFormat"] = 0;
+    defConfig["waterfallHistoryDecimation"] = 1;
+    defConfig["waterfallHistoryMips"] = false;
+    defConfig["spectrumLogRecord"] = false;
+    defConfig["spectrumLogFolder"] = "%ROOT%/recordings";
     defConfig["frequency"] = 100000000.0;
     defConfig["fullWaterfallUpdate"] = false;
     defConfig["max"] = 0.0;
@@ -188,6 +199,8 @@ int sdrpp_main(int argc, char* argv[]) {
     defConfig["showWaterfall"] = true;
     defConfig["source"] = "";
     defConfig["decimationPower"] = 0;
+    defConfig["channelizerWidth"] = 0.0;
+    defConfig["batchedXlation"] = false;
     defConfig["iqCorrection"] = false;
     defConfig["invertIQ"] = false;
 
@@ -273,6 +286,18 @@ int sdrpp_main(int argc, char* argv[]) {
 
     core::configManager.release(true);
 
+#ifdef SDRPP_DSP_SCHEDULER
+    // Run DSP blocks created from now on on a pool of worker threads. It's never freed since blocks get stopped during shutdown
+    dsp::Scheduler* dspScheduler = new dsp::Scheduler();
+    dsp::setDefaultScheduler(dspScheduler);
+    flog::info("Using DSP scheduler with {0} workers", dspScheduler->getWorkerCount());
+#endif
+
+    // Reuse the FFT plans measured by previous runs
+    if (dsp::fft::planCache().setWisdomPath(root + "/fftw_wisdom.dat")) {
+        flog::info("Loaded FFTW wisdom");
+    }
+
     if (serverMode) { return server::main(); }
 
     core::configManager.acquire();
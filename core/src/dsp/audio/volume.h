@@ -39,6 +39,8 @@ namespace dsp::audio {
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
         virtual int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -0,0 +1,107 @@
+#pragma once
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../loop/agc.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the AGC against the sample by sample one it replaced, which scanned the rest of the buffer every time
+    // the output clipped. Its worst case is impulsive noise, pulses far above a weak signal, with a decay fast enough
+    // for the gain to recover between them so that every pulse clips.
+    class AGCTester {
+    public:
+        // Returns the MS/s of the AGC with the given look ahead, -1 for the old AGC
+        double benchmark(int lookAhead, int durationMs, int bufferSize) {
+            std::vector<float> in = genImpulsive(bufferSize);
+            std::vector<float> out(bufferSize);
+            loop::AGC<float> agc;
+            agc.init(NULL, 1.0, ATTACK, DECAY, 10e6, 10.0, INFINITY);
+            if (lookAhead >= 0) { agc.setLookAhead(lookAhead); }
+            float amp = 0.0f;
+
+            return measureRate(durationMs, [&]() {
+                if (lookAhead >= 0) {
+                    agc.process(bufferSize, in.data(), out.data());
+                }
+                else {
+                    processOld(in.data(), out.data(), bufferSize, amp);
+                }
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        // Largest difference between the outputs of the old AGC and of the new one without look ahead
+        double maxDifference(int bufferSize, int buffers) {
+            std::vector<float> in = genImpulsive(bufferSize);
+            std::vector<float> oldOut(bufferSize);
+            std::vector<float> newOut(bufferSize);
+            loop::AGC<float> agc;
+            agc.init(NULL, 1.0, ATTACK, DECAY, 10e6, 10.0, INFINITY);
+            float amp = 0.0f;
+
+            double maxDiff = 0.0;
+            for (int b = 0; b < buffers; b++) {
+                processOld(in.data(), oldOut.data(), bufferSize, amp);
+                agc.process(bufferSize, in.data(), newOut.data());
+                for (int i = 0; i < bufferSize; i++) {
+                    maxDiff = std::max<double>(maxDiff, fabs(oldOut[i] - newOut[i]) / std::max<double>(fabs(oldOut[i]), 1e-6));
+                }
+            }
+            return maxDiff;
+        }
+
+        void compare(int durationMs, int bufferSize, int maxLookAhead) {
+            double base = benchmark(-1, durationMs, bufferSize);
+            printf("[AGCTester] %d samples, old: %lf MS/s\n", bufferSize, base);
+            double speed = benchmark(0, durationMs, bufferSize);
+            printf("[AGCTester] %d samples, no delay: %lf MS/s (x%lf), max relative difference %le\n", bufferSize, speed, speed / base, maxDifference(bufferSize, 16));
+            for (int l = 16; l <= maxLookAhead; l *= 4) {
+                speed = benchmark(l, durationMs, bufferSize);
+                printf("[AGCTester] %d samples, %d samples ahead: %lf MS/s (x%lf)\n", bufferSize, l, speed, speed / base);
+            }
+        }
+
+    private:
+        static constexpr float ATTACK = 50.0f / 48000.0f;
+        static constexpr float DECAY = 0.05f;
+
+        // The AGC before it worked on whole buffers
+        void processOld(const float* in, float* out, int count, float& amp) {
+            const float setPoint = 1.0f;
+            const float attack = ATTACK;
+            const float decay = DECAY;
+            const float maxGain = 10e6;
+            const float maxOutputAmp = 10.0f;
+            for (int i = 0; i < count; i++) {
+                float inAmp = fabsf(in[i]);
+                float gain;
+                if (inAmp != 0.0f) {
+                    amp = (inAmp > amp) ? ((amp * (1.0f - attack)) + (inAmp * attack)) : ((amp * (1.0f - decay)) + (inAmp * decay));
+                    gain = std::min<float>(setPoint / amp, maxGain);
+                }
+                else {
+                    gain = 1.0f;
+                }
+                if (inAmp * gain > maxOutputAmp) {
+                    float maxAmp = 0;
+                    for (int j = i; j < count; j++) { maxAmp = std::max<float>(maxAmp, fabsf(in[j])); }
+                    amp = maxAmp;
+                    gain = std::min<float>(setPoint / amp, maxGain);
+                }
+                out[i] = in[i] * gain;
+            }
+        }
+
+        // Weak noise with pulses a thousand times stronger every few hundred samples
+        static std::vector<float> genImpulsive(int count) {
+            std::vector<float> out(count);
+            for (int i = 0; i < count; i++) {
+                out[i] = 0.001f * ((float)rand() / (float)RAND_MAX - 0.5f);
+                if (rand() % 300 == 0) { out[i] = (rand() % 2) ? 1.0f : -1.0f; }
+            }
+            return out;
+        }
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include "../math/bin_zoom.h"
+#include "../worker_group.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the display zoom of a spectrum, per line and for the redraw of a whole waterfall history
+    class BinZoomTester {
+    public:
+        // Returns the lines per second zoomed from inSize bins to outSize points
+        double benchmark(int inSize, int outSize, math::ZoomMode mode, int durationMs) {
+            float* in = genSpectrum(inSize);
+            float* out = new float[outSize];
+            math::BinZoom zoom;
+            zoom.configure(0, inSize, inSize, outSize);
+
+            double rate = measureRate(durationMs, [&]() {
+                zoom.process(in, out, mode);
+                return 1;
+            });
+
+            delete[] in;
+            delete[] out;
+            return rate;
+        }
+
+        // Same as benchmark() with the scalar zoom the waterfall used to have
+        double benchmarkScalar(int inSize, int outSize, int durationMs) {
+            float* in = genSpectrum(inSize);
+            float* out = new float[outSize];
+
+            double rate = measureRate(durationMs, [&]() {
+                float factor = (float)inSize / (float)outSize;
+                float sFactor = ceilf(factor);
+                float id = 0;
+                for (int i = 0; i < outSize; i++) {
+                    float maxVal = -INFINITY;
+                    int sId = (int)id;
+                    float uFactor = (sId + sFactor > inSize) ? sFactor - ((sId + sFactor) - inSize) : sFactor;
+                    for (int j = 0; j < uFactor; j++) {
+                        if (in[sId + j] > maxVal) { maxVal = in[sId + j]; }
+                    }
+                    out[i] = maxVal;
+                    id += factor;
+                }
+                return 1;
+            });
+
+            delete[] in;
+            delete[] out;
+            return rate;
+        }
+
+        // Returns the redraws per second of a history of the given number of lines split between threads
+        double benchmarkHistory(int inSize, int outSize, int lineCount, int threads, int durationMs) {
+            float* in = genSpectrum(inSize);
+            float* out = new float[outSize * threads];
+            math::BinZoom zoom;
+            zoom.configure(0, inSize, inSize, outSize);
+            WorkerGroup workers;
+            workers.setThreadCount(threads);
+
+            double rate = measureRate(durationMs, [&]() {
+                workers.run([&](int part) {
+                    for (int i = (part * lineCount) / threads; i < ((part + 1) * lineCount) / threads; i++) {
+                        zoom.process(in, &out[part * outSize]);
+                    }
+                });
+                return 1;
+            });
+
+            delete[] in;
+            delete[] out;
+            return rate;
+        }
+
+        // Prints the results for a spectrum shown on a display of the given width, returns the per line speedup
+        double compare(int inSize, int outSize, int lineCount, int maxThreads, int durationMs) {
+            double scalar = benchmarkScalar(inSize, outSize, durationMs);
+            double simd = benchmark(inSize, outSize, math::ZOOM_MAX, durationMs);
+            printf("[BinZoomTester] %d to %d: scalar %lf lines/s, kernel %lf lines/s (x%lf)\n", inSize, outSize, scalar, simd, simd / scalar);
+            double base = benchmarkHistory(inSize, outSize, lineCount, 1, durationMs);
+            printf("[BinZoomTester] %d lines history, 1 thread: %lf redraws/s\n", lineCount, base);
+            for (int t = 2; t <= maxThreads; t++) {
+                double rate = benchmarkHistory(inSize, outSize, lineCount, t, durationMs);
+                printf("[BinZoomTester] %d lines history, %d threads: %lf redraws/s (x%lf)\n", lineCount, t, rate, rate / base);
+            }
+            return simd / scalar;
+        }
+
+    private:
+        static float* genSpectrum(int size) {
+            float* in = new float[size];
+            for (int i = 0; i < size; i++) { in[i] = -100.0f + 60.0f * (float)rand() / (float)RAND_MAX; }
+            return in;
+        }
+    };
+}
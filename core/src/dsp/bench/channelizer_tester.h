@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include "speed_tester.h"
+#include "../channel/channelized_vfo.h"
+#include "../sink/null_sink.h"
+
+namespace dsp::bench {
+    // Measures the input throughput of a number of narrowband VFOs (like NFM channels) fed by the IQ splitter
+    // when each VFO processes the full rate IQ and when they read the channels of a filter bank channelizer.
+    class ChannelizerTester {
+    public:
+        double benchmark(int channelCount, int vfoCount, int durationMs, int bufferSize, double samplerate = 10e6) {
+            // Build the splitter and channelizer, 0 channels means no channelizer
+            stream<complex_t> input;
+            routing::Splitter<complex_t> split(&input);
+            stream<complex_t> chanIn;
+            channel::PFBChannelizer* chan = NULL;
+            if (channelCount) {
+                chan = new channel::PFBChannelizer(&chanIn, channelCount, samplerate);
+                split.bindStream(&chanIn, true);
+            }
+
+            // Spread the VFOs on channel centers, the speed tester reads the last one and null sinks the others
+            double spacing = samplerate / (double)(channelCount ? channelCount : 512);
+            std::vector<stream<complex_t>*> inputs;
+            std::vector<channel::ChannelizedVFO*> vfos;
+            std::vector<sink::Null<complex_t>*> sinks;
+            for (int i = 0; i < vfoCount; i++) {
+                double offset = (double)((i % 2) ? (i / 2 + 1) : -(i / 2 + 1)) * spacing;
+                stream<complex_t>* in = new stream<complex_t>;
+                channel::ChannelizedVFO* vfo = new channel::ChannelizedVFO(in, &split, chan, samplerate, 50e3, 12.5e3, offset);
+                inputs.push_back(in);
+                vfos.push_back(vfo);
+                if (i < vfoCount - 1) { sinks.push_back(new sink::Null<complex_t>(&vfo->out, NULL, NULL)); }
+            }
+
+            // Run the test
+            for (auto& sink : sinks) { sink->start(); }
+            for (auto& vfo : vfos) { vfo->start(); }
+            if (chan) { chan->start(); }
+            split.start();
+            SpeedTester<complex_t, complex_t> tester(&input, &vfos.back()->out);
+            double rate = tester.benchmark(durationMs, bufferSize);
+            split.stop();
+            if (chan) { chan->stop(); }
+            for (auto& vfo : vfos) { vfo->stop(); }
+            for (auto& sink : sinks) { sink->stop(); }
+
+            // Destroy everything, the VFOs unbind their input on deletion
+            for (auto& sink : sinks) { delete sink; }
+            for (auto& vfo : vfos) { delete vfo; }
+            for (auto& in : inputs) { delete in; }
+            if (chan) { delete chan; }
+
+            return rate;
+        }
+
+        // Prints the throughput with and without the channelizer for power of two VFO counts up to maxVFOs, returns the last speedup
+        double compare(int channelCount, int maxVFOs, int durationMs, int bufferSize, double samplerate = 10e6) {
+            double speedup = 1.0;
+            for (int n = 1; n <= maxVFOs; n *= 2) {
+                double directRate = benchmark(0, n, durationMs, bufferSize, samplerate);
+                double chanRate = benchmark(channelCount, n, durationMs, bufferSize, samplerate);
+                speedup = chanRate / directRate;
+                printf("[ChannelizerTester] %d VFOs, %d channels: direct %lf S/s, channelized %lf S/s (x%lf)\n", n, channelCount, directRate, chanRate, speedup);
+            }
+            return speedup;
+        }
+    };
+}
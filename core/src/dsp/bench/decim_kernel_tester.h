@@ -0,0 +1,59 @@
+#pragma once
+#include <set>
+#include <stdio.h>
+#include "../filter/decimating_fir.h"
+#include "../taps/from_array.h"
+#include "../multirate/decim/kernels.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the throughput of every decimation plan stage with the specialized kernel and with the generic volk convolution
+    template <class T>
+    class DecimKernelTester {
+    public:
+        double benchmark(const multirate::decim::stage& stage, bool kernel, int durationMs, int bufferSize) {
+            tap<float> taps = taps::fromArray<float>(stage.tapcount, stage.taps);
+            filter::DecimatingFIR<T, float> fir(NULL, taps, stage.decimation);
+            fir.setKernel(kernel ? multirate::decim::getKernel<T>(stage.tapcount) : NULL);
+
+            // Fill the input with noise
+            T* in = buffer::alloc<T>(bufferSize);
+            T* out = buffer::alloc<T>(bufferSize);
+            float* raw = (float*)in;
+            for (int i = 0; i < bufferSize * (sizeof(T) / sizeof(float)); i++) {
+                raw[i] = (2.0f * (float)rand() / (float)RAND_MAX) - 1.0f;
+            }
+
+            // Run the filter on the same buffer until the time is up
+            double rate = measureRate(durationMs, [&]() {
+                fir.process(bufferSize, in, out);
+                return bufferSize;
+            });
+
+            buffer::free(in);
+            buffer::free(out);
+            taps::free(taps);
+
+            return rate;
+        }
+
+        // Prints the input throughput of both paths for each distinct stage of the plans, returns the lowest speedup
+        double compare(int durationMs, int bufferSize) {
+            double minSpeedup = 1e9;
+            std::set<const float*> done;
+            for (int p = 0; p < multirate::decim::plans_len; p++) {
+                const multirate::decim::plan& plan = multirate::decim::plans[p];
+                for (int s = 0; s < plan.stageCount; s++) {
+                    const multirate::decim::stage& stage = plan.stages[s];
+                    if (!done.insert(stage.taps).second) { continue; }
+                    double volkRate = benchmark(stage, false, durationMs, bufferSize);
+                    double kernelRate = benchmark(stage, true, durationMs, bufferSize);
+                    double speedup = kernelRate / volkRate;
+                    minSpeedup = std::min<double>(minSpeedup, speedup);
+                    printf("[DecimKernelTester] %d taps, decimation %d: volk %lf S/s, kernel %lf S/s (x%lf)\n", stage.tapcount, stage.decimation, volkRate, kernelRate, speedup);
+                }
+            }
+            return minSpeedup;
+        }
+    };
+}
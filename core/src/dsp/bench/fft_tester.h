@@ -0,0 +1,64 @@
+#pragma once
+#include <stdio.h>
+#include "../fft/spectrum_engine.h"
+#include "../window/nuttall.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures how many spectrum frames per second the spectrum engine can compute for a given FFT size, planner rigor,
+    // thread count and batch size. A frame is the same work as in the IQ frontend: windowing, FFT and conversion to power.
+    class FFTTester {
+    public:
+        double benchmark(int size, fft::PlanRigor rigor, int durationMs, int threads = 1, int batchSize = 1) {
+            // Planning is not part of the measurement
+            WorkerGroup workers;
+            workers.setThreadCount(threads);
+            fft::SpectrumEngine engine;
+            engine.setWorkers(&workers);
+            engine.configure(size, size, batchSize, rigor);
+            engine.finishPlanning();
+
+            complex_t* frame = buffer::alloc<complex_t>(size);
+            float* power = buffer::alloc<float>(size);
+            float* window = engine.getWindow();
+            for (int i = 0; i < size; i++) {
+                frame[i] = { (float)(i % 7) - 3.0f, (float)(i % 5) - 2.0f };
+                window[i] = window::nuttall(i, size) * ((i % 2) ? -1.0f : 1.0f);
+            }
+
+            double fps = measureRate(durationMs, [&]() {
+                if (!engine.push(frame)) { return 0; }
+                engine.transform();
+                for (int i = 0; i < batchSize; i++) { engine.power(i, power); }
+                return batchSize;
+            });
+
+            buffer::free(frame);
+            buffer::free(power);
+
+            return fps;
+        }
+
+        // Prints the frame rate for every power of two size from minSize to maxSize
+        void compare(int minSize, int maxSize, fft::PlanRigor rigor, int durationMs) {
+            for (int size = minSize; size <= maxSize; size <<= 1) {
+                double fps = benchmark(size, rigor, durationMs);
+                printf("[FFTTester] size %d: %lf frames/s (%lf MS/s)\n", size, fps, fps * (double)size / 1e6);
+            }
+        }
+
+        // Prints the frame rate for thread counts from 1 to maxThreads with one frame per thread in a batch,
+        // returns the best speedup over a single thread
+        double compareThreads(int size, int maxThreads, fft::PlanRigor rigor, int durationMs) {
+            double baseFps = benchmark(size, rigor, durationMs);
+            printf("[FFTTester] size %d, 1 thread: %lf frames/s\n", size, baseFps);
+            double speedup = 1.0;
+            for (int t = 2; t <= maxThreads; t++) {
+                double fps = benchmark(size, rigor, durationMs, t, t);
+                speedup = std::max<double>(speedup, fps / baseFps);
+                printf("[FFTTester] size %d, %d threads: %lf frames/s (x%lf)\n", size, t, fps, fps / baseFps);
+            }
+            return speedup;
+        }
+    };
+}
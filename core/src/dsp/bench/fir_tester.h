@@ -0,0 +1,54 @@
+#pragma once
+#include <limits.h>
+#include <stdio.h>
+#include "../filter/fir.h"
+#include "../taps/windowed_sinc.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the throughput of the FIR filter in direct form and with FFT convolution for a given tap count.
+    // Used to pick FIR_FFT_MIN_TAPS.
+    template <class D, class T>
+    class FIRTester {
+    public:
+        double benchmark(bool fft, int tapCount, int durationMs, int bufferSize) {
+            // Low pass with the requested number of taps
+            tap<T> taps = dsp::taps::windowedSinc<T>(tapCount, 0.1 * DB_M_PI, window::nuttall);
+
+            filter::FIR<D, T> fir(NULL, taps);
+            fir.setFFTMinTaps(fft ? 0 : INT_MAX);
+
+            // Fill the input with noise
+            D* in = buffer::alloc<D>(bufferSize);
+            D* out = buffer::alloc<D>(bufferSize);
+            float* raw = (float*)in;
+            for (int i = 0; i < bufferSize * (sizeof(D) / sizeof(float)); i++) {
+                raw[i] = (2.0f * (float)rand() / (float)RAND_MAX) - 1.0f;
+            }
+
+            // Run the filter on the same buffer until the time is up
+            double rate = measureRate(durationMs, [&]() {
+                fir.process(bufferSize, in, out);
+                return bufferSize;
+            });
+
+            buffer::free(in);
+            buffer::free(out);
+            dsp::taps::free(taps);
+
+            return rate;
+        }
+
+        // Prints the throughput of both forms for tap counts from minTaps to maxTaps (doubling), returns the last speedup
+        double compare(int minTaps, int maxTaps, int durationMs, int bufferSize) {
+            double speedup = 1.0;
+            for (int tc = minTaps; tc <= maxTaps; tc *= 2) {
+                double directRate = benchmark(false, tc, durationMs, bufferSize);
+                double fftRate = benchmark(true, tc, durationMs, bufferSize);
+                speedup = fftRate / directRate;
+                printf("[FIRTester] %d taps, %d samples/buffer: direct %lf S/s, fft %lf S/s (x%lf)\n", tc, bufferSize, directRate, fftRate, speedup);
+            }
+            return speedup;
+        }
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "speed_tester.h"
+#include "../chain.h"
+#include "../multirate/power_decimator.h"
+#include "../correction/dc_blocker.h"
+#include "../math/conjugate.h"
+
+namespace dsp::bench {
+    // Measures the throughput of the IQ pre-processing chain (decim -> DC block -> conjugate)
+    // when run with one thread per block and when fused on a single thread.
+    class FusedChainTester {
+    public:
+        FusedChainTester() {}
+
+        FusedChainTester(int decimRatio) { init(decimRatio); }
+
+        void init(int decimRatio) {
+            _decimRatio = decimRatio;
+            _init = true;
+        }
+
+        double benchmark(bool fused, int durationMs, int bufferSize) {
+            assert(_init);
+
+            // Build the chain the same way the IQ frontend does
+            stream<complex_t> input;
+            multirate::PowerDecimator<complex_t> decim(NULL, _decimRatio);
+            correction::DCBlocker<complex_t> dcBlock(NULL, 50.0 / 1000000.0);
+            math::Conjugate conjugate(NULL);
+            chain<complex_t> preproc(&input);
+            preproc.addBlock(&decim, _decimRatio > 1);
+            preproc.addBlock(&dcBlock, true);
+            preproc.addBlock(&conjugate, true);
+            preproc.setFused(fused, [](stream<complex_t>* out) {});
+
+            // Run test
+            preproc.start();
+            SpeedTester<complex_t, complex_t> tester(&input, preproc.out);
+            double rate = tester.benchmark(durationMs, bufferSize);
+            preproc.stop();
+
+            return rate;
+        }
+
+        // Returns the speedup of the fused chain over the threaded one
+        double compare(int durationMs, int bufferSize) {
+            double threadedRate = benchmark(false, durationMs, bufferSize);
+            double fusedRate = benchmark(true, durationMs, bufferSize);
+            printf("[FusedChainTester] decim %d, %d samples/buffer: threaded %lf S/s, fused %lf S/s (x%lf)\n", _decimRatio, bufferSize, threadedRate, fusedRate, fusedRate / threadedRate);
+            return fusedRate / threadedRate;
+        }
+
+    protected:
+        bool _init = false;
+        int _decimRatio;
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../channel/frequency_xlator.h"
+#include "../channel/multi_xlator.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures translating a full rate input to N VFOs with a MultiXlator against one FrequencyXlator per VFO each
+    // going through the whole buffer, and the error of the translated outputs over a long run
+    class MultiXlatorTester {
+    public:
+        // Returns the MS/s of input translated to all VFOs, with a MultiXlator using the given kernel or, if NULL,
+        // with one FrequencyXlator per VFO
+        double benchmark(math::rotator_kernel_t kernel, int vfoCount, int durationMs, int bufferSize) {
+            stream<complex_t> in;
+            in.setBufferSize(bufferSize);
+            genNoise(in.writeBuf, bufferSize);
+            std::vector<std::unique_ptr<stream<complex_t>>> outs;
+            std::vector<std::unique_ptr<channel::FrequencyXlator>> xlators;
+            KernelXlator multi;
+            multi.init(&in);
+            for (int i = 0; i < vfoCount; i++) {
+                outs.emplace_back(new stream<complex_t>);
+                outs.back()->setBufferSize(bufferSize);
+                double offset = genOffset(i);
+                if (kernel) {
+                    multi.bindOutput(outs.back().get(), offset);
+                }
+                else {
+                    xlators.emplace_back(new channel::FrequencyXlator);
+                    xlators.back()->init(NULL, offset);
+                }
+            }
+            if (kernel) { multi.setKernel(kernel); }
+
+            return measureRate(durationMs, [&]() {
+                if (kernel) {
+                    multi.process(bufferSize, in.writeBuf);
+                }
+                else {
+                    for (int i = 0; i < vfoCount; i++) { xlators[i]->process(bufferSize, in.writeBuf, outs[i]->writeBuf); }
+                }
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        // Largest error of an output against a double precision translation, over the given number of samples
+        double maxError(math::rotator_kernel_t kernel, double offset, int bufferSize, int64_t samples) {
+            stream<complex_t> in;
+            stream<complex_t> out;
+            in.setBufferSize(bufferSize);
+            out.setBufferSize(bufferSize);
+            channel::FrequencyXlator single;
+            KernelXlator multi;
+            single.init(NULL, offset);
+            multi.init(&in);
+            multi.bindOutput(&out, offset);
+            if (kernel) { multi.setKernel(kernel); }
+
+            double maxErr = 0.0;
+            for (int64_t t = 0; t < samples; t += bufferSize) {
+                for (int i = 0; i < bufferSize; i++) { in.writeBuf[i] = { 1.0f, 0.0f }; }
+                if (kernel) {
+                    multi.process(bufferSize, in.writeBuf);
+                }
+                else {
+                    single.process(bufferSize, in.writeBuf, out.writeBuf);
+                }
+                for (int i = 0; i < bufferSize; i++) {
+                    double ph = fmod(offset * (double)(t + i), 2.0 * M_PI);
+                    maxErr = std::max<double>(maxErr, hypot(out.writeBuf[i].re - cos(ph), out.writeBuf[i].im - sin(ph)));
+                }
+            }
+            return maxErr;
+        }
+
+        void compare(int durationMs, int bufferSize, int64_t errorSamples) {
+            std::vector<std::pair<const char*, math::rotator_kernel_t>> kernels = {
+                { "xlators", NULL },
+                { "generic", math::rotator::generic }
+            };
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX2()) { kernels.push_back({ "avx2", math::rotator::avx2 }); }
+            if (cpu::hasAVX512()) { kernels.push_back({ "avx512", math::rotator::avx512 }); }
+#elif defined(DSP_CPU_NEON)
+            kernels.push_back({ "neon", math::rotator::neon });
+#endif
+
+            for (auto& [name, kernel] : kernels) {
+                printf("[MultiXlatorTester] %s: max error after %lld samples %le\n", name, (long long)errorSamples, maxError(kernel, genOffset(1), bufferSize, errorSamples));
+            }
+            for (int n = 1; n <= 64; n *= 4) {
+                double base = 0.0;
+                for (auto& [name, kernel] : kernels) {
+                    double speed = benchmark(kernel, n, durationMs, bufferSize);
+                    if (!kernel) { base = speed; }
+                    printf("[MultiXlatorTester] %d VFOs, %s: %lf MS/s (x%lf)\n", n, name, speed, speed / base);
+                }
+            }
+        }
+
+    private:
+        // Kernels are normally picked by the xlator, the tester swaps them in to compare them
+        class KernelXlator : public channel::MultiXlator {
+        public:
+            void setKernel(math::rotator_kernel_t k) { kernel = k; }
+        };
+
+        // Spread over the band like VFOs would be
+        static double genOffset(int i) {
+            return -2.9 + 0.0917 * (double)i;
+        }
+
+        static void genNoise(complex_t* out, int count) {
+            for (int i = 0; i < count; i++) {
+                out[i] = { (float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f };
+            }
+        }
+    };
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../noise_reduction/noise_blanker.h"
+#include "../noise_reduction/squelch.h"
+#include "../noise_reduction/fm_if.h"
+#include "../demod/quadrature.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the noise blanker kernels against the per sample blanker they replaced, and the cost of a channel
+    // whose squelch is closed with and without gating of the blocks that follow it
+    class NoiseBlankerTester {
+    public:
+        // Returns the MS/s of a blanker kernel, NULL for the old blanker
+        double benchmark(noise_reduction::blanker::kernel_t kernel, int durationMs, int bufferSize) {
+            std::vector<complex_t> in = genImpulsive(bufferSize);
+            std::vector<complex_t> out(bufferSize);
+            float amp = 1.0f;
+
+            return measureRate(durationMs, [&]() {
+                amp = run(kernel, in.data(), out.data(), bufferSize, amp);
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        // Largest relative difference between the outputs of a kernel and of the old blanker
+        double maxDifference(noise_reduction::blanker::kernel_t kernel, int bufferSize, int buffers) {
+            std::vector<complex_t> in = genImpulsive(bufferSize);
+            std::vector<complex_t> oldOut(bufferSize);
+            std::vector<complex_t> newOut(bufferSize);
+            float oldAmp = 1.0f;
+            float newAmp = 1.0f;
+
+            double maxDiff = 0.0;
+            for (int b = 0; b < buffers; b++) {
+                oldAmp = run(NULL, in.data(), oldOut.data(), bufferSize, oldAmp);
+                newAmp = run(kernel, in.data(), newOut.data(), bufferSize, newAmp);
+                for (int i = 0; i < bufferSize; i++) {
+                    double ref = std::max<double>(hypot(oldOut[i].re, oldOut[i].im), 1e-6);
+                    maxDiff = std::max<double>(maxDiff, hypot(oldOut[i].re - newOut[i].re, oldOut[i].im - newOut[i].im) / ref);
+                }
+            }
+            return maxDiff;
+        }
+
+        // Returns the MS/s of a closed channel: squelch, FM IF noise reduction and demodulator
+        double benchmarkClosed(bool gating, int durationMs, int bufferSize) {
+            std::vector<complex_t> in = genImpulsive(bufferSize);
+            for (auto& s : in) { s = { s.re * 1e-3f, s.im * 1e-3f }; }
+            std::vector<complex_t> mid(bufferSize);
+            std::vector<float> out(bufferSize);
+            noise_reduction::Squelch squelch;
+            noise_reduction::FMIF fmnr;
+            demod::Quadrature demod;
+            squelch.init(NULL, -20.0);
+            squelch.setGating(gating);
+            fmnr.init(NULL, 32);
+            demod.init(NULL, 5000.0, 48000.0);
+
+            return measureRate(durationMs, [&]() {
+                // Like in a fused chain, nothing is run after a block that outputs nothing
+                int count = squelch.process(bufferSize, in.data(), mid.data());
+                if (count) {
+                    count = fmnr.process(count, mid.data(), mid.data());
+                    demod.process(count, mid.data(), out.data());
+                }
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        // Returns the MS/s of the squelch alone, the old one if old is true
+        double benchmarkSquelch(bool old, int durationMs, int bufferSize) {
+            std::vector<complex_t> in = genImpulsive(bufferSize);
+            std::vector<complex_t> out(bufferSize);
+            std::vector<float> norm(bufferSize);
+            noise_reduction::Squelch squelch;
+            squelch.init(NULL, -20.0);
+
+            return measureRate(durationMs, [&]() {
+                if (old) {
+                    // What the squelch did before
+                    float sum;
+                    volk_32fc_magnitude_32f(norm.data(), (lv_32fc_t*)in.data(), bufferSize);
+                    volk_32f_accumulator_s32f(&sum, norm.data(), bufferSize);
+                    sum /= (float)bufferSize;
+                    if (10.0f * log10f(sum) >= -20.0f) {
+                        memcpy(out.data(), in.data(), bufferSize * sizeof(complex_t));
+                    }
+                    else {
+                        memset(out.data(), 0, bufferSize * sizeof(complex_t));
+                    }
+                }
+                else {
+                    squelch.process(bufferSize, in.data(), out.data());
+                }
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        void compare(int durationMs, int bufferSize) {
+            std::vector<std::pair<const char*, noise_reduction::blanker::kernel_t>> kernels = {
+                { "old", NULL },
+                { "generic", noise_reduction::blanker::generic }
+            };
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX2()) { kernels.push_back({ "avx2", noise_reduction::blanker::avx2 }); }
+#endif
+
+            double base = 0.0;
+            for (auto& [name, kernel] : kernels) {
+                double speed = benchmark(kernel, durationMs, bufferSize);
+                if (!kernel) { base = speed; }
+                printf("[NoiseBlankerTester] blanker %s: %lf MS/s (x%lf), max relative difference %le\n",
+                    name, speed, speed / base, kernel ? maxDifference(kernel, bufferSize, 16) : 0.0);
+            }
+
+            base = benchmarkSquelch(true, durationMs, bufferSize);
+            double speed = benchmarkSquelch(false, durationMs, bufferSize);
+            printf("[NoiseBlankerTester] squelch old: %lf MS/s, new: %lf MS/s (x%lf)\n", base, speed, speed / base);
+
+            base = benchmarkClosed(false, durationMs, bufferSize);
+            speed = benchmarkClosed(true, durationMs, bufferSize);
+            printf("[NoiseBlankerTester] closed channel, zeros: %lf MS/s, gated: %lf MS/s (x%lf)\n", base, speed, speed / base);
+        }
+
+    private:
+        static float run(noise_reduction::blanker::kernel_t kernel, const complex_t* in, complex_t* out, int count, float amp) {
+            if (kernel) { return kernel(in, out, count, amp, RATE, LEVEL); }
+
+            // What the noise blanker did before
+            for (int i = 0; i < count; i++) {
+                complex_t s = in[i];
+                float inAmp = s.amplitude();
+                float gain = 1.0f;
+                if (inAmp != 0.0f) {
+                    amp = (amp * (1.0f - RATE)) + (inAmp * RATE);
+                    float excess = inAmp / amp;
+                    if (excess > LEVEL) {
+                        gain = 1.0f / excess;
+                    }
+                }
+                out[i] = s * gain;
+            }
+            return amp;
+        }
+
+        static constexpr float RATE = 500.0f / 24000.0f;
+        static constexpr float LEVEL = 10.0f;
+
+        // Complex noise with pulses a hundred times stronger every few hundred samples
+        static std::vector<complex_t> genImpulsive(int count) {
+            std::vector<complex_t> out(count);
+            for (int i = 0; i < count; i++) {
+                out[i] = { 0.01f * ((float)rand() / (float)RAND_MAX - 0.5f), 0.01f * ((float)rand() / (float)RAND_MAX - 0.5f) };
+                if (rand() % 300 == 0) { out[i] = { 1.0f, -1.0f }; }
+            }
+            return out;
+        }
+    };
+}
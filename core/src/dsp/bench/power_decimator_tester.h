@@ -0,0 +1,35 @@
+#pragma once
+#include "speed_tester.h"
+#include "../multirate/power_decimator.h"
+
+namespace dsp::bench {
+    // Measures the highest input samplerate the power decimator sustains for a given ratio and thread count
+    class PowerDecimatorTester {
+    public:
+        double benchmark(int ratio, int threads, int durationMs, int bufferSize) {
+            stream<complex_t> input;
+            multirate::PowerDecimator<complex_t> decim(&input, ratio);
+            decim.setThreadCount(threads);
+
+            decim.start();
+            SpeedTester<complex_t, complex_t> tester(&input, &decim.out);
+            double rate = tester.benchmark(durationMs, bufferSize);
+            decim.stop();
+
+            return rate;
+        }
+
+        // Prints the throughput for thread counts from 1 to maxThreads, returns the best speedup over a single thread
+        double compare(int ratio, int maxThreads, int durationMs, int bufferSize) {
+            double baseRate = benchmark(ratio, 1, durationMs, bufferSize);
+            printf("[PowerDecimatorTester] ratio %d, 1 thread: %lf S/s\n", ratio, baseRate);
+            double speedup = 1.0;
+            for (int t = 2; t <= maxThreads; t++) {
+                double rate = benchmark(ratio, t, durationMs, bufferSize);
+                speedup = std::max<double>(speedup, rate / baseRate);
+                printf("[PowerDecimatorTester] ratio %d, %d threads: %lf S/s (x%lf)\n", ratio, t, rate, rate / baseRate);
+            }
+            return speedup;
+        }
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../math/phase_diff.h"
+#include "../math/normalize_phase.h"
+#include "../math/hz_to_rads.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the FM discriminator kernels against the per sample atan2 the quadrature demodulator used to have,
+    // both for speed and for the error of their output against a double precision reference
+    class QuadratureTester {
+    public:
+        // Returns the MS/s of a kernel, NULL for the old discriminator
+        double benchmark(math::phase_diff_kernel_t kernel, double sampleRate, double deviation, int durationMs, int bufferSize) {
+            std::vector<complex_t> in = genFM(sampleRate, deviation, bufferSize);
+            std::vector<float> out(bufferSize);
+            float gain = 1.0f / math::hzToRads(deviation, sampleRate);
+
+            return measureRate(durationMs, [&]() {
+                run(kernel, in.data(), gain, out.data(), bufferSize);
+                return bufferSize;
+            }) / 1e6;
+        }
+
+        // Max and RMS error in radians of a kernel, NULL for the old discriminator
+        void accuracy(math::phase_diff_kernel_t kernel, double sampleRate, double deviation, int count, double& maxErr, double& rmsErr) {
+            std::vector<complex_t> in = genFM(sampleRate, deviation, count);
+            std::vector<float> out(count);
+            run(kernel, in.data(), 1.0f, out.data(), count);
+
+            maxErr = 0.0;
+            rmsErr = 0.0;
+            for (int i = 1; i < count; i++) {
+                double re = (double)in[i].re * in[i - 1].re + (double)in[i].im * in[i - 1].im;
+                double im = (double)in[i].im * in[i - 1].re - (double)in[i].re * in[i - 1].im;
+                double err = fabs((double)out[i] - atan2(im, re));
+                maxErr = std::max<double>(maxErr, err);
+                rmsErr += err * err;
+            }
+            rmsErr = sqrt(rmsErr / (double)(count - 1));
+        }
+
+        // Prints the speed and error of the old discriminator and of every kernel the CPU supports
+        void compare(double sampleRate, double deviation, int durationMs, int bufferSize) {
+            std::vector<std::pair<const char*, math::phase_diff_kernel_t>> kernels = {
+                { "atan2", NULL },
+                { "scalar", math::phase_diff::scalar }
+            };
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX2()) { kernels.push_back({ "avx2", math::phase_diff::avx2 }); }
+            if (cpu::hasAVX512()) { kernels.push_back({ "avx512", math::phase_diff::avx512 }); }
+#elif defined(DSP_CPU_NEON)
+            kernels.push_back({ "neon", math::phase_diff::neon });
+#endif
+
+            double base = 0.0;
+            for (auto& [name, kernel] : kernels) {
+                double maxErr, rmsErr;
+                double speed = benchmark(kernel, sampleRate, deviation, durationMs, bufferSize);
+                accuracy(kernel, sampleRate, deviation, bufferSize, maxErr, rmsErr);
+                if (!kernel) { base = speed; }
+                printf("[QuadratureTester] %lf MS/s, %s: %lf MS/s (x%lf), max error %le rad, rms error %le rad\n",
+                    sampleRate / 1e6, name, speed, speed / base, maxErr, rmsErr);
+            }
+        }
+
+    private:
+        static void run(math::phase_diff_kernel_t kernel, const complex_t* in, float gain, float* out, int count) {
+            if (kernel) {
+                kernel(in, { 1.0f, 0.0f }, gain, out, count);
+                return;
+            }
+
+            // What the quadrature demodulator did before
+            float phase = 0.0f;
+            for (int i = 0; i < count; i++) {
+                float cphase = atan2f(in[i].im, in[i].re);
+                out[i] = math::normalizePhase(cphase - phase) * gain;
+                phase = cphase;
+            }
+        }
+
+        // Broadcast like FM: audio tones and a pilot with some noise on the carrier
+        static std::vector<complex_t> genFM(double sampleRate, double deviation, int count) {
+            std::vector<complex_t> out(count);
+            double phase = 0.0;
+            for (int i = 0; i < count; i++) {
+                double t = (double)i / sampleRate;
+                double m = 0.5 * sin(2.0 * M_PI * 1000.0 * t) + 0.3 * sin(2.0 * M_PI * 15000.0 * t) + 0.1 * sin(2.0 * M_PI * 19000.0 * t);
+                phase += 2.0 * M_PI * deviation * m / sampleRate;
+                float noise = 0.01f * ((float)rand() / (float)RAND_MAX - 0.5f);
+                out[i] = { (float)cos(phase) + noise, (float)sin(phase) - noise };
+            }
+            return out;
+        }
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "../fft/spectrum_engine.h"
+#include "../math/bin_zoom.h"
+#include "../math/constants.h"
+#include "../compression/spectrum_row_encoder.h"
+#include "../window/nuttall.h"
+
+namespace dsp::bench {
+    // Measures the link bandwidth of FFT rows computed by the server against streaming the baseband to the client
+    class SpectrumRowTester {
+    public:
+        // Returns the mean size in bytes of a row of width points from FFTs of the given size, over rowCount rows of
+        // noise with a few carriers. maxError is set to the largest error in dB of the decoded rows over the bins
+        // within the quantized range.
+        double rowSize(int size, int width, compression::SpectrumRowFormat format, bool compress, int rowCount, float& maxError) {
+            fft::SpectrumEngine engine;
+            engine.configure(size, size, 1, fft::PLAN_ESTIMATE);
+            float* window = engine.getWindow();
+            for (int i = 0; i < size; i++) { window[i] = window::nuttall(i, size) * ((i % 2) ? -1.0f : 1.0f); }
+
+            math::BinZoom zoom;
+            zoom.configure(0, size, size, width);
+            compression::SpectrumRowEncoder encoder;
+            compression::SpectrumRowDecoder decoder;
+            std::vector<complex_t> frame(size);
+            std::vector<float> power(size);
+            std::vector<float> row(width);
+            std::vector<uint8_t> out(compression::SpectrumRowEncoder::getMaxSize(width));
+            std::vector<float> decoded(width);
+
+            double total = 0.0;
+            maxError = 0.0f;
+            for (int r = 0; r < rowCount; r++) {
+                genSignal(frame.data(), size, r);
+                engine.push(frame.data());
+                engine.transform();
+                engine.power(0, power.data());
+                zoom.process(power.data(), row.data());
+                size_t bytes = encoder.encode(row.data(), width, format, compress, out.data());
+                total += (double)bytes;
+
+                if (decoder.decode(out.data(), bytes, decoded.data()) != width) {
+                    printf("[SpectrumRowTester] row %d failed to decode\n", r);
+                    continue;
+                }
+                float peak = *std::max_element(row.begin(), row.end());
+                for (int i = 0; i < width; i++) {
+                    if (row[i] < peak - QUANTIZE_DB_RANGE) { continue; }
+                    maxError = std::max<float>(maxError, fabsf(decoded[i] - row[i]));
+                }
+            }
+            return total / (double)rowCount;
+        }
+
+        // Prints the bandwidth of the baseband for each sample type and of the FFT rows for each format
+        void compare(double sampleRate, int size, int width, double rate, int rowCount) {
+            const char* pcmNames[] = { "int8", "int16", "float32" };
+            int pcmBytes[] = { 2, 4, 8 };
+            for (int i = 0; i < 3; i++) {
+                printf("[SpectrumRowTester] baseband %s at %lf MS/s: %lf kB/s\n", pcmNames[i], sampleRate / 1e6, sampleRate * pcmBytes[i] / 1e3);
+            }
+
+            // Packet headers are counted as well
+            for (int f = 0; f < 2; f++) {
+                for (int c = 0; c < 2; c++) {
+                    float maxError;
+                    double bytes = rowSize(size, width, (compression::SpectrumRowFormat)f, c, rowCount, maxError) + 8.0;
+                    printf("[SpectrumRowTester] FFT %d to %d points, %s%s at %lf rows/s: %lf bytes/row, %lf kB/s, max error %f dB\n", size, width,
+                        f ? "uint16" : "uint8", c ? " zstd" : "", rate, bytes, bytes * rate / 1e3, maxError);
+                }
+            }
+        }
+
+    private:
+        // Complex noise with carriers, the first one drifting along the rows
+        static void genSignal(complex_t* out, int size, int row) {
+            const float freqs[] = { 0.1f + 0.0001f * (float)row, -0.23f, 0.31f, -0.4f };
+            const float amps[] = { 1.0f, 0.1f, 0.01f, 0.003f };
+            for (int i = 0; i < size; i++) {
+                float re = 0.001f * ((float)rand() / (float)RAND_MAX - 0.5f);
+                float im = 0.001f * ((float)rand() / (float)RAND_MAX - 0.5f);
+                for (int j = 0; j < 4; j++) {
+                    float phase = 2.0f * FL_M_PI * freqs[j] * (float)i;
+                    re += amps[j] * cosf(phase);
+                    im += amps[j] * sinf(phase);
+                }
+                out[i] = { re, im };
+            }
+        }
+    };
+}
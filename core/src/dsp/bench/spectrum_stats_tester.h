@@ -0,0 +1,108 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <volk/volk.h>
+#include "../math/spectrum_stats.h"
+#include "timing.h"
+
+namespace dsp::bench {
+    // Measures the per FFT work of the waterfall: smoothing and peak hold of the displayed line and the signal info of VFOs
+    class SpectrumStatsTester {
+    public:
+        // Returns the FFTs per second processed with the kernels, the VFOs each cover a tenth of the spectrum
+        double benchmark(int size, int width, int vfoCount, int durationMs) {
+            float* raw = genSpectrum(size);
+            float* line = genSpectrum(width);
+            float* avg = genSpectrum(width);
+            float* hold = genSpectrum(width);
+            math::SpectrumStats stats;
+
+            volatile float sink = 0.0f;
+            double rate = measureRate(durationMs, [&]() {
+                math::smooth(line, avg, 0.3f, 0.7f, width);
+                math::hold(line, hold, 0.01f, width);
+                stats.build(raw, size);
+                for (int v = 0; v < vfoCount; v++) {
+                    int minSide, min, max, maxSide;
+                    vfoRange(v, vfoCount, size, minSide, min, max, maxSide);
+                    double a = stats.sum(minSide, min) + stats.sum(max + 1, maxSide);
+                    a /= (double)((min - minSide) + (maxSide - max - 1));
+                    sink = stats.max(min, max + 1) - a;
+                }
+                return 1;
+            });
+
+            delete[] raw;
+            delete[] line;
+            delete[] avg;
+            delete[] hold;
+            return rate;
+        }
+
+        // Same as benchmark() with the volk calls and scalar loops the waterfall used to have
+        double benchmarkScalar(int size, int width, int vfoCount, int durationMs) {
+            float* raw = genSpectrum(size);
+            float* line = genSpectrum(width);
+            float* avg = genSpectrum(width);
+            float* hold = genSpectrum(width);
+
+            volatile float sink = 0.0f;
+            double rate = measureRate(durationMs, [&]() {
+                volk_32f_s32f_multiply_32f(line, line, 0.3f, width);
+                volk_32f_s32f_multiply_32f(avg, avg, 0.7f, width);
+                volk_32f_x2_add_32f(avg, line, avg, width);
+                memcpy(line, avg, width * sizeof(float));
+                for (int i = 0; i < width; i++) { hold[i] = std::max<float>(line[i], hold[i] - 0.01f); }
+                for (int v = 0; v < vfoCount; v++) {
+                    int minSide, min, max, maxSide;
+                    vfoRange(v, vfoCount, size, minSide, min, max, maxSide);
+                    double a = 0.0;
+                    int count = 0;
+                    for (int i = minSide; i < min; i++) { a += raw[i]; count++; }
+                    for (int i = max + 1; i < maxSide; i++) { a += raw[i]; count++; }
+                    a /= (double)count;
+                    float m = -INFINITY;
+                    for (int i = min; i <= max; i++) { m = std::max<float>(m, raw[i]); }
+                    sink = m - a;
+                }
+                return 1;
+            });
+
+            delete[] raw;
+            delete[] line;
+            delete[] avg;
+            delete[] hold;
+            return rate;
+        }
+
+        // Prints the results for each VFO count up to maxVFOs, returns the speedup with the most VFOs
+        double compare(int size, int width, int maxVFOs, int durationMs) {
+            double speedup = 0.0;
+            for (int v = 1; v <= maxVFOs; v *= 2) {
+                double scalar = benchmarkScalar(size, width, v, durationMs);
+                double simd = benchmark(size, width, v, durationMs);
+                speedup = simd / scalar;
+                printf("[SpectrumStatsTester] %d bins, %d VFOs: scalar %lf FFTs/s, kernel %lf FFTs/s (x%lf)\n", size, v, scalar, simd, speedup);
+            }
+            return speedup;
+        }
+
+    private:
+        // VFOs are spread over the spectrum, their sides each being half their bandwidth as in the waterfall
+        static void vfoRange(int id, int vfoCount, int size, int& minSide, int& min, int& max, int& maxSide) {
+            int bw = size / 10;
+            int center = (int)(((int64_t)(2 * id + 1) * size) / (2 * vfoCount));
+            minSide = std::clamp<int>(center - bw, 0, size);
+            min = std::clamp<int>(center - bw / 2, 0, size);
+            max = std::clamp<int>(center + bw / 2, 0, size - 1);
+            maxSide = std::clamp<int>(center + bw, 0, size);
+        }
+
+        static float* genSpectrum(int size) {
+            float* in = new float[size];
+            for (int i = 0; i < size; i++) { in[i] = -100.0f + 60.0f * (float)rand() / (float)RAND_MAX; }
+            return in;
+        }
+    };
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "speed_tester.h"
+#include "../routing/splitter.h"
+#include "../sink/null_sink.h"
+
+namespace dsp::bench {
+    // Measures the throughput of a splitter feeding a number of outputs (like the VFOs of the IQ frontend)
+    // when every output gets its own copy of the input and when all outputs share it.
+    template <class T>
+    class SplitterTester {
+    public:
+        double benchmark(bool shared, int outputCount, int durationMs, int bufferSize) {
+            // Build the fan-out, the speed tester reads the last output and null sinks the others
+            stream<T> input;
+            routing::Splitter<T> split(&input);
+            std::vector<stream<T>*> outputs;
+            std::vector<sink::Null<T>*> sinks;
+            for (int i = 0; i < outputCount; i++) {
+                stream<T>* out = new stream<T>;
+                split.bindStream(out, shared);
+                outputs.push_back(out);
+                if (i < outputCount - 1) { sinks.push_back(new sink::Null<T>(out, NULL, NULL)); }
+            }
+
+            // Run the test
+            for (auto& sink : sinks) { sink->start(); }
+            split.start();
+            SpeedTester<T, T> tester(&input, outputs.back());
+            double rate = tester.benchmark(durationMs, bufferSize);
+            split.stop();
+            for (auto& sink : sinks) { sink->stop(); }
+
+            // Destroy the fan-out
+            for (auto& sink : sinks) { delete sink; }
+            for (auto& out : outputs) { delete out; }
+
+            return rate;
+        }
+
+        // Feeds buffers to a splitter whose dropping output is never read while another output is, returns the number
+        // of buffers the stalled output missed. All but the first should be, without holding back the other output.
+        uint64_t stalledReaderDrops(bool shared, int buffers, int bufferSize) {
+            stream<T> input;
+            stream<T> live;
+            stream<T> stalled;
+            routing::Splitter<T> split(&input);
+            split.bindStream(&live, shared);
+            split.bindStream(&stalled, shared, routing::SPLITTER_POLICY_DROP);
+            sink::Null<T> sink(&live, NULL, NULL);
+
+            sink.start();
+            split.start();
+            for (int i = 0; i < buffers; i++) {
+                if (!input.swap(bufferSize)) { break; }
+            }
+
+            // The last buffer may still be in flight
+            auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (split.getDropCount(&stalled) < buffers - 1 && std::chrono::steady_clock::now() < timeout) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            uint64_t dropped = split.getDropCount(&stalled);
+
+            split.stop();
+            sink.stop();
+            return dropped;
+        }
+
+        // Prints the throughput of both modes for power of two output counts up to maxOutputs, returns the last speedup
+        double compare(int maxOutputs, int durationMs, int bufferSize) {
+            double speedup = 1.0;
+            for (int n = 1; n <= maxOutputs; n *= 2) {
+                double copyRate = benchmark(false, n, durationMs, bufferSize);
+                double sharedRate = benchmark(true, n, durationMs, bufferSize);
+                speedup = sharedRate / copyRate;
+                printf("[SplitterTester] %d outputs, %d samples/buffer: copy %lf S/s, shared %lf S/s (x%lf)\n", n, bufferSize, copyRate, sharedRate, speedup);
+            }
+            return speedup;
+        }
+    };
+}
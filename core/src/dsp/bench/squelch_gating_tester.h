@@ -0,0 +1,101 @@
+#pragma once
+#include <ctime>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../noise_reduction/squelch.h"
+#include "../taps/from_array.h"
+#include "../demod/fm.h"
+#include "../multirate/rational_resampler.h"
+#include "../routing/gap_filler.h"
+#include "../sink/null_sink.h"
+
+namespace dsp::bench {
+    // Measures the CPU usage of idle channels laid out like in the radio module, a squelch followed by an NFM
+    // demodulator, an audio resampler and the gap filler feeding the sink, with and without squelch gating
+    class SquelchGatingTester {
+    public:
+        // Returns the CPU usage in percent of a core for the given number of channels receiving noise below the
+        // squelch level, that is the CPU time spent per second of signal
+        double benchmark(int channels, bool gating, double seconds) {
+            std::vector<std::unique_ptr<Channel>> chans;
+            for (int i = 0; i < channels; i++) { chans.emplace_back(new Channel(gating)); }
+
+            std::vector<complex_t> noise(BUFFER_SIZE);
+            for (auto& s : noise) { s = { 1e-6f * ((float)rand() / (float)RAND_MAX - 0.5f), 1e-6f * ((float)rand() / (float)RAND_MAX - 0.5f) }; }
+
+            // The buffers are sent as fast as the channels take them, what matters is the CPU time per second of signal
+            int buffers = (int)(seconds * IF_SAMPLERATE / (double)BUFFER_SIZE);
+            std::clock_t start = std::clock();
+            for (int b = 0; b < buffers; b++) {
+                for (auto& c : chans) {
+                    memcpy(c->in.writeBuf, noise.data(), BUFFER_SIZE * sizeof(complex_t));
+                    c->in.swap(BUFFER_SIZE);
+                }
+            }
+            std::clock_t end = std::clock();
+
+            double cpuSeconds = (double)(end - start) / (double)CLOCKS_PER_SEC;
+            double signalSeconds = (double)buffers * (double)BUFFER_SIZE / IF_SAMPLERATE;
+            return 100.0 * cpuSeconds / signalSeconds;
+        }
+
+        void compare(double seconds) {
+            const int counts[] = { 1, 10, 50, 100, 200 };
+            for (int n : counts) {
+                double always = benchmark(n, false, seconds);
+                double gated = benchmark(n, true, seconds);
+                printf("[SquelchGatingTester] %d idle channels, always running: %lf%% CPU, gated: %lf%% CPU\n", n, always, gated);
+            }
+        }
+
+    private:
+        static constexpr double IF_SAMPLERATE = 50000.0;
+        static constexpr double AF_SAMPLERATE = 48000.0;
+        static constexpr int BUFFER_SIZE = 1000;
+
+        struct Channel {
+            Channel(bool gating) {
+                in.setBufferSize(BUFFER_SIZE);
+                squelch.init(&in, -50.0);
+                squelch.setGating(gating);
+                squelch.setClosedHandler(closedHandler, this);
+                demod.init(&squelch.out, IF_SAMPLERATE, 12500.0, true, true);
+                resamp.init(&demod.out, IF_SAMPLERATE, AF_SAMPLERATE);
+                filler.init(&resamp.out);
+                sink.init(&filler.out);
+                squelch.start();
+                demod.start();
+                resamp.start();
+                filler.start();
+                sink.start();
+            }
+
+            ~Channel() {
+                squelch.stop();
+                demod.stop();
+                resamp.stop();
+                filler.stop();
+                sink.stop();
+            }
+
+            // Same as the radio module
+            static void closedHandler(int count, void* ctx) {
+                Channel* _this = (Channel*)ctx;
+                _this->silencePhase += (double)count * AF_SAMPLERATE / IF_SAMPLERATE;
+                int silence = (int)_this->silencePhase;
+                _this->silencePhase -= (double)silence;
+                _this->filler.fill(silence);
+            }
+
+            stream<complex_t> in;
+            noise_reduction::Squelch squelch;
+            demod::FM<stereo_t> demod;
+            multirate::RationalResampler<stereo_t> resamp;
+            routing::GapFiller<stereo_t> filler;
+            sink::Null<stereo_t> sink;
+            double silencePhase = 0.0;
+        };
+    };
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "speed_tester.h"
+#include "../routing/stream_link.h"
+
+namespace dsp::bench {
+    // Measures the throughput of a chain of copy blocks linked by streams using a given transport.
+    // Small buffer sizes make the hand-off cost dominate over the copy cost.
+    template <class T>
+    class StreamTransportTester {
+    public:
+        StreamTransportTester() {}
+
+        StreamTransportTester(int blockCount) { init(blockCount); }
+
+        ~StreamTransportTester() {
+            if (!_init) { return; }
+            for (auto& link : links) { delete link; }
+            for (auto& strm : streams) { delete strm; }
+        }
+
+        void init(int blockCount) {
+            _blockCount = blockCount;
+            _init = true;
+        }
+
+        double benchmark(StreamTransport transport, int durationMs, int bufferSize) {
+            assert(_init);
+
+            // Build the chain
+            for (int i = 0; i <= _blockCount; i++) {
+                stream<T>* strm = new stream<T>;
+                strm->setTransport(transport);
+                streams.push_back(strm);
+            }
+            for (int i = 0; i < _blockCount; i++) {
+                links.push_back(new routing::StreamLink<T>(streams[i], streams[i + 1]));
+            }
+
+            // Run the test
+            for (auto& link : links) { link->start(); }
+            SpeedTester<T, T> tester(streams[0], streams[_blockCount]);
+            double rate = tester.benchmark(durationMs, bufferSize);
+            for (auto& link : links) { link->stop(); }
+
+            // Destroy the chain
+            for (auto& link : links) { delete link; }
+            for (auto& strm : streams) { delete strm; }
+            links.clear();
+            streams.clear();
+
+            return rate;
+        }
+
+        // Returns the speedup of the lock-free transport over the condition variable one
+        double compare(int durationMs, int bufferSize) {
+            double condvarRate = benchmark(STREAM_TRANSPORT_CONDVAR, durationMs, bufferSize);
+            double spscRate = benchmark(STREAM_TRANSPORT_SPSC, durationMs, bufferSize);
+            printf("[StreamTransportTester] %d blocks, %d samples/buffer: condvar %lf S/s, spsc %lf S/s (x%lf)\n", _blockCount, bufferSize, condvarRate, spscRate, spscRate / condvarRate);
+            return spscRate / condvarRate;
+        }
+
+    protected:
+        bool _init = false;
+        int _blockCount;
+        std::vector<stream<T>*> streams;
+        std::vector<routing::StreamLink<T>*> links;
+    };
+}
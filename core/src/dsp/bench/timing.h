@@ -0,0 +1,20 @@
+#pragma once
+#include <chrono>
+#include <stdint.h>
+
+namespace dsp::bench {
+    // Calls func until durationMs have passed and returns the rate per second of what it processed. func returns the
+    // number of items, samples or frames, processed by the call.
+    template <class Func>
+    inline double measureRate(int durationMs, const Func& func) {
+        uint64_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            count += func();
+            now = std::chrono::steady_clock::now();
+        }
+        return (double)count / std::chrono::duration<double>(now - start).count();
+    }
+}
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include "stream.h"
 #include "types.h"
+#include "scheduler.h"
+#include "profiler.h"
 
 namespace dsp {
     class generic_block {
@@ -17,9 +19,13 @@ namespace dsp {
 
     class block : public generic_block {
     public:
+        block() {}
+
         virtual ~block() {
+            memory::blocks().remove(this);
             if (!_block_init) { return; }
             stop();
+            if (schedTask) { scheduler->releaseTask(schedTask); }
             _block_init = false;
         }
 
@@ -31,10 +37,16 @@ namespace dsp {
             }
             running = true;
             doStart();
+            memory::blocks().add(this);
         }
 
         virtual void stop() {
             assert(_block_init);
+
+            // Only running blocks are listed in the registry. Derived destructors stop the block before tearing it
+            // down, so reports never see a block being destroyed.
+            memory::blocks().remove(this);
+
             std::lock_guard<std::recursive_mutex> lck(ctrlMtx);
             if (!running) {
                 return;
@@ -45,6 +57,10 @@ namespace dsp {
 
         void tempStart() {
             assert(_block_init);
+            if (fusedHost) {
+                fusedHost->tempStart();
+                return;
+            }
             if (!tempStopDepth || --tempStopDepth) { return; }
             if (tempStopped) {
                 doStart();
@@ -54,6 +70,10 @@ namespace dsp {
 
         void tempStop() {
             assert(_block_init);
+            if (fusedHost) {
+                fusedHost->tempStop();
+                return;
+            }
             if (tempStopDepth++) { return; }
             if (running && !tempStopped) {
                 doStop();
@@ -63,16 +83,135 @@ namespace dsp {
 
         virtual int run() = 0;
 
+        // When set, the block is run inline by the host block and temporary stops apply to the host instead
+        void setFusedHost(block* host) {
+            fusedHost = host;
+        }
+
+        // Run the block as a task of a scheduler instead of on its own thread, NULL to go back to a thread
+        void setScheduler(Scheduler* sched) {
+            assert(_block_init);
+            std::lock_guard<std::recursive_mutex> lck(ctrlMtx);
+            tempStop();
+            if (schedTask) {
+                scheduler->releaseTask(schedTask);
+                schedTask = NULL;
+            }
+            scheduler = sched;
+            tempStart();
+        }
+
+        Scheduler* getScheduler() {
+            return scheduler;
+        }
+
+        // Bytes allocated by the block for its own work buffers, streams are accounted for separately
+        virtual size_t getMemoryUsage() { return 0; }
+
+        // getMemoryUsage() for reports from other threads. Returns false if the block is being reconfigured.
+        bool tryGetMemoryUsage(size_t& bytes) {
+            std::unique_lock<std::recursive_mutex> lck(ctrlMtx, std::try_to_lock);
+            if (!lck.owns_lock()) { return false; }
+            bytes = getMemoryUsage();
+            return true;
+        }
+
+        // Only updated while the profiler is enabled
+        profiler::BlockStats profile;
+
+        // Sum the latency stats of the inputs and reset their max. Returns false if the block is being reconfigured.
+        bool getInputLatency(uint64_t& latencyNs, uint64_t& buffers, uint64_t& maxLatencyNs) {
+            std::unique_lock<std::recursive_mutex> lck(ctrlMtx, std::try_to_lock);
+            if (!lck.owns_lock()) { return false; }
+            latencyNs = 0;
+            buffers = 0;
+            maxLatencyNs = 0;
+            for (auto& in : inputs) {
+                if (!in) { continue; }
+                latencyNs += in->profile.latencyNs;
+                buffers += in->profile.buffers;
+                maxLatencyNs = std::max<uint64_t>(maxLatencyNs, in->profile.maxLatencyNs.exchange(0));
+            }
+            return true;
+        }
+
+        // Returns false if the block has never been run by a scheduler
+        bool getSchedulerStats(SchedulerStats& stats) {
+            if (!schedTask) { return false; }
+            stats = schedTask->getStats();
+            return true;
+        }
+
     protected:
         void workerLoop() {
-            while (run() >= 0) {}
+            while ((profiler::isEnabled() ? profiledRun() : run()) >= 0) {}
+        }
+
+        static int schedulerRun(void* ctx) {
+            block* blk = (block*)ctx;
+            return profiler::isEnabled() ? blk->profiledRun() : blk->run();
+        }
+
+        int profiledRun() {
+            // Waits are measured by the streams, take the difference over the run
+            uint64_t inputWait = 0;
+            uint64_t outputWait = 0;
+            for (auto& in : inputs) { inputWait -= in->profile.readWaitNs.load(std::memory_order_relaxed); }
+            for (auto& out : outputs) { outputWait -= out->profile.writeWaitNs.load(std::memory_order_relaxed); }
+
+            profiler::currentOrigin = 0;
+            uint64_t start = profiler::now();
+            int ret = run();
+            uint64_t end = profiler::now();
+
+            for (auto& in : inputs) { inputWait += in->profile.readWaitNs.load(std::memory_order_relaxed); }
+            for (auto& out : outputs) { outputWait += out->profile.writeWaitNs.load(std::memory_order_relaxed); }
+
+            profiler::add(profile.runs, 1);
+            if (ret > 0) { profiler::add(profile.samples, ret); }
+            profiler::add(profile.runNs, end - start);
+            profiler::add(profile.inputWaitNs, inputWait);
+            profiler::add(profile.outputWaitNs, outputWait);
+
+            profiler::Tracer& tracer = profiler::tracer();
+            if (tracer.isCapturing()) {
+                uint64_t latency = profiler::currentOrigin ? (end - profiler::currentOrigin) : 0;
+                tracer.record({ this, &typeid(*this), start, end - start, inputWait, outputWait, latency, ret });
+            }
+
+            return ret;
         }
 
+        // Whether the block may run on the scheduler's pool. Blocks without inputs, sources, either wait on hardware
+        // or produce unconditionally, on the pool they would busy-loop or hold a worker forever. Blocks that wait on
+        // anything but their streams override this to keep their own thread as well.
+        virtual bool schedulable() { return !inputs.empty(); }
+
         virtual void doStart() {
+            if (scheduler && schedulable()) {
+                if (!schedTask) { schedTask = scheduler->createTask(); }
+                std::vector<untyped_stream*> waited;
+                for (auto& out : outputs) {
+                    if (waitsOnOutput(out)) { waited.push_back(out); }
+                }
+                scheduler->attach(schedTask, schedulerRun, this, inputs, waited);
+                scheduled = true;
+                return;
+            }
             workerThread = std::thread(&block::workerLoop, this);
         }
 
+        // False for outputs the block never waits on because it checks them itself before writing, the scheduler
+        // then runs the block without waiting for them to be writable
+        virtual bool waitsOnOutput(untyped_stream* out) { return true; }
+
         virtual void doStop() {
+            if (scheduled) {
+                scheduler->detach(schedTask);
+                scheduled = false;
+                return;
+            }
+
             for (auto& in : inputs) {
                 in->stopReader();
             }
@@ -127,6 +266,11 @@ namespace dsp {
         bool running = false;
         bool tempStopped = false;
         int tempStopDepth = 0;
+        block* fusedHost = NULL;
         std::thread workerThread;
+
+        Scheduler* scheduler = defaultScheduler;
+        SchedulerTask* schedTask = NULL;
+        bool scheduled = false;
     };
 }
\ No newline at end of file
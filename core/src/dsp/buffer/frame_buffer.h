@@ -43,6 +43,11 @@ namespace dsp::buffer {
             base_type::tempStart();
         }
 
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return TEST_BUFFER_SIZE * STREAM_BUFFER_SIZE * sizeof(T);
+        }
+
         void flush() {
             std::unique_lock lck(bufMtx);
             readCur = writeCur;
@@ -26,6 +26,7 @@ namespace dsp::buffer {
             _keep = keep;
             _skip = skip;
             ringBuf.init(keep * 2);
+            fitOutput();
             base_type::registerInput(_in);
             base_type::registerOutput(&out);
             base_type::_block_init = true;
@@ -47,6 +48,7 @@ namespace dsp::buffer {
             base_type::tempStop();
             _keep = keep;
             ringBuf.setMaxLatency(keep * 2);
+            fitOutput();
             base_type::tempStart();
         }
 
@@ -69,6 +71,11 @@ namespace dsp::buffer {
         stream<T> out;
 
     private:
+        // Blocks of keep samples are written to the output at once
+        void fitOutput() {
+            if (_keep > out.getBufferSize()) { out.resize(_keep); }
+        }
+
         void doStart() override {
             workThread = std::thread(&Reshaper<T>::loop, this);
             bufferWorkerThread = std::thread(&Reshaper<T>::bufferWorker, this);
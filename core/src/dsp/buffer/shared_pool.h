@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../stream.h"
+
+namespace dsp::buffer {
+    // Pool of reference counted buffers that can be lent to several streams at once (see stream::swapShared).
+    // Buffers go back to the pool when their last reference is released, even after the pool is destroyed.
+    template <class T>
+    class SharedPool {
+        struct State;
+    public:
+        class Buffer : public shared_buffer_ref {
+            friend SharedPool;
+        public:
+            void acquire() {
+                refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release() {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) { state->recycle(this); }
+            }
+
+            T* data = NULL;
+            int size = 0;
+
+        private:
+            std::atomic<int> refs = 0;
+            std::shared_ptr<State> state;
+        };
+
+        SharedPool() : state(std::make_shared<State>()) {}
+
+        ~SharedPool() {
+            std::lock_guard<std::mutex> lck(state->mtx);
+            state->closed = true;
+            for (auto& buf : state->freeBufs) { state->destroy(buf); }
+            state->freeBufs.clear();
+        }
+
+        // Get a buffer of at least minSize samples holding a single reference
+        Buffer* get(int minSize) {
+            Buffer* buf = NULL;
+            {
+                std::lock_guard<std::mutex> lck(state->mtx);
+                if (!state->freeBufs.empty()) {
+                    buf = state->freeBufs.back();
+                    state->freeBufs.pop_back();
+                }
+            }
+            if (!buf) {
+                buf = new Buffer;
+                buf->state = state;
+            }
+            if (buf->size < minSize) {
+                if (buf->data) { free(buf->data); }
+                buf->data = alloc<T>(minSize);
+                state->bytes += (int64_t)(minSize - buf->size) * sizeof(T);
+                buf->size = minSize;
+            }
+            buf->refs = 1;
+            return buf;
+        }
+
+        // Replace the memory of a buffer, used to take over memory handed out by a stream without copying it
+        void replace(Buffer* buf, T* data, int size) {
+            state->bytes += (int64_t)(size - buf->size) * sizeof(T);
+            buf->data = data;
+            buf->size = size;
+        }
+
+        // Bytes held by the buffers of the pool, including those still lent to streams
+        size_t getMemoryUsage() {
+            return state->bytes;
+        }
+
+    private:
+        struct State {
+            void recycle(Buffer* buf) {
+                // The buffer may hold the last reference to the state, keep it alive until unlocked
+                std::shared_ptr<State> keep;
+                std::lock_guard<std::mutex> lck(mtx);
+                if (closed) {
+                    keep = buf->state;
+                    destroy(buf);
+                    return;
+                }
+                freeBufs.push_back(buf);
+            }
+
+            void destroy(Buffer* buf) {
+                bytes -= (int64_t)buf->size * sizeof(T);
+                if (buf->data) { free(buf->data); }
+                delete buf;
+            }
+
+            std::mutex mtx;
+            std::vector<Buffer*> freeBufs;
+            bool closed = false;
+            std::atomic<int64_t> bytes = 0;
+        };
+
+        std::shared_ptr<State> state;
+    };
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "../math/bin_zoom.h"
+#include "../math/quantize_db.h"
+
+// Mip levels stop before going under this many bins
+#define SPECTRUM_HISTORY_MIN_MIP_SIZE   1024
+
+// A mip level is only used if it has this many bins per display point, so that its bins being
+// wider than the ones of the full spectrum only moves the edges of the points a little
+#define SPECTRUM_HISTORY_MIP_BINS_PER_POINT 4
+
+namespace dsp::buffer {
+    enum HistoryFormat {
+        HISTORY_FLOAT32,
+        HISTORY_UINT16,
+        HISTORY_UINT8
+    };
+
+    // Lines of dB spectra for the waterfall history. Lines are max decimated by a power of two and stored as floats or
+    // quantized to 16 or 8 bits over a range chosen when each line is written. Mip levels of halving resolution can be
+    // kept along each line so that zoomed out redraws read fewer bins, they only serve the max zoom mode.
+    class SpectrumHistory {
+    public:
+        SpectrumHistory() {}
+
+        // Lines keep their index, count lines starting at first are converted and the others cleared
+        void configure(int lineCount, int size, HistoryFormat format, int decimation, bool mips, int first = 0, int count = 0) {
+            SpectrumHistory next;
+            next.setup(lineCount, size, format, decimation, mips);
+            count = std::min<int>(count, std::min<int>(_lineCount, lineCount));
+            if (count > 0 && _size > 0) {
+                std::vector<float> stored(_levelSizes[0]);
+                std::vector<float> spectrum(size);
+                math::BinZoom resample;
+                resample.configure(0, _levelSizes[0], _levelSizes[0], size);
+                for (int i = 0; i < count; i++) {
+                    int line = (first + i) % _lineCount;
+                    read(line, stored.data());
+                    resample.process(stored.data(), spectrum.data());
+                    next.write(line % lineCount, spectrum.data());
+                }
+            }
+            *this = std::move(next);
+        }
+
+        // Resize the ring, the lines starting at first are moved to the start and the oldest ones dropped if it shrinks
+        void setLineCount(int lineCount, int first) {
+            SpectrumHistory next;
+            next.setup(lineCount, _size, _format, _decimation, _mips);
+            int count = std::min<int>(_lineCount, lineCount);
+            for (int i = 0; i < count; i++) {
+                int src = (first + i) % _lineCount;
+                memcpy(next.line(i), line(src), _lineBytes);
+                next.lo[i] = lo[src];
+                next.step[i] = step[src];
+            }
+            *this = std::move(next);
+        }
+
+        void clear() {
+            std::fill(data.begin(), data.end(), 0);
+            std::fill(lo.begin(), lo.end(), 0.0f);
+            std::fill(step.begin(), step.end(), 0.0f);
+        }
+
+        inline int getLineCount() { return _lineCount; }
+        inline int getSize() { return _size; }
+        inline size_t getMemoryUsage() { return data.size(); }
+
+        // Store a spectrum of getSize() bins
+        void write(int lineId, const float* spectrum) {
+            // Max decimation, level 0 is used as is when there is none
+            const float* src = spectrum;
+            if (_decimation > 1) {
+                for (int i = 0; i < _levelSizes[0]; i++) {
+                    int start = i * _decimation;
+                    int end = std::min<int>(start + _decimation, _size);
+                    float m = spectrum[start];
+                    for (int j = start + 1; j < end; j++) { m = std::max<float>(m, spectrum[j]); }
+                    decimated[i] = m;
+                }
+                src = decimated.data();
+            }
+
+            uint8_t* dst = line(lineId);
+            if (_format == HISTORY_FLOAT32) {
+                memcpy(dst, src, _levelSizes[0] * sizeof(float));
+                buildMips((float*)dst);
+                return;
+            }
+
+            // Quantized over the range of the line
+            if (_format == HISTORY_UINT16) {
+                math::quantizeDB(src, (uint16_t*)dst, _levelSizes[0], lo[lineId], step[lineId]);
+                buildMips((uint16_t*)dst);
+            }
+            else {
+                math::quantizeDB(src, dst, _levelSizes[0], lo[lineId], step[lineId]);
+                buildMips(dst);
+            }
+        }
+
+        // Bins of level 0 in dB
+        void read(int lineId, float* out) {
+            const uint8_t* src = line(lineId);
+            if (_format == HISTORY_FLOAT32) {
+                memcpy(out, src, _levelSizes[0] * sizeof(float));
+                return;
+            }
+            if (_format == HISTORY_UINT16) {
+                math::dequantizeDB((const uint16_t*)src, out, _levelSizes[0], lo[lineId], step[lineId]);
+            }
+            else {
+                math::dequantizeDB(src, out, _levelSizes[0], lo[lineId], step[lineId]);
+            }
+        }
+
+        // Configure a zoom for a range of bins of the full resolution spectrum. Returns the level to pass to zoom().
+        int prepareZoom(math::BinZoom& zoom, int offset, int width, int outSize, math::ZoomMode mode) {
+            // Coarsest level that still has enough bins per point
+            int level = 0;
+            if (mode == math::ZOOM_MAX) {
+                while (level + 1 < (int)_levelSizes.size() && (width / (_decimation << (level + 1))) >= outSize * SPECTRUM_HISTORY_MIP_BINS_PER_POINT) { level++; }
+            }
+            int factor = _decimation << level;
+            int levelSize = _levelSizes[level];
+            zoom.configure(std::max<int>(offset, 0) / factor, std::max<int>(width / factor, 1), levelSize, outSize);
+            return level;
+        }
+
+        // Zoom a line at the level given by prepareZoom()
+        void zoom(math::BinZoom& zoom, int lineId, int level, float* out, math::ZoomMode mode) {
+            const uint8_t* src = line(lineId) + _levelOffsets[level] * bytesPerBin();
+            switch (_format) {
+                case HISTORY_FLOAT32:   zoom.process((const float*)src, out, mode); break;
+                case HISTORY_UINT16:    zoom.process((const uint16_t*)src, out, mode, lo[lineId], step[lineId]); break;
+                case HISTORY_UINT8:     zoom.process(src, out, mode, lo[lineId], step[lineId]); break;
+            }
+        }
+
+    private:
+        void setup(int lineCount, int size, HistoryFormat format, int decimation, bool mips) {
+            _lineCount = std::max<int>(lineCount, 0);
+            _size = std::max<int>(size, 0);
+            _format = format;
+            _decimation = std::max<int>(decimation, 1);
+            _mips = mips;
+
+            // Level sizes and their place in a line
+            _levelSizes.clear();
+            _levelOffsets.clear();
+            int levelSize = (_size + _decimation - 1) / _decimation;
+            int offset = 0;
+            do {
+                _levelSizes.push_back(levelSize);
+                _levelOffsets.push_back(offset);
+                offset += levelSize;
+                levelSize = (levelSize + 1) / 2;
+            } while (_mips && levelSize >= SPECTRUM_HISTORY_MIN_MIP_SIZE);
+            _lineBytes = (size_t)offset * bytesPerBin();
+
+            data.assign(_lineBytes * _lineCount, 0);
+            lo.assign(_lineCount, 0.0f);
+            step.assign(_lineCount, 0.0f);
+            decimated.resize((_decimation > 1) ? _levelSizes[0] : 0);
+        }
+
+        inline size_t bytesPerBin() {
+            switch (_format) {
+                case HISTORY_UINT16:    return sizeof(uint16_t);
+                case HISTORY_UINT8:     return sizeof(uint8_t);
+                default:                return sizeof(float);
+            }
+        }
+
+        inline uint8_t* line(int lineId) { return &data[(size_t)lineId * _lineBytes]; }
+
+        // Each level is the max of pairs of bins of the previous one
+        template <class T>
+        void buildMips(T* bins) {
+            for (int l = 1; l < (int)_levelSizes.size(); l++) {
+                const T* prev = &bins[_levelOffsets[l - 1]];
+                T* cur = &bins[_levelOffsets[l]];
+                int prevSize = _levelSizes[l - 1];
+                for (int i = 0; i < _levelSizes[l]; i++) {
+                    cur[i] = (2 * i + 1 < prevSize) ? std::max<T>(prev[2 * i], prev[2 * i + 1]) : prev[2 * i];
+                }
+            }
+        }
+
+        int _lineCount = 0;
+        int _size = 0;
+        HistoryFormat _format = HISTORY_FLOAT32;
+        int _decimation = 1;
+        bool _mips = false;
+
+        std::vector<int> _levelSizes;
+        std::vector<int> _levelOffsets;
+        size_t _lineBytes = 0;
+        std::vector<uint8_t> data;
+        std::vector<float> lo;
+        std::vector<float> step;
+        std::vector<float> decimated;
+    };
+}
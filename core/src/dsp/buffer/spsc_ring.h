@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace dsp::buffer {
+    // Lock free ring of N slots between one producer and one consumer thread. The producer never waits, when the ring
+    // is full it takes back the oldest slot still queued so that the consumer always gets the newest ones, the slots
+    // taken back are counted as dropped. Up to N - 1 slots are queued, the last one being left to the consumer while
+    // it reads. Slots are reused in place, so anything they own is only allocated on the first lap.
+    template <class T, int N>
+    class SPSCRing {
+        static_assert(N > 1 && (N & (N - 1)) == 0, "The slot count must be a power of two");
+    public:
+        SPSCRing() {}
+
+        // Producer side, the slot to fill. NULL, and counted as dropped, only if it's still the one being read, which
+        // takes the producer lapping the consumer while it reads a single slot.
+        T* beginWrite() {
+            uint32_t w = writeCur.load(std::memory_order_relaxed);
+
+            // Make room by dropping the oldest slot, unless the consumer takes it first
+            uint32_t r = readCur.load();
+            while (w - r >= (uint32_t)(N - 1)) {
+                if (readCur.compare_exchange_weak(r, r + 1)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    r++;
+                }
+            }
+
+            uint64_t c = reading.load();
+            if (c != NOT_READING && !((w - (uint32_t)c) % N)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            }
+            return &slots[w % N];
+        }
+
+        void endWrite() {
+            writeCur.store(writeCur.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Consumer side, the oldest filled slot or NULL if there is none. The slot is the consumer's until endRead().
+        T* beginRead() {
+            uint32_t r = readCur.load();
+            while (r != writeCur.load(std::memory_order_acquire)) {
+                // Announced before taking it so that the producer doesn't reuse it, it may have been dropped meanwhile
+                reading.store(r);
+                if (readCur.compare_exchange_weak(r, r + 1)) { return &slots[r % N]; }
+            }
+            reading.store(NOT_READING);
+            return NULL;
+        }
+
+        void endRead() {
+            reading.store(NOT_READING);
+        }
+
+        inline uint64_t getDropped() { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint64_t NOT_READING = UINT64_MAX;
+
+        T slots[N];
+
+        // On their own cache lines so that both sides don't keep taking the line from each other. The read cursor is
+        // moved by both sides, by the producer when dropping.
+        alignas(64) std::atomic<uint32_t> writeCur = 0;
+        alignas(64) std::atomic<uint32_t> readCur = 0;
+        std::atomic<uint64_t> reading = NOT_READING;    // Cursor of the slot being read
+        std::atomic<uint64_t> dropped = 0;
+    };
+}
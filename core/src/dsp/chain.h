@@ -2,6 +2,7 @@
 #include <vector>
 #include <map>
 #include "processor.h"
+#include "fused_processor.h"
 
 namespace dsp {
     template<class T>
@@ -14,11 +15,17 @@ namespace dsp {
         void init(stream<T>* in) {
             _in = in;
             out = _in;
+            runner.init(_in);
         }
 
         template<typename Func>
         void setInput(stream<T>* in, Func onOutputChange) {
             _in = in;
+            if (fused) {
+                runner.setInput(_in);
+                updateFused(onOutputChange);
+                return;
+            }
             for (auto& ln : links) {
                 if (states[ln]) {
                     ln->setInput(_in);
@@ -38,6 +45,7 @@ namespace dsp {
             // Add to the list
             links.push_back(block);
             states[block] = false;
+            if (fused) { block->setFusedHost(&runner); }
 
             // Enable if needed
             if (enabled) { enableBlock(block, [](stream<T>* out){}); }
@@ -54,6 +62,7 @@ namespace dsp {
             disableBlock(block, onOutputChange);
         
             // Remove block from the list
+            if (fused) { block->setFusedHost(NULL); }
             states.erase(block);
             links.erase(std::find(links.begin(), links.end(), block));
         }
@@ -68,6 +77,13 @@ namespace dsp {
             // If already enable, don't do anything
             if (states[block]) { return; }
 
+            // If fused, just update the list of blocks run by the fused processor
+            if (fused) {
+                states[block] = true;
+                updateFused(onOutputChange);
+                return;
+            }
+
             // Gather blocks before and after the block to enable
             Processor<T, T>* before = blockBefore(block);
             Processor<T, T>* after = blockAfter(block);
@@ -99,6 +115,13 @@ namespace dsp {
             // If already disabled, don't do anything
             if (!states[block]) { return; }
 
+            // If fused, just update the list of blocks run by the fused processor
+            if (fused) {
+                states[block] = false;
+                updateFused(onOutputChange);
+                return;
+            }
+
             // Stop disabled block
             block->stop();
             states[block] = false;
@@ -141,8 +164,49 @@ namespace dsp {
             }
         }
 
+        // Run all enabled blocks inline on a single thread instead of one thread per block.
+        // All blocks of the chain must be fusable.
+        template<typename Func>
+        void setFused(bool enabled, Func onOutputChange) {
+            if (enabled == fused) { return; }
+            for (auto& ln : links) {
+                if (enabled && !ln->fusable()) {
+                    throw std::runtime_error("[chain] Tried to fuse a chain containing a block that doesn't support it");
+                }
+            }
+
+            // Stop everything while switching modes
+            bool wasRunning = running;
+            stop();
+
+            // Hand over the blocks to the fused processor or take them back
+            fused = enabled;
+            for (auto& ln : links) {
+                ln->setFusedHost(fused ? &runner : NULL);
+            }
+            if (fused) {
+                runner.setInput(_in);
+                updateFused(onOutputChange);
+            }
+            else {
+                runner.setBlocks({});
+                relink(onOutputChange);
+            }
+
+            if (wasRunning) { start(); }
+        }
+
+        bool isFused() {
+            return fused;
+        }
+
         void start() {
             if (running) { return; }
+            if (fused) {
+                if (out != _in) { runner.start(); }
+                running = true;
+                return;
+            }
             for (auto& ln : links) {
                 if (!states[ln]) { continue; }
                 ln->start();
@@ -152,6 +216,11 @@ namespace dsp {
 
         void stop() {
             if (!running) { return; }
+            if (fused) {
+                runner.stop();
+                running = false;
+                return;
+            }
             for (auto& ln : links) {
                 if (!states[ln]) { continue; }
                 ln->stop();
@@ -162,11 +231,48 @@ namespace dsp {
         stream<T>* out;
 
     private:
+        template<typename Func>
+        void updateFused(Func onOutputChange) {
+            // Give the list of enabled blocks to the fused processor
+            std::vector<Processor<T, T>*> enabled;
+            for (auto& ln : links) {
+                if (states[ln]) { enabled.push_back(ln); }
+            }
+            runner.setBlocks(enabled);
+
+            // Only run the fused processor if there is something to do
+            stream<T>* newOut = enabled.empty() ? _in : &runner.out;
+            if (running) {
+                if (enabled.empty()) { runner.stop(); }
+                else { runner.start(); }
+            }
+            if (newOut != out) {
+                out = newOut;
+                onOutputChange(out);
+            }
+        }
+
+        template<typename Func>
+        void relink(Func onOutputChange) {
+            // Reconnect the enabled blocks to each other
+            stream<T>* last = _in;
+            for (auto& ln : links) {
+                if (!states[ln]) { continue; }
+                ln->setInput(last);
+                last = &ln->out;
+            }
+            if (last != out) {
+                out = last;
+                onOutputChange(out);
+            }
+        }
+
         Processor<T, T>* blockBefore(Processor<T, T>* block) {
-            // TODO: This is wrong and must be fixed when I get more time
+            // Find the last enabled block before the given one
+            Processor<T, T>* before = NULL;
             for (auto& ln : links) {
-                if (ln == block) { return NULL; }
-                if (states[ln]) { return ln; }
+                if (ln == block) { return before; }
+                if (states[ln]) { before = ln; }
             }
             return NULL;
         }
@@ -190,6 +296,8 @@ namespace dsp {
         stream<T>* _in;
         std::vector<Processor<T, T>*> links;
         std::map<Processor<T, T>*, bool> states;
+        FusedProcessor<T> runner;
+        bool fused = false;
         bool running = false;
     };
 }
\ No newline at end of file
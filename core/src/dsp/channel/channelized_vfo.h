@@ -0,0 +1,181 @@
+#pragma once
+#include <numeric>
+#include "rx_vfo.h"
+#include "pfb_channelizer.h"
+#include "multi_xlator.h"
+#include "../routing/splitter.h"
+
+namespace dsp::channel {
+    // VFO that takes its input from the channel of a channelizer that contains it, or from the full rate IQ when no
+    // channel does. The RxVFO then only does the fine tuning and resampling at the rate of the channel.
+    // With a MultiXlator, the full rate IQ is read already translated from it instead of being translated by the VFO.
+    // The input stream is owned by the caller and is bound to the splitter, channelizer or xlator by the VFO.
+    class ChannelizedVFO : public RxVFO {
+        using base_type = RxVFO;
+    public:
+        ChannelizedVFO() {}
+
+        ChannelizedVFO(stream<complex_t>* in, routing::Splitter<complex_t>* split, PFBChannelizer* channelizer, double inSamplerate, double outSamplerate, double bandwidth, double offset, MultiXlator* xlator = NULL) {
+            init(in, split, channelizer, inSamplerate, outSamplerate, bandwidth, offset, xlator);
+        }
+
+        ~ChannelizedVFO() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            std::lock_guard<std::mutex> lck(routeMtx);
+            detach();
+        }
+
+        void init(stream<complex_t>* in, routing::Splitter<complex_t>* split, PFBChannelizer* channelizer, double inSamplerate, double outSamplerate, double bandwidth, double offset, MultiXlator* xlator = NULL) {
+            _split = split;
+            _channelizer = channelizer;
+            _xlator = xlator;
+            _fullSamplerate = inSamplerate;
+            _vfoOffset = offset;
+            base_type::init(in, inSamplerate, outSamplerate, bandwidth, offset);
+            route();
+        }
+
+        // NULL to always use the full rate IQ
+        void setChannelizer(PFBChannelizer* channelizer) {
+            assert(base_type::_block_init);
+            _channelizer = channelizer;
+            route();
+        }
+
+        // NULL to translate the full rate IQ in the VFO
+        void setXlator(MultiXlator* xlator) {
+            assert(base_type::_block_init);
+            _xlator = xlator;
+            route();
+        }
+
+        // Channel the VFO is reading from, -1 if it's reading the full rate IQ
+        int getChannel() {
+            return boundChannel;
+        }
+
+        void setInSamplerate(double inSamplerate) {
+            assert(base_type::_block_init);
+            _fullSamplerate = inSamplerate;
+            route();
+        }
+
+        void setOutSamplerate(double outSamplerate, double bandwidth) {
+            assert(base_type::_block_init);
+            base_type::setOutSamplerate(outSamplerate, bandwidth);
+            route();
+        }
+
+        void setBandwidth(double bandwidth) {
+            assert(base_type::_block_init);
+            base_type::setBandwidth(bandwidth);
+            route();
+        }
+
+        void setOffset(double offset) {
+            assert(base_type::_block_init);
+            _vfoOffset = offset;
+            route();
+        }
+
+    protected:
+        void route() {
+            std::lock_guard<std::mutex> lck(routeMtx);
+
+            // Pick the channel containing the whole bandwidth of the VFO
+            int channel = -1;
+            if (_channelizer) {
+                channel = _channelizer->findChannel(_vfoOffset, base_type::_bandwidth);
+                if (channel >= 0 && !simpleRatio(_channelizer->getChannelSamplerate(), base_type::_outSamplerate)) { channel = -1; }
+            }
+            MultiXlator* xlator = (channel >= 0) ? NULL : _xlator;
+            double samplerate = (channel >= 0) ? _channelizer->getChannelSamplerate() : _fullSamplerate;
+            double offset = (channel >= 0) ? (_vfoOffset - _channelizer->getChannelOffset(channel)) : _vfoOffset;
+
+            // Staying on the same input only needs a retune
+            bool rebind = (channel != boundChannel || (channel >= 0 && _channelizer != boundChannelizer) || xlator != boundXlator);
+            if (!rebind && samplerate == base_type::_inSamplerate) {
+                if (xlator) {
+                    xlator->setOffset(base_type::_in, -offset, samplerate);
+                }
+                else {
+                    base_type::setOffset(offset);
+                }
+                return;
+            }
+
+            // The producers lock the VFO when resizing its input so they must be called without holding its lock
+            if (rebind) { detach(); }
+            {
+                std::lock_guard<std::recursive_mutex> lck2(base_type::ctrlMtx);
+                base_type::tempStop();
+
+                // Drop what's left from the previous input, it's at the wrong samplerate
+                if (rebind && base_type::_in->readable()) { base_type::_in->flush(); }
+
+                base_type::_offset = offset;
+                base_type::xlate = !xlator;
+                base_type::setInSamplerate(samplerate);
+                base_type::tempStart();
+            }
+            if (rebind) {
+                attach(channel, xlator, -offset, samplerate);
+            }
+            else if (xlator) {
+                xlator->setOffset(base_type::_in, -offset, samplerate);
+            }
+        }
+
+        // Channel samplerates that don't reduce to a small ratio with the output samplerate would need a huge resampler
+        static bool simpleRatio(double inSamplerate, double outSamplerate) {
+            if (inSamplerate != round(inSamplerate) || outSamplerate != round(outSamplerate)) { return false; }
+            int gcd = std::gcd((int)inSamplerate, (int)outSamplerate);
+            return ((int)outSamplerate / gcd) <= MAX_INTERPOLATION;
+        }
+
+        void attach(int channel, MultiXlator* xlator, double xlatorOffset, double samplerate) {
+            if (channel >= 0) {
+                _channelizer->bindChannel(channel, base_type::_in);
+                boundChannelizer = _channelizer;
+            }
+            else if (xlator) {
+                xlator->bindOutput(base_type::_in, xlatorOffset, samplerate);
+                boundXlator = xlator;
+            }
+            else {
+                _split->bindStream(base_type::_in, true);
+            }
+            boundChannel = channel;
+        }
+
+        void detach() {
+            if (boundChannel >= 0) {
+                boundChannelizer->unbindChannel(base_type::_in);
+            }
+            else if (boundXlator) {
+                boundXlator->unbindOutput(base_type::_in);
+            }
+            else if (boundChannel == -1) {
+                _split->unbindStream(base_type::_in);
+            }
+            boundChannel = UNBOUND;
+            boundChannelizer = NULL;
+            boundXlator = NULL;
+        }
+
+        static constexpr int UNBOUND = -2;
+        static constexpr int MAX_INTERPOLATION = 64;
+
+        routing::Splitter<complex_t>* _split;
+        PFBChannelizer* _channelizer;
+        MultiXlator* _xlator = NULL;
+        double _fullSamplerate;
+        double _vfoOffset;
+
+        int boundChannel = UNBOUND;
+        PFBChannelizer* boundChannelizer = NULL;
+        MultiXlator* boundXlator = NULL;
+        std::mutex routeMtx;
+    };
+}
@@ -49,6 +49,10 @@ namespace dsp::channel {
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         virtual int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include "../sink.h"
+#include "../math/rotator.h"
+#include "../math/hz_to_rads.h"
+
+// Samples translated to every output before moving on to the next ones, the tile of input stays in L1 cache meanwhile
+#define MULTI_XLATOR_TILE_SIZE  512
+
+namespace dsp::channel {
+    // Translates one input to any number of outputs, each with its own offset, in a single pass. The input is read
+    // tile by tile and each tile is rotated to every output while it's in cache, instead of one translator per output
+    // reading the whole buffer in turn. The phase of each output is kept in double precision and the phasor is
+    // recomputed from it for every tile, so the single precision rotation never drifts in phase or amplitude.
+    class MultiXlator : public Sink<complex_t>, public stream_resize_listener {
+        using base_type = Sink<complex_t>;
+    public:
+        MultiXlator() {}
+
+        MultiXlator(stream<complex_t>* in) { init(in); }
+
+        ~MultiXlator() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+        }
+
+        void init(stream<complex_t>* in) {
+            base_type::init(in);
+            if (in) { in->setResizeListener(this); }
+        }
+
+        void setInput(stream<complex_t>* in) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+            base_type::setInput(in);
+            if (in) { in->setResizeListener(this); }
+            base_type::tempStart();
+        }
+
+        void inputResized() {
+            // Restarting resizes the outputs
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            base_type::tempStart();
+        }
+
+        // Offset in radians per sample, the output is the input multiplied by exp(j * offset * t) like FrequencyXlator
+        void bindOutput(stream<complex_t>* stream, double offset) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            if (findOutput(stream) != outputs.end()) {
+                throw std::runtime_error("[MultiXlator] Tried to bind stream that is already bound");
+            }
+            base_type::tempStop();
+            base_type::registerOutput(stream);
+            outputs.push_back({ stream, offset, 0.0 });
+            base_type::tempStart();
+        }
+
+        void bindOutput(stream<complex_t>* stream, double offset, double samplerate) {
+            bindOutput(stream, math::hzToRads(offset, samplerate));
+        }
+
+        void unbindOutput(stream<complex_t>* stream) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            auto oit = findOutput(stream);
+            if (oit == outputs.end()) {
+                throw std::runtime_error("[MultiXlator] Tried to unbind stream that isn't bound");
+            }
+            base_type::tempStop();
+            outputs.erase(oit);
+            base_type::unregisterOutput(stream);
+            base_type::tempStart();
+        }
+
+        // Retuning keeps the phase continuous and doesn't stop the block
+        void setOffset(stream<complex_t>* stream, double offset) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            std::lock_guard<std::mutex> lck2(offsetMtx);
+            auto oit = findOutput(stream);
+            if (oit == outputs.end()) {
+                throw std::runtime_error("[MultiXlator] Tried to set the offset of a stream that isn't bound");
+            }
+            oit->offset = offset;
+        }
+
+        void setOffset(stream<complex_t>* stream, double offset, double samplerate) {
+            setOffset(stream, math::hzToRads(offset, samplerate));
+        }
+
+        int getOutputCount() {
+            return outputs.size();
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            for (auto& out : outputs) { out.phase = 0.0; }
+            base_type::tempStart();
+        }
+
+        inline int process(int count, const complex_t* in) {
+            std::lock_guard<std::mutex> lck(offsetMtx);
+            for (int i = 0; i < count; i += MULTI_XLATOR_TILE_SIZE) {
+                int n = std::min<int>(MULTI_XLATOR_TILE_SIZE, count - i);
+                for (auto& out : outputs) {
+                    complex_t phase = { (float)cos(out.phase), (float)sin(out.phase) };
+                    complex_t delta = { (float)cos(out.offset), (float)sin(out.offset) };
+                    kernel(&in[i], &out.strm->writeBuf[i], n, phase, delta);
+                    out.phase = remainder(out.phase + out.offset * (double)n, 2.0 * DB_M_PI);
+                }
+            }
+            return count;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            process(count, base_type::_in->readBuf);
+
+            base_type::_in->flush();
+            for (auto& out : outputs) {
+                if (!out.strm->swap(count)) { return -1; }
+            }
+            return count;
+        }
+
+    protected:
+        struct Output {
+            stream<complex_t>* strm;
+            double offset;
+            double phase;
+        };
+
+        std::vector<Output>::iterator findOutput(stream<complex_t>* stream) {
+            return std::find_if(outputs.begin(), outputs.end(), [stream](const Output& out) { return out.strm == stream; });
+        }
+
+        void doStart() {
+            // Every output gets as many samples as the input
+            int inSize = base_type::_in->getMaxReadSize();
+            for (const auto& out : outputs) {
+                out.strm->resize(inSize);
+            }
+            base_type::doStart();
+        }
+
+        std::vector<Output> outputs;
+        std::mutex offsetMtx;
+        math::rotator_kernel_t kernel = math::rotator::select();
+    };
+}
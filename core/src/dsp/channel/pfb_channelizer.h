@@ -0,0 +1,302 @@
+#pragma once
+#include <vector>
+#include <fftw3.h>
+#include "../sink.h"
+#include "../multirate/polyphase_bank.h"
+#include "../fft/plan_cache.h"
+#include "../taps/low_pass.h"
+
+namespace dsp::channel {
+    // Polyphase filter bank channelizer. Splits the input into channelCount evenly spaced channels of width
+    // samplerate / channelCount with a single FFT per output sample, however many channels are read.
+    // Channels are oversampled by two so that a signal near the edge of a channel is still usable in it.
+    // Channel 0 is centered on DC, channel k on k * width for k <= channelCount / 2 and on (k - channelCount) * width above.
+    class PFBChannelizer : public Sink<complex_t>, public stream_resize_listener {
+        using base_type = Sink<complex_t>;
+    public:
+        PFBChannelizer() {}
+
+        PFBChannelizer(stream<complex_t>* in, int channelCount, double samplerate) { init(in, channelCount, samplerate); }
+
+        ~PFBChannelizer() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+            destroy();
+        }
+
+        void init(stream<complex_t>* in, int channelCount, double samplerate) {
+            _samplerate = samplerate;
+            configure(channelCount);
+            base_type::init(in);
+            if (in) { in->setResizeListener(this); }
+        }
+
+        void setInput(stream<complex_t>* in) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+            base_type::setInput(in);
+            if (in) { in->setResizeListener(this); }
+            base_type::tempStart();
+        }
+
+        void inputResized() {
+            // Restarting resizes the outputs
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            base_type::tempStart();
+        }
+
+        // The filter bank only depends on the ratio of channel width to samplerate, this only changes the reported frequencies
+        void setSamplerate(double samplerate) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _samplerate = samplerate;
+        }
+
+        void setChannelCount(int channelCount) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            destroy();
+            configure(channelCount);
+            base_type::tempStart();
+        }
+
+        int getChannelCount() {
+            return _channelCount;
+        }
+
+        double getChannelWidth() {
+            return _samplerate / (double)_channelCount;
+        }
+
+        double getChannelSamplerate() {
+            return _samplerate / (double)decimation;
+        }
+
+        double getChannelOffset(int channel) {
+            int k = (channel <= _channelCount / 2) ? channel : (channel - _channelCount);
+            return (double)k * getChannelWidth();
+        }
+
+        // Channel that fully contains a signal of the given bandwidth at the given offset, -1 if there is none
+        int findChannel(double offset, double bandwidth) {
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            double width = getChannelWidth();
+            int k = (int)round(offset / width);
+            if (k > _channelCount / 2 || k <= -_channelCount / 2) { return -1; }
+            if (fabs(offset - ((double)k * width)) + (bandwidth / 2.0) > PASSBAND * width) { return -1; }
+            return (k >= 0) ? k : (k + _channelCount);
+        }
+
+        void bindChannel(int channel, stream<complex_t>* stream) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            if (channel < 0 || channel >= _channelCount) {
+                throw std::runtime_error("[PFBChannelizer] Tried to bind stream to a channel that doesn't exist");
+            }
+            if (findOutput(stream) != outputs.end()) {
+                throw std::runtime_error("[PFBChannelizer] Tried to bind stream that is already bound");
+            }
+            base_type::tempStop();
+            base_type::registerOutput(stream);
+            outputs.push_back({ stream, channel });
+            base_type::tempStart();
+        }
+
+        void unbindChannel(stream<complex_t>* stream) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            auto oit = findOutput(stream);
+            if (oit == outputs.end()) {
+                throw std::runtime_error("[PFBChannelizer] Tried to unbind stream that isn't bound");
+            }
+            base_type::tempStop();
+            outputs.erase(oit);
+            base_type::unregisterOutput(stream);
+            base_type::tempStart();
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            if (buffer) { buffer::clear(buffer, windowSize - 1); }
+            offset = 0;
+            phase = 0;
+            base_type::tempStart();
+        }
+
+        size_t getMemoryUsage() {
+            return ((size_t)bufferCapacity + windowSize + windowSize + _channelCount + _channelCount) * sizeof(complex_t) +
+                   (size_t)(2 * _channelCount) * sizeof(fftwf_complex) + (size_t)windowSize * sizeof(float);
+        }
+
+        inline int process(int count, const complex_t* in) {
+            // Copy data to work buffer
+            memcpy(bufStart, in, count * sizeof(complex_t));
+
+            int outCount = 0;
+            for (; offset < count; offset += decimation) {
+                // Window the last windowSize samples and fold them into one sum per filter bank branch
+                volk_32fc_32f_multiply_32fc((lv_32fc_t*)work, (lv_32fc_t*)&buffer[offset], window, windowSize);
+                memcpy(fftIn, work, _channelCount * sizeof(complex_t));
+                for (int i = _channelCount; i < windowSize; i += _channelCount) {
+                    volk_32fc_x2_add_32fc((lv_32fc_t*)fftIn, (lv_32fc_t*)fftIn, (lv_32fc_t*)&work[i], _channelCount);
+                }
+                fftwf_execute(plan);
+
+                // The FFT sees the window as starting at time zero, bring each bin back to the absolute phase of the
+                // channel's carrier so that the output is continuous from one output sample to the next
+                int t = (phase + offset + 1) % _channelCount;
+                complex_t* bins = (complex_t*)fftOut;
+                for (auto& out : outputs) {
+                    out.strm->writeBuf[outCount] = bins[out.channel] * rotation[(out.channel * t) % _channelCount];
+                }
+                outCount++;
+            }
+            offset -= count;
+            phase = (phase + count) % _channelCount;
+
+            // Move unused data
+            memmove(buffer, &buffer[count], (windowSize - 1) * sizeof(complex_t));
+
+            return outCount;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf);
+
+            base_type::_in->flush();
+            if (outCount) {
+                for (auto& out : outputs) {
+                    if (!out.strm->swap(outCount)) { return -1; }
+                }
+            }
+            return count;
+        }
+
+    protected:
+        // Fraction of the channel width that is free of aliasing at the output rate
+        static constexpr double PASSBAND = 0.8;
+
+        struct Output {
+            stream<complex_t>* strm;
+            int channel;
+        };
+
+        std::vector<Output>::iterator findOutput(stream<complex_t>* stream) {
+            return std::find_if(outputs.begin(), outputs.end(), [stream](const Output& out) { return out.strm == stream; });
+        }
+
+        void configure(int channelCount) {
+            if (channelCount < 2 || (channelCount % 2)) {
+                throw std::runtime_error("[PFBChannelizer] Channel count must be even");
+            }
+            _channelCount = channelCount;
+            decimation = _channelCount / 2;
+
+            // Prototype filter, flat up to PASSBAND and stopped before 2 - PASSBAND channel widths at the output rate
+            double width = 1.0 / (double)_channelCount;
+            tap<float> proto = taps::lowPass(width, (1.0 - PASSBAND) * 2.0 * width, 1.0);
+            multirate::PolyphaseBank<float> bank = multirate::buildPolyphaseBank<float>(_channelCount, proto);
+            taps::free(proto);
+
+            // Flatten the bank into the window applied to the buffer, oldest sample first. Branch p of the bank filters the
+            // inputs at position p modulo channelCount, laid out this way all branches run as one contiguous multiply and fold.
+            windowSize = bank.phaseCount * bank.tapsPerPhase;
+            window = buffer::alloc<float>(windowSize);
+            for (int i = 0; i < windowSize; i++) {
+                window[i] = bank.phases[i % _channelCount][bank.tapsPerPhase - 1 - (i / _channelCount)];
+            }
+            multirate::freePolyphaseBank(bank);
+
+            rotation = buffer::alloc<complex_t>(_channelCount);
+            for (int i = 0; i < _channelCount; i++) {
+                double ph = -2.0 * DB_M_PI * (double)i / (double)_channelCount;
+                rotation[i] = { (float)cos(ph), (float)sin(ph) };
+            }
+
+            work = buffer::alloc<complex_t>(windowSize);
+            fftIn = (fftwf_complex*)fftwf_malloc(_channelCount * sizeof(fftwf_complex));
+            fftOut = (fftwf_complex*)fftwf_malloc(_channelCount * sizeof(fftwf_complex));
+            {
+                std::lock_guard<std::mutex> lck(fft::plannerMtx());
+                plan = fftwf_plan_dft_1d(_channelCount, fftIn, fftOut, FFTW_FORWARD, FFTW_ESTIMATE);
+            }
+
+            // The work buffer is sized by doStart() from the input, nothing is held while the channelizer isn't used
+            bufferCapacity = 0;
+            offset = 0;
+            phase = 0;
+        }
+
+        // Make room in the work buffer for an input of the given size, keeping the history
+        void reserve(int size) {
+            if (size <= bufferCapacity) { return; }
+            complex_t* newBuffer = buffer::alloc<complex_t>(size + windowSize);
+            if (buffer) {
+                memcpy(newBuffer, buffer, (windowSize - 1) * sizeof(complex_t));
+                buffer::free(buffer);
+            }
+            else {
+                buffer::clear(newBuffer, windowSize - 1);
+            }
+            buffer = newBuffer;
+            bufStart = &buffer[windowSize - 1];
+            bufferCapacity = size;
+        }
+
+        void destroy() {
+            if (!window) { return; }
+            {
+                std::lock_guard<std::mutex> lck(fft::plannerMtx());
+                fftwf_destroy_plan(plan);
+            }
+            fftwf_free(fftIn);
+            fftwf_free(fftOut);
+            buffer::free(window);
+            buffer::free(rotation);
+            buffer::free(work);
+            buffer::free(buffer);
+            window = NULL;
+            buffer = NULL;
+        }
+
+        void doStart() {
+            // Every output gets one sample per decimation input samples
+            int inSize = base_type::_in->getMaxReadSize();
+            reserve(inSize);
+            for (const auto& out : outputs) {
+                out.strm->resize((inSize / decimation) + 1);
+            }
+            base_type::doStart();
+        }
+
+        std::vector<Output> outputs;
+
+        int _channelCount = 0;
+        int decimation = 0;
+        double _samplerate = 0.0;
+
+        int windowSize = 0;
+        float* window = NULL;
+        complex_t* rotation = NULL;
+        complex_t* work = NULL;
+        complex_t* buffer = NULL;
+        complex_t* bufStart = NULL;
+        int bufferCapacity = 0;
+        fftwf_complex* fftIn = NULL;
+        fftwf_complex* fftOut = NULL;
+        fftwf_plan plan;
+
+        int offset = 0;
+        int phase = 0;      // Absolute index modulo channelCount of the first sample of the next input buffer
+    };
+}
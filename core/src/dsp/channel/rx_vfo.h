@@ -22,17 +22,16 @@ namespace dsp::channel {
             _bandwidth = bandwidth;
             _offset = offset;
             filterNeeded = (_bandwidth != _outSamplerate);
-            ftaps.taps = NULL;
 
             xlator.init(NULL, -_offset, _inSamplerate);
             resamp.init(NULL, _inSamplerate, _outSamplerate);
-            generateTaps();
+            ftaps = generateTaps(_bandwidth, _outSamplerate);
             filter.init(NULL, ftaps);
 
             base_type::init(in);
         }
 
-        void setInSamplerate(double inSamplerate) {
+        virtual void setInSamplerate(double inSamplerate) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
@@ -42,34 +41,60 @@ namespace dsp::channel {
             base_type::tempStart();
         }
 
-        void setOutSamplerate(double outSamplerate, double bandwidth) {
+        virtual void setOutSamplerate(double outSamplerate, double bandwidth) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+
+            // Plan the filter before stopping the VFO, the planner may be busy with a measurement
+            bool needed = (bandwidth != outSamplerate);
+            tap<float> newTaps;
+            if (needed) {
+                newTaps = generateTaps(bandwidth, outSamplerate);
+                filter.prepareTaps(newTaps);
+            }
+
             base_type::tempStop();
             _outSamplerate = outSamplerate;
             _bandwidth = bandwidth;
-            filterNeeded = (_bandwidth != _outSamplerate);
+            filterNeeded = needed;
             resamp.setOutSamplerate(_outSamplerate);
             if (filterNeeded) {
-                generateTaps();
-                filter.setTaps(ftaps);
+                filter.setTaps(newTaps);
+                std::swap(ftaps, newTaps);
             }
             base_type::tempStart();
+
+            filter.releaseTaps();
+            taps::free(newTaps);
         }
 
-        void setBandwidth(double bandwidth) {
+        virtual void setBandwidth(double bandwidth) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
-            std::lock_guard<std::mutex> lck2(filterMtx);
-            _bandwidth = bandwidth;
-            filterNeeded = (_bandwidth != _outSamplerate);
-            if (filterNeeded) {
-                generateTaps();
-                filter.setTaps(ftaps);
+
+            // Plan the filter before taking the lock of the DSP thread, the planner may be busy with a measurement
+            bool needed = (bandwidth != _outSamplerate);
+            tap<float> newTaps;
+            if (needed) {
+                newTaps = generateTaps(bandwidth, _outSamplerate);
+                filter.prepareTaps(newTaps);
             }
+
+            {
+                std::lock_guard<std::mutex> lck2(filterMtx);
+                _bandwidth = bandwidth;
+                filterNeeded = needed;
+                if (filterNeeded) {
+                    filter.setTaps(newTaps);
+                    std::swap(ftaps, newTaps);
+                }
+            }
+
+            filter.releaseTaps();
+            taps::free(newTaps);
         }
 
-        void setOffset(double offset) {
+        virtual void setOffset(double offset) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             _offset = offset;
@@ -87,11 +112,15 @@ namespace dsp::channel {
         }
 
         inline int process(int count, const complex_t* in, complex_t* out) {
-            xlator.process(count, in, out);
+            // The input may already be translated, by a MultiXlator shared with other VFOs
+            if (xlate) {
+                xlator.process(count, in, out);
+                in = out;
+            }
             if (!filterNeeded) {
-                return resamp.process(count, out, out);
+                return resamp.process(count, in, out);
             }
-            count = resamp.process(count, out, out);
+            count = resamp.process(count, in, out);
             {
                 std::lock_guard<std::mutex> lck(filterMtx);
                 filter.process(count, out, out);
@@ -99,6 +128,22 @@ namespace dsp::channel {
             return count;
         }
 
+        int maxOutputSize(int maxInputSize) {
+            // The xlator output is stored in the output buffer before resampling
+            return std::max<int>(maxInputSize, resamp.maxOutputSize(maxInputSize));
+        }
+
+        void reserve(int maxInputSize) {
+            // The filter works on the output of the resampler
+            resamp.reserve(maxInputSize);
+            filter.reserve(resamp.maxOutputSize(maxInputSize));
+        }
+
+        size_t getMemoryUsage() {
+            // The inner blocks aren't started, they're reported along with the VFO
+            return resamp.getMemoryUsage() + filter.getMemoryUsage();
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -114,10 +159,9 @@ namespace dsp::channel {
         }
 
     protected:
-        void generateTaps() {
-            taps::free(ftaps);
-            double filterWidth = _bandwidth / 2.0;
-            ftaps = taps::lowPass(filterWidth, filterWidth * 0.1, _outSamplerate);
+        static tap<float> generateTaps(double bandwidth, double outSamplerate) {
+            double filterWidth = bandwidth / 2.0;
+            return taps::lowPass(filterWidth, filterWidth * 0.1, outSamplerate);
         }
 
         FrequencyXlator xlator;
@@ -125,6 +169,7 @@ namespace dsp::channel {
         filter::FIR<complex_t, float> filter;
         tap<float> ftaps;
         bool filterNeeded;
+        bool xlate = true;
 
         double _inSamplerate;
         double _outSamplerate;
@@ -149,6 +149,11 @@ namespace dsp::clock_recovery {
             return outCount;
         }
 
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return (STREAM_BUFFER_SIZE + _interpTapCount) * sizeof(float);
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
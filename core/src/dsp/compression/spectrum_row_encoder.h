@@ -0,0 +1,133 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <zstd.h>
+#include "../math/quantize_db.h"
+
+namespace dsp::compression {
+    enum SpectrumRowFormat {
+        SPECTRUM_ROW_UINT8,
+        SPECTRUM_ROW_UINT16
+    };
+
+#pragma pack(push, 1)
+    // A row is this header followed by width quantized values, zstd compressed if compressed is set.
+    // Values are converted back to dB as lo + value * step.
+    struct SpectrumRowHeader {
+        uint32_t width;
+        uint16_t format;
+        uint16_t compressed;
+        float lo;
+        float step;
+    };
+#pragma pack(pop)
+
+    // Quantizes rows of a spectrum in dB over the range of each row to send them over thin links
+    class SpectrumRowEncoder {
+    public:
+        SpectrumRowEncoder() {}
+
+        ~SpectrumRowEncoder() {
+            if (cctx) { ZSTD_freeCCtx(cctx); }
+        }
+
+        // Room needed to encode a row of width values
+        static inline size_t getMaxSize(int width) {
+            return sizeof(SpectrumRowHeader) + ZSTD_compressBound(width * sizeof(uint16_t));
+        }
+
+        // out must have room for getMaxSize(width) bytes, returns the size of the encoded row
+        size_t encode(const float* row, int width, SpectrumRowFormat format, bool compress, uint8_t* out) {
+            SpectrumRowHeader* hdr = (SpectrumRowHeader*)out;
+            hdr->width = width;
+            hdr->format = format;
+            hdr->compressed = compress;
+
+            // Quantize straight to the output unless it gets compressed
+            size_t rawSize = width * ((format == SPECTRUM_ROW_UINT16) ? sizeof(uint16_t) : sizeof(uint8_t));
+            uint8_t* data = &out[sizeof(SpectrumRowHeader)];
+            if (compress) {
+                quantized.resize(rawSize);
+                data = quantized.data();
+            }
+            float lo, step;
+            if (format == SPECTRUM_ROW_UINT16) {
+                math::quantizeDB(row, (uint16_t*)data, width, lo, step);
+            }
+            else {
+                math::quantizeDB(row, data, width, lo, step);
+            }
+            hdr->lo = lo;
+            hdr->step = step;
+            if (!compress) { return sizeof(SpectrumRowHeader) + rawSize; }
+
+            if (!cctx) { cctx = ZSTD_createCCtx(); }
+            size_t size = ZSTD_compressCCtx(cctx, &out[sizeof(SpectrumRowHeader)], ZSTD_compressBound(rawSize), data, rawSize, 1);
+            if (ZSTD_isError(size)) {
+                // Can't happen with a big enough output, send it uncompressed anyway
+                hdr->compressed = false;
+                memcpy(&out[sizeof(SpectrumRowHeader)], data, rawSize);
+                return sizeof(SpectrumRowHeader) + rawSize;
+            }
+            return sizeof(SpectrumRowHeader) + size;
+        }
+
+    private:
+        std::vector<uint8_t> quantized;
+        ZSTD_CCtx* cctx = NULL;
+    };
+
+    // Decodes rows of SpectrumRowEncoder. Only the spectrum row tester uses it for now, sdrpp_server_source doesn't
+    // request FFT rows from the server yet.
+    class SpectrumRowDecoder {
+    public:
+        SpectrumRowDecoder() {}
+
+        ~SpectrumRowDecoder() {
+            if (dctx) { ZSTD_freeDCtx(dctx); }
+        }
+
+        // Width of an encoded row, -1 if it is invalid
+        static int getWidth(const uint8_t* in, size_t size) {
+            if (size < sizeof(SpectrumRowHeader)) { return -1; }
+            return ((const SpectrumRowHeader*)in)->width;
+        }
+
+        // row must have room for getWidth() values, returns the width or -1 if the row is invalid
+        int decode(const uint8_t* in, size_t size, float* row) {
+            if (size < sizeof(SpectrumRowHeader)) { return -1; }
+            const SpectrumRowHeader* hdr = (const SpectrumRowHeader*)in;
+            if (hdr->format != SPECTRUM_ROW_UINT8 && hdr->format != SPECTRUM_ROW_UINT16) { return -1; }
+            int width = hdr->width;
+            size_t rawSize = width * ((hdr->format == SPECTRUM_ROW_UINT16) ? sizeof(uint16_t) : sizeof(uint8_t));
+
+            const uint8_t* data = &in[sizeof(SpectrumRowHeader)];
+            size_t dataSize = size - sizeof(SpectrumRowHeader);
+            if (hdr->compressed) {
+                if (!dctx) { dctx = ZSTD_createDCtx(); }
+                raw.resize(rawSize);
+                size_t got = ZSTD_decompressDCtx(dctx, raw.data(), rawSize, data, dataSize);
+                if (ZSTD_isError(got) || got != rawSize) { return -1; }
+                data = raw.data();
+            }
+            else if (dataSize < rawSize) {
+                return -1;
+            }
+
+            if (hdr->format == SPECTRUM_ROW_UINT16) {
+                math::dequantizeDB((const uint16_t*)data, row, width, hdr->lo, hdr->step);
+            }
+            else {
+                math::dequantizeDB(data, row, width, hdr->lo, hdr->step);
+            }
+            return width;
+        }
+
+    private:
+        std::vector<uint8_t> raw;
+        ZSTD_DCtx* dctx = NULL;
+    };
+}
@@ -11,6 +11,8 @@ namespace dsp::convert {
 
         void init(stream<complex_t>* in) { base_type::init(in); }
 
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
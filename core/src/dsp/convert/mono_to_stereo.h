@@ -14,6 +14,8 @@ namespace dsp::convert {
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -26,6 +26,13 @@ namespace dsp::convert {
             return count;
         }
 
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return STREAM_BUFFER_SIZE * sizeof(float);
+        }
+
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -0,0 +1,72 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DSP_CPU_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_CPU_NEON
+#include <arm_neon.h>
+#endif
+
+// Functions using AVX2 or AVX-512 intrinsics must be marked with these so that they build without -mavx2 or -mavx512f,
+// they must only be called if cpu::hasAVX2() or cpu::hasAVX512()
+#if defined(DSP_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DSP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define DSP_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define DSP_TARGET_AVX2
+#define DSP_TARGET_AVX512
+#endif
+
+namespace dsp::cpu {
+    // Runtime detection of the instruction sets that hand written kernels are provided for.
+    // NEON is part of the aarch64 baseline so it needs no runtime check.
+    inline bool detectAVX2() {
+#if defined(DSP_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(DSP_CPU_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) { return false; }
+        __cpuid(info, 1);
+        bool fma = info[2] & (1 << 12);
+        bool osxsave = info[2] & (1 << 27);
+        if (!fma || !osxsave || (_xgetbv(0) & 6) != 6) { return false; }
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 5);
+#else
+        return false;
+#endif
+    }
+
+    inline bool hasAVX2() {
+        static const bool avx2 = detectAVX2();
+        return avx2;
+    }
+
+    // AVX-512 foundation, also requires the OS to save the AVX-512 state
+    inline bool detectAVX512() {
+        if (!hasAVX2()) { return false; }
+#if defined(DSP_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports("avx512f");
+#elif defined(DSP_CPU_X86) && defined(_MSC_VER)
+        int info[4];
+        if ((_xgetbv(0) & 0xE6) != 0xE6) { return false; }
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 16);
+#else
+        return false;
+#endif
+    }
+
+    inline bool hasAVX512() {
+        static const bool avx512 = detectAVX512();
+        return avx512;
+    }
+}
@@ -132,6 +132,16 @@ namespace dsp::demod {
             return count;
         }
 
+        size_t getMemoryUsage() {
+            return lpf.getMemoryUsage();
+        }
+
+        void reserve(int maxInputSize) {
+            lpf.reserve(maxInputSize);
+        }
+
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -214,6 +214,14 @@ namespace dsp::demod {
             return count;
         }
 
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return 3 * STREAM_BUFFER_SIZE * sizeof(float) + pilotFir.getMemoryUsage() + rtoc.getMemoryUsage() + lprDelay.getMemoryUsage() +
+                   lmrDelay.getMemoryUsage() + arFir.getMemoryUsage() + alFir.getMemoryUsage() + rdsResamp.getMemoryUsage();
+        }
+
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
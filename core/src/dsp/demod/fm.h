@@ -29,7 +29,7 @@ namespace dsp::demod {
             _highPass = highPass;
 
             demod.init(NULL, bandwidth / 2.0, _samplerate);
-            loadDummyTaps();
+            filterTaps = genDummyTaps();
             fir.init(NULL, filterTaps);
 
             // Initialize taps
@@ -49,8 +49,10 @@ namespace dsp::demod {
             base_type::tempStop();
             _samplerate = samplerate;
             demod.setDeviation(_bandwidth / 2.0, _samplerate);
-            updateFilter(_lowPass, _highPass);
             base_type::tempStart();
+
+            // The filter is swapped while running, it's planned without the demodulator stopped
+            updateFilter(_lowPass, _highPass);
         }
 
         void setBandwidth(double bandwidth) {
@@ -102,6 +104,16 @@ namespace dsp::demod {
             return count;
         }
 
+        size_t getMemoryUsage() {
+            return fir.getMemoryUsage();
+        }
+
+        void reserve(int maxInputSize) {
+            fir.reserve(maxInputSize);
+        }
+
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -115,38 +127,46 @@ namespace dsp::demod {
 
     private:
         void updateFilter(bool lowPass, bool highPass) {
-            std::lock_guard<std::mutex> lck(filterMtx);
-
-            // Update values
-            _lowPass = lowPass;
-            _highPass = highPass;
-            filtering = (lowPass || highPass);
-
-            // Free filter taps
-            dsp::taps::free(filterTaps);
-
             // Generate filter depending on low and high pass settings
-            if (_lowPass && _highPass) {
-                filterTaps = dsp::taps::bandPass<float>(300.0, _bandwidth / 2.0, 100.0, _samplerate);
+            tap<float> newTaps;
+            if (lowPass && highPass) {
+                newTaps = dsp::taps::bandPass<float>(300.0, _bandwidth / 2.0, 100.0, _samplerate);
             }
-            else if (_highPass) {
-                filterTaps = dsp::taps::highPass(300.0, 100.0, _samplerate);
+            else if (highPass) {
+                newTaps = dsp::taps::highPass(300.0, 100.0, _samplerate);
             }
-            else if (_lowPass) {
-                filterTaps = dsp::taps::lowPass(_bandwidth / 2.0, (_bandwidth / 2.0) * 0.1, _samplerate);
+            else if (lowPass) {
+                newTaps = dsp::taps::lowPass(_bandwidth / 2.0, (_bandwidth / 2.0) * 0.1, _samplerate);
             }
             else {
-                loadDummyTaps();
+                newTaps = genDummyTaps();
             }
 
-            // Set filter to use new taps
-            fir.setTaps(filterTaps);
-            fir.reset();
+            // Plan the filter before taking the lock of the DSP thread, the planner may be busy with a measurement
+            fir.prepareTaps(newTaps);
+
+            {
+                std::lock_guard<std::mutex> lck(filterMtx);
+
+                // Update values
+                _lowPass = lowPass;
+                _highPass = highPass;
+                filtering = (lowPass || highPass);
+
+                // Set filter to use new taps
+                fir.setTaps(newTaps);
+                fir.reset();
+                std::swap(filterTaps, newTaps);
+            }
+
+            // Free the old filter
+            fir.releaseTaps();
+            dsp::taps::free(newTaps);
         }
 
-        void loadDummyTaps() {
+        static tap<float> genDummyTaps() {
             float dummyTap = 1.0f;
-            filterTaps = dsp::taps::fromArray<float>(1, &dummyTap);
+            return dsp::taps::fromArray<float>(1, &dummyTap);
         }
 
         double _samplerate;
@@ -134,6 +134,14 @@ namespace dsp::demod {
             return recov.process(count, out, out);
         }
 
+        size_t getMemoryUsage() {
+            return rrc.getMemoryUsage() + recov.getMemoryUsage();
+        }
+
+        void reserve(int maxInputSize) {
+            rrc.reserve(maxInputSize);
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -1,10 +1,11 @@
 #pragma once
 #include "../processor.h"
-#include "../math/fast_atan2.h"
+#include "../math/phase_diff.h"
 #include "../math/hz_to_rads.h"
-#include "../math/normalize_phase.h"
 
 namespace dsp::demod {
+    // The phase difference between samples is the argument of each sample times the conjugate of the previous one,
+    // computed by the best SIMD kernel for the CPU
     class Quadrature : public Processor<complex_t, float> {
         using base_type = Processor<complex_t, float>;
     public:
@@ -37,20 +38,20 @@ namespace dsp::demod {
         }
 
         inline int process(int count, complex_t* in, float* out) {
-            for (int i = 0; i < count; i++) {
-                float cphase = in[i].phase();
-                out[i] = math::normalizePhase(cphase - phase) * _invDeviation;
-                phase = cphase;
-            }
+            if (count <= 0) { return count; }
+            kernel(in, last, _invDeviation, out, count);
+            last = in[count - 1];
             return count;
         }
 
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
-            phase = 0.0f;
+            last = { 1.0f, 0.0f };
         }
 
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -64,6 +65,9 @@ namespace dsp::demod {
 
     protected:
         float _invDeviation;
-        float phase = 0.0f;
+
+        // A previous sample of phase zero, like before the first sample
+        complex_t last = { 1.0f, 0.0f };
+        math::phase_diff_kernel_t kernel = math::phase_diff::select();
     };
 }
\ No newline at end of file
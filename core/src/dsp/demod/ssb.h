@@ -91,6 +91,8 @@ namespace dsp::demod {
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Number of polls done before a waiting thread is put to sleep
+#define EVENT_COUNT_SPIN_COUNT 1024
+
+namespace dsp {
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif (defined(__aarch64__) || defined(__arm__)) && !defined(_MSC_VER)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // Lets a thread wait for a condition without holding a lock on the fast path.
+    // The condition is polled for a short while before the thread is parked (futex on linux,
+    // condition variable elsewhere). The notifier must update the state the condition depends
+    // on BEFORE calling notify().
+    class EventCount {
+    public:
+        template <typename Func>
+        inline void wait(Func cond) {
+            // Spin for a short while, most hand-offs happen in this window
+            for (int i = 0; i < spinCount(); i++) {
+                if (cond()) { return; }
+                cpuRelax();
+            }
+
+            // Park until the condition becomes true
+            while (true) {
+                uint32_t key = epoch.load(std::memory_order_seq_cst);
+                waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (cond()) {
+                    waiters.fetch_sub(1, std::memory_order_seq_cst);
+                    return;
+                }
+                park(key);
+                waiters.fetch_sub(1, std::memory_order_seq_cst);
+                if (cond()) { return; }
+            }
+        }
+
+        inline void notify() {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_seq_cst)) { unpark(); }
+        }
+
+    private:
+        static inline int spinCount() {
+            // Spinning is only useful if the other side is running on another core
+            static const int count = (std::thread::hardware_concurrency() > 1) ? EVENT_COUNT_SPIN_COUNT : 0;
+            return count;
+        }
+
+        void park(uint32_t key) {
+#if defined(__linux__)
+            syscall(SYS_futex, (uint32_t*)&epoch, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+#else
+            std::unique_lock<std::mutex> lck(parkMtx);
+            parkCV.wait(lck, [=]() { return epoch.load() != key; });
+#endif
+        }
+
+        void unpark() {
+#if defined(__linux__)
+            syscall(SYS_futex, (uint32_t*)&epoch, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+#else
+            { std::lock_guard<std::mutex> lck(parkMtx); }
+            parkCV.notify_all();
+#endif
+        }
+
+        std::atomic<uint32_t> epoch = 0;
+        std::atomic<int> waiters = 0;
+#if !defined(__linux__)
+        std::mutex parkMtx;
+        std::condition_variable parkCV;
+#endif
+    };
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <fftw3.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+
+// Longest time in seconds a plan measured in the background may hold the planner. Every other block making or
+// destroying a plan waits that long at most, FFTW keeps the best plan found in that time.
+#ifndef FFT_PLAN_TIME_LIMIT
+#define FFT_PLAN_TIME_LIMIT 0.05
+#endif
+
+namespace dsp::fft {
+    enum PlanRigor {
+        PLAN_ESTIMATE,
+        PLAN_MEASURE,
+        PLAN_PATIENT
+    };
+
+    inline unsigned int rigorFlags(PlanRigor rigor) {
+        switch (rigor) {
+            case PLAN_MEASURE:  return FFTW_MEASURE;
+            case PLAN_PATIENT:  return FFTW_PATIENT;
+            default:            return FFTW_ESTIMATE;
+        }
+    }
+
+    // The FFTW planner isn't thread safe, anything creating or destroying plans must hold this
+    inline std::mutex& plannerMtx() {
+        static std::mutex mtx;
+        return mtx;
+    }
+
+    // Forward complex FFT plans shared by size. Measured plans take long to make so each one is only made once and
+    // kept until the cache is cleared, and the wisdom gathered is saved to a file to be reused by the next runs.
+    // Plans are made on buffers of the cache and must be run with fftwf_execute_dft() on buffers from fftwf_malloc().
+    // Batched plans transform count consecutive frames of size samples at once.
+    class PlanCache {
+    public:
+        ~PlanCache() {
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                stopWorker = true;
+            }
+            workerCV.notify_all();
+            if (worker.joinable()) { worker.join(); }
+            clear();
+        }
+
+        // Load the wisdom from the file and save to it whenever a measured plan is made. Returns false if nothing was loaded
+        bool setWisdomPath(const std::string& path) {
+            std::lock_guard<std::mutex> lck(plannerMtx());
+            wisdomPath = path;
+            return fftwf_import_wisdom_from_filename(wisdomPath.c_str());
+        }
+
+        // Get a plan at least as good as the rigor asks for, made if there is none yet
+        fftwf_plan get(int size, PlanRigor rigor, int count = 1) {
+            fftwf_plan plan = find(size, rigor, count);
+            if (plan) { return plan; }
+
+            // It may have been made while waiting for the planner
+            std::lock_guard<std::mutex> lck(plannerMtx());
+            plan = find(size, rigor, count);
+            if (plan) { return plan; }
+            return make(size, rigor, count, false);
+        }
+
+        // Get a plan without waiting for a measurement. Until the plan of the rigor is made in the background, the best
+        // plan made so far is returned, an estimated one if there is none. getGeneration() changes once it's ready.
+        fftwf_plan request(int size, PlanRigor rigor, int count = 1) {
+            fftwf_plan plan = find(size, rigor, count);
+            if (plan) { return plan; }
+
+            // Estimate first so that the planner isn't already busy measuring
+            plan = get(size, PLAN_ESTIMATE, count);
+            if (rigor == PLAN_ESTIMATE) { return plan; }
+
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                auto key = std::make_tuple(size, count, (int)rigor);
+                if (pending.find(key) != pending.end()) { return plan; }
+                pending.insert(key);
+                jobs.push_back(key);
+                if (!worker.joinable()) { worker = std::thread(&PlanCache::workerLoop, this); }
+            }
+            workerCV.notify_all();
+            return plan;
+        }
+
+        // Best plan already made that is at least as good as the rigor asks for, NULL if there is none. Never waits for the planner.
+        fftwf_plan find(int size, PlanRigor rigor, int count = 1) {
+            std::lock_guard<std::mutex> lck(mtx);
+            for (int r = PLAN_PATIENT; r >= rigor; r--) {
+                auto it = plans.find(std::make_tuple(size, count, r));
+                if (it != plans.end()) { return it->second; }
+            }
+            return NULL;
+        }
+
+        // Changes each time a plan made in the background is ready
+        uint64_t getGeneration() {
+            return generation.load(std::memory_order_acquire);
+        }
+
+        // NOTE: No plan from the cache may be in use
+        void clear() {
+            std::lock_guard<std::mutex> plck(plannerMtx());
+            std::lock_guard<std::mutex> lck(mtx);
+            for (auto& [key, plan] : plans) { fftwf_destroy_plan(plan); }
+            plans.clear();
+        }
+
+    private:
+        // Must be called with the planner locked. Measuring in the background is bounded by FFT_PLAN_TIME_LIMIT since
+        // no other plan can be made meanwhile.
+        fftwf_plan make(int size, PlanRigor rigor, int count, bool limited) {
+            // The planner overwrites the buffers while measuring
+            fftwf_complex* in = (fftwf_complex*)fftwf_malloc(size * count * sizeof(fftwf_complex));
+            fftwf_complex* out = (fftwf_complex*)fftwf_malloc(size * count * sizeof(fftwf_complex));
+            if (limited) { fftwf_set_timelimit(FFT_PLAN_TIME_LIMIT); }
+            fftwf_plan plan;
+            if (count > 1) {
+                plan = fftwf_plan_many_dft(1, &size, count, in, NULL, 1, size, out, NULL, 1, size, FFTW_FORWARD, rigorFlags(rigor));
+            }
+            else {
+                plan = fftwf_plan_dft_1d(size, in, out, FFTW_FORWARD, rigorFlags(rigor));
+            }
+            if (limited) { fftwf_set_timelimit(FFTW_NO_TIMELIMIT); }
+            fftwf_free(in);
+            fftwf_free(out);
+
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                plans[std::make_tuple(size, count, (int)rigor)] = plan;
+            }
+
+            if (rigor != PLAN_ESTIMATE && !wisdomPath.empty()) { fftwf_export_wisdom_to_filename(wisdomPath.c_str()); }
+            return plan;
+        }
+
+        void workerLoop() {
+            while (true) {
+                std::tuple<int, int, int> key;
+                {
+                    std::unique_lock<std::mutex> lck(mtx);
+                    workerCV.wait(lck, [this]() { return !jobs.empty() || stopWorker; });
+                    if (stopWorker) { return; }
+                    key = jobs.front();
+                    jobs.pop_front();
+                }
+
+                auto [size, count, rigor] = key;
+                {
+                    std::lock_guard<std::mutex> lck(plannerMtx());
+                    if (!find(size, (PlanRigor)rigor, count)) { make(size, (PlanRigor)rigor, count, true); }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lck(mtx);
+                    pending.erase(key);
+                }
+                generation.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        // Guards the plans and the jobs, never held while planning. Taken after the planner lock when both are needed.
+        std::mutex mtx;
+        std::map<std::tuple<int, int, int>, fftwf_plan> plans;
+        std::string wisdomPath;
+
+        // Plans to measure in the background
+        std::thread worker;
+        std::condition_variable workerCV;
+        std::deque<std::tuple<int, int, int>> jobs;
+        std::set<std::tuple<int, int, int>> pending;
+        std::atomic<uint64_t> generation = 0;
+        bool stopWorker = false;
+    };
+
+    // Cache used by the signal path
+    inline PlanCache& planCache() {
+        static PlanCache cache;
+        return cache;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <math.h>
+#include <string.h>
+#include "../types.h"
+#include "../cpu.h"
+#include "../buffer/buffer.h"
+
+// Time constant of the exponential averaging, in outputs
+#define SPECTRUM_AVERAGER_EXP_OUTPUTS   4
+
+namespace dsp::fft {
+    enum AveragingMode {
+        AVERAGING_LINEAR,
+        AVERAGING_EXPONENTIAL
+    };
+
+    // Averages the power of FFT outputs and gives the result in dB once every count spectra. Linear averaging gives the
+    // mean of the last count spectra, exponential averaging keeps a running average with a longer memory.
+    class SpectrumAverager {
+    public:
+        SpectrumAverager() {}
+
+        ~SpectrumAverager() {
+            if (!capacity) { return; }
+            buffer::free(acc);
+        }
+
+        // Buffers are only reallocated to grow
+        void configure(int size, int count, AveragingMode mode) {
+            if (size > capacity) {
+                if (capacity) { buffer::free(acc); }
+                acc = buffer::alloc<float>(size);
+                capacity = size;
+            }
+            _size = size;
+            _count = count;
+            _mode = mode;
+            alpha = 1.0f / (float)(count * SPECTRUM_AVERAGER_EXP_OUTPUTS);
+            reset();
+        }
+
+        void reset() {
+            frames = 0;
+            primed = false;
+            buffer::clear(acc, _size);
+        }
+
+        inline int getCount() { return _count; }
+
+        // Add the power of a spectrum of the configured size. Returns true once count spectra were added and output() must be called.
+        bool add(const complex_t* spectrum) {
+            if (_mode == AVERAGING_EXPONENTIAL && primed) {
+                accumulate(spectrum, alpha);
+            }
+            else {
+                // Linear averaging sums the powers, exponential averaging starts from the first spectrum
+                accumulate(spectrum, 0.0f);
+                primed = true;
+            }
+            return (++frames >= _count);
+        }
+
+        // Average in dB, normalized like volk_32fc_s32f_power_spectrum_32f() with the size as factor. NULL drops it.
+        void output(float* out) {
+            if (out) {
+                float scale = 1.0f / ((float)_size * (float)_size);
+                if (_mode == AVERAGING_LINEAR) { scale /= (float)frames; }
+                for (int i = 0; i < _size; i++) {
+                    out[i] = 10.0f * log10f(acc[i] * scale);
+                }
+            }
+
+            // Linear averaging starts over, exponential averaging goes on
+            if (_mode == AVERAGING_LINEAR) { buffer::clear(acc, _size); }
+            frames = 0;
+        }
+
+    private:
+        // alpha of zero adds the power, otherwise the average moves towards it by alpha
+        void accumulate(const complex_t* spectrum, float a) {
+#ifdef DSP_CPU_X86
+            if (cpu::hasAVX2()) {
+                accumulateAVX2(spectrum, a);
+                return;
+            }
+#endif
+            accumulateScalar(spectrum, a, 0);
+        }
+
+        void accumulateScalar(const complex_t* spectrum, float a, int first) {
+            if (a == 0.0f) {
+                for (int i = first; i < _size; i++) { acc[i] += spectrum[i].re * spectrum[i].re + spectrum[i].im * spectrum[i].im; }
+            }
+            else {
+                for (int i = first; i < _size; i++) {
+                    float p = spectrum[i].re * spectrum[i].re + spectrum[i].im * spectrum[i].im;
+                    acc[i] += a * (p - acc[i]);
+                }
+            }
+        }
+
+#ifdef DSP_CPU_X86
+        DSP_TARGET_AVX2 void accumulateAVX2(const complex_t* spectrum, float a) {
+            const float* in = (const float*)spectrum;
+            __m256 va = _mm256_set1_ps(a);
+            int i = 0;
+            for (; i + 8 <= _size; i += 8) {
+                __m256 x0 = _mm256_loadu_ps(&in[2 * i]);
+                __m256 x1 = _mm256_loadu_ps(&in[2 * i + 8]);
+
+                // hadd interleaves the lanes of both vectors, put the powers back in order
+                __m256 p = _mm256_hadd_ps(_mm256_mul_ps(x0, x0), _mm256_mul_ps(x1, x1));
+                p = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), 0xD8));
+
+                __m256 s = _mm256_loadu_ps(&acc[i]);
+                s = (a == 0.0f) ? _mm256_add_ps(s, p) : _mm256_fmadd_ps(va, _mm256_sub_ps(p, s), s);
+                _mm256_storeu_ps(&acc[i], s);
+            }
+            accumulateScalar(spectrum, a, i);
+        }
+#endif
+
+        int _size = 0;
+        int _count = 1;
+        AveragingMode _mode = AVERAGING_LINEAR;
+        float alpha = 1.0f;
+
+        int capacity = 0;
+        int frames = 0;
+        bool primed = false;
+        float* acc = NULL;
+    };
+}
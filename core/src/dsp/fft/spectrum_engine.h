@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <volk/volk.h>
+#include "plan_cache.h"
+#include "../types.h"
+#include "../buffer/buffer.h"
+#include "../worker_group.h"
+
+// Below this FFT size the windowing and power conversion aren't worth splitting between threads
+#define SPECTRUM_ENGINE_MIN_PARALLEL_SIZE  65536
+
+namespace dsp::fft {
+    // Computes the power spectrum of frames of samples. Frames are windowed as they come in and transformed by batch,
+    // the frames of a batch being split between the threads of a worker group with one batched FFT plan per thread.
+    // Batching adds a latency of one batch but lets FFT sizes too large for one core keep up with the frame rate.
+    class SpectrumEngine {
+    public:
+        SpectrumEngine() {}
+
+        ~SpectrumEngine() {
+            if (!capacity) { return; }
+            buffer::free(window);
+            fftwf_free(in);
+            fftwf_free(out);
+        }
+
+        // The window of frameSize samples must be written to getWindow() after this, the rest of the FFT is zero padded.
+        // Buffers are only reallocated to grow.
+        void configure(int size, int frameSize, int batchSize, PlanRigor rigor) {
+            if (size * batchSize > capacity) {
+                if (capacity) {
+                    buffer::free(window);
+                    fftwf_free(in);
+                    fftwf_free(out);
+                }
+                capacity = size * batchSize;
+                window = buffer::alloc<float>(capacity);
+                in = (complex_t*)fftwf_malloc(capacity * sizeof(complex_t));
+                out = (complex_t*)fftwf_malloc(capacity * sizeof(complex_t));
+            }
+            _size = size;
+            _frameSize = frameSize;
+            _batchSize = batchSize;
+            _rigor = rigor;
+            staged = 0;
+
+            // Clear the zero padding of all frames
+            for (int i = 0; i < _batchSize; i++) {
+                buffer::clear(&in[i * _size], _size - _frameSize, _frameSize);
+            }
+
+            updatePlans();
+        }
+
+        // Wait for the plans of the rigor to be made instead of running the ones in use meanwhile
+        void finishPlanning() {
+            for (int i = 0; i < plans.size(); i++) {
+                if (plans[i]) { plans[i] = planCache().get(_size, _rigor, partFrames(i, plans.size())); }
+            }
+            upgrading = false;
+        }
+
+        // Threads to run the work on, NULL to run it on the caller only. Must be set again if their count changes.
+        void setWorkers(WorkerGroup* workers) {
+            _workers = workers;
+            if (_size) { updatePlans(); }
+        }
+
+        inline float* getWindow() { return window; }
+        inline int getSize() { return _size; }
+        inline int getFrameSize() { return _frameSize; }
+        inline int getBatchSize() { return _batchSize; }
+
+        // Window a frame of getFrameSize() samples into the batch. Returns true once the batch is full and must be transformed.
+        bool push(const complex_t* frame) {
+            complex_t* dst = &in[staged * _size];
+            forChunks(_frameSize, [&](int first, int count) {
+                volk_32fc_32f_multiply_32fc((lv_32fc_t*)&dst[first], (const lv_32fc_t*)&frame[first], &window[first], count);
+            });
+            return (++staged == _batchSize);
+        }
+
+        // Run the FFTs of the batch, full or not, and start a new one. Returns the number of frames transformed.
+        int transform() {
+            if (upgrading && planCache().getGeneration() != planGeneration) { upgradePlans(); }
+            int threads = partCount();
+            run([&](int part) {
+                if (part >= threads) { return; }
+                int first = (part * _batchSize) / threads;
+                int last = ((part + 1) * _batchSize) / threads;
+                if (first == last) { return; }
+                fftwf_execute_dft(plans[part], (fftwf_complex*)&in[first * _size], (fftwf_complex*)&out[first * _size]);
+            });
+            int count = staged;
+            staged = 0;
+            return count;
+        }
+
+        // FFT output of a frame of the last transformed batch
+        inline const complex_t* getSpectrum(int frame) { return &out[frame * _size]; }
+
+        // Power spectrum in dB of a frame of the last transformed batch
+        void power(int frame, float* spectrum) {
+            const complex_t* src = &out[frame * _size];
+            forChunks(_size, [&](int first, int count) {
+                volk_32fc_s32f_power_spectrum_32f(&spectrum[first], (const lv_32fc_t*)&src[first], _size, count);
+            });
+        }
+
+    private:
+        // Threads the FFTs are spread over, no more than there are frames in a batch
+        int partCount() {
+            if (!_workers) { return 1; }
+            return std::min<int>(_workers->getThreadCount(), _batchSize);
+        }
+
+        void run(const std::function<void(int)>& job) {
+            if (partCount() > 1) {
+                _workers->run(job);
+            }
+            else {
+                job(0);
+            }
+        }
+
+        // Split an element wise operation on count samples between the threads if it's large enough
+        template <class Func>
+        void forChunks(int count, const Func& func) {
+            if (!_workers || _workers->getThreadCount() < 2 || count < SPECTRUM_ENGINE_MIN_PARALLEL_SIZE) {
+                func(0, count);
+                return;
+            }
+            int threads = _workers->getThreadCount();
+            _workers->run([&](int part) {
+                // Keep chunks a multiple of 16 samples so that they all start aligned
+                int first = ((int64_t)count * part / threads) & ~15;
+                int last = (part == threads - 1) ? count : (((int64_t)count * (part + 1) / threads) & ~15);
+                if (last > first) { func(first, last - first); }
+            });
+        }
+
+        // Frames of the batch transformed by a thread
+        inline int partFrames(int part, int threads) {
+            return ((part + 1) * _batchSize) / threads - (part * _batchSize) / threads;
+        }
+
+        // One plan per thread for its share of the batch, shared through the cache. Measured plans are made in the
+        // background, the best plan there is gets used until then.
+        void updatePlans() {
+            int threads = partCount();
+            plans.resize(threads);
+            planGeneration = planCache().getGeneration();
+            for (int i = 0; i < threads; i++) {
+                int count = partFrames(i, threads);
+                plans[i] = count ? planCache().request(_size, _rigor, count) : NULL;
+            }
+            upgrading = (_rigor != PLAN_ESTIMATE);
+            if (upgrading) { upgradePlans(); }
+        }
+
+        // Switch to the plans of the rigor that are ready
+        void upgradePlans() {
+            planGeneration = planCache().getGeneration();
+            upgrading = false;
+            for (int i = 0; i < plans.size(); i++) {
+                if (!plans[i]) { continue; }
+                fftwf_plan plan = planCache().find(_size, _rigor, partFrames(i, plans.size()));
+                if (plan) {
+                    plans[i] = plan;
+                }
+                else {
+                    upgrading = true;
+                }
+            }
+        }
+
+        int _size = 0;
+        int _frameSize = 0;
+        int _batchSize = 1;
+        PlanRigor _rigor = PLAN_ESTIMATE;
+        WorkerGroup* _workers = NULL;
+
+        int capacity = 0;
+        int staged = 0;
+        float* window = NULL;
+        complex_t* in = NULL;
+        complex_t* out = NULL;
+        std::vector<fftwf_plan> plans;
+        bool upgrading = false;         // Some plans of the rigor are still being made
+        uint64_t planGeneration = 0;
+    };
+}
@@ -6,12 +6,16 @@ namespace dsp::filter {
     class DecimatingFIR : public FIR<D, T> {
         using base_type = FIR<D, T>;
     public:
+        // Specialized convolution, see setKernel()
+        using kernel_t = void (*)(const D* data, int first, int last, int decimation, const T* taps, D* out);
+
         DecimatingFIR() {}
 
         DecimatingFIR(stream<D>* in, tap<T>& taps, int decimation) { init(in, taps, decimation); }
 
         void init(stream<D>* in, tap<T>& taps, int decimation) {
             _decimation = decimation;
+            base_type::fftAllowed = false;
             base_type::init(in, taps);
         }
 
@@ -20,6 +24,7 @@ namespace dsp::filter {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             offset = 0;
+            kernel = NULL;
             base_type::setTaps(taps);
             base_type::tempStart();
         }
@@ -33,6 +38,14 @@ namespace dsp::filter {
             base_type::tempStart();
         }
 
+        // Use a kernel specialized for the current taps instead of the generic volk convolution, NULL to go back to it.
+        // The kernel is dropped when the taps change.
+        void setKernel(kernel_t kernel) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            this->kernel = kernel;
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -43,30 +56,52 @@ namespace dsp::filter {
         }
 
         inline int process(int count, const D* in, D* out) {
-            // Copy data to work buffer
+            int outCount = prepare(count, in);
+            convolve(0, outCount, out);
+            finish(count, outCount);
+            return outCount;
+        }
+
+        // process() split in steps so that the outputs can be computed by several threads at once.
+        // Copies the input to the work buffer and returns the number of outputs it will give.
+        inline int prepare(int count, const D* in) {
             memcpy(base_type::bufStart, in, count * sizeof(D));
+            return (offset < count) ? ((count - offset + _decimation - 1) / _decimation) : 0;
+        }
 
-            // Do convolution
-            int outCount = 0;
-            for (; offset < count; offset += _decimation) {
+        // Computes outputs first to last - 1 of the prepared input, only reads the filter's state
+        inline void convolve(int first, int last, D* out) {
+            if (kernel) {
+                kernel(&base_type::buffer[offset], first, last, _decimation, base_type::_taps.taps, out);
+                return;
+            }
+            for (int i = first; i < last; i++) {
+                D* data = &base_type::buffer[offset + (i * _decimation)];
                 if constexpr (std::is_same_v<D, float> && std::is_same_v<T, float>) {
-                    volk_32f_x2_dot_prod_32f(&out[outCount++], &base_type::buffer[offset], base_type::_taps.taps, base_type::_taps.size);
+                    volk_32f_x2_dot_prod_32f(&out[i], data, base_type::_taps.taps, base_type::_taps.size);
                 }
                 if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, float>) {
-                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&out[outCount++], (lv_32fc_t*)&base_type::buffer[offset], base_type::_taps.taps, base_type::_taps.size);
+                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&out[i], (lv_32fc_t*)data, base_type::_taps.taps, base_type::_taps.size);
                 }
                 if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, complex_t>) {
-                    volk_32fc_x2_dot_prod_32fc((lv_32fc_t*)&out[outCount++], (lv_32fc_t*)&base_type::buffer[offset], (lv_32fc_t*)base_type::_taps.taps, base_type::_taps.size);
+                    volk_32fc_x2_dot_prod_32fc((lv_32fc_t*)&out[i], (lv_32fc_t*)data, (lv_32fc_t*)base_type::_taps.taps, base_type::_taps.size);
                 }
             }
-            offset -= count;
+        }
+
+        inline void finish(int count, int outCount) {
+            offset += (outCount * _decimation) - count;
 
             // Move unused data
             memmove(base_type::buffer, &base_type::buffer[count], (base_type::_taps.size - 1) * sizeof(D));
+        }
 
-            return outCount;
+        int maxOutputSize(int maxInputSize) {
+            return (maxInputSize / _decimation) + 1;
         }
 
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -84,5 +119,6 @@ namespace dsp::filter {
     protected:
         int _decimation;
         int offset = 0;
+        kernel_t kernel = NULL;
     };
 }
\ No newline at end of file
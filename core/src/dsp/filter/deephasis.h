@@ -78,6 +78,10 @@ namespace dsp::filter {
 
         //DEFAULT_PROC_RUN();
 
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
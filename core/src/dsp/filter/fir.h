@@ -1,6 +1,12 @@
 #pragma once
 #include "../processor.h"
 #include "../taps/tap.h"
+#include "overlap_save.h"
+
+// Tap count from which the FIR switches to FFT convolution, see bench::FIRTester
+#ifndef FIR_FFT_MIN_TAPS
+#define FIR_FFT_MIN_TAPS 64
+#endif
 
 namespace dsp::filter {
     template <class D, class T>
@@ -20,35 +26,88 @@ namespace dsp::filter {
         virtual void init(stream<D>* in, tap<T>& taps) {
             _taps = taps;
 
-            // Allocate and clear buffer
-            buffer = buffer::alloc<D>(STREAM_BUFFER_SIZE + 64000);
+            // Allocate and clear buffer, it's sized again from the input once started
+            capacity = in ? in->getBufferSize() : STREAM_BUFFER_SIZE;
+            bufferSize = capacity + _taps.size - 1;
+            buffer = buffer::alloc<D>(bufferSize);
             bufStart = &buffer[_taps.size - 1];
             buffer::clear<D>(buffer, _taps.size - 1);
 
+            planFFT(_taps, fftMinTaps);
+            swapFFT();
+            releaseTaps();
+
             base_type::init(in);
         }
 
         virtual void setTaps(tap<T>& taps) {
             assert(base_type::_block_init);
-            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
-            base_type::tempStop();
 
-            int oldTC = _taps.size;
-            _taps = taps;
+            // Plan before stopping the block, the planner may be busy with a measurement made in the background
+            bool prepared = (taps.taps == nextTaps.taps && taps.size == nextTaps.size);
+            if (!prepared) { prepareTaps(taps); }
 
-            // Update start of buffer
-            bufStart = &buffer[_taps.size - 1];
+            {
+                std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+                base_type::tempStop();
+
+                // The FFT convolution keeps its own history, bring it back to the buffer
+                if (useFFT) { fft.getHistory(buffer); }
+
+                int oldTC = _taps.size;
+                _taps = taps;
+
+                // Make room for a longer history
+                if (capacity + _taps.size - 1 > bufferSize) { resizeBuffer(capacity + _taps.size - 1, oldTC - 1); }
+
+                // Update start of buffer
+                bufStart = &buffer[_taps.size - 1];
+
+                // Move existing data to make transition seemless
+                if (_taps.size < oldTC) {
+                    memmove(buffer, &buffer[oldTC - _taps.size], (_taps.size - 1) * sizeof(D));
+                }
+                else if (_taps.size > oldTC) {
+                    memmove(&buffer[_taps.size - oldTC], buffer, (oldTC - 1) * sizeof(D));
+                    buffer::clear<D>(buffer, _taps.size - oldTC);
+                }
+
+                swapFFT();
 
-            // Move existing data to make transition seemless
-            if (_taps.size < oldTC) {
-                memmove(buffer, &buffer[oldTC - _taps.size], (_taps.size - 1) * sizeof(D));
+                base_type::tempStart();
             }
-            else if (_taps.size > oldTC) {
-                memmove(&buffer[_taps.size - oldTC], buffer, (oldTC - 1) * sizeof(D));
-                buffer::clear<D>(buffer, _taps.size - oldTC);
+
+            if (!prepared) { releaseTaps(); }
+        }
+
+        // Blocks calling setTaps() from behind a lock their DSP thread takes plan the taps with prepareTaps() before
+        // taking it and free the replaced FFT convolution with releaseTaps() after, planning and freeing plans may
+        // wait for the planner
+        void prepareTaps(tap<T>& taps) {
+            planFFT(taps, fftMinTaps);
+        }
+
+        void releaseTaps() {
+            spareFFT.destroy();
+        }
+
+        // Tap count from which FFT convolution is used instead of the direct form
+        void setFFTMinTaps(int minTaps) {
+            assert(base_type::_block_init);
+            planFFT(_taps, minTaps);
+            {
+                std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+                base_type::tempStop();
+                if (useFFT) { fft.getHistory(buffer); }
+                fftMinTaps = minTaps;
+                swapFFT();
+                base_type::tempStart();
             }
-            
-            base_type::tempStart();
+            releaseTaps();
+        }
+
+        bool isFFT() {
+            return useFFT;
         }
 
         virtual void reset() {
@@ -56,10 +115,16 @@ namespace dsp::filter {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             buffer::clear<D>(buffer, _taps.size - 1);
+            if (useFFT) { fft.reset(); }
             base_type::tempStart();
         }
 
         inline int process(int count, const D* in, D* out) {
+            if constexpr (OverlapSave<D, T>::supported) {
+                if (useFFT) { return fft.process(count, in, out); }
+            }
+
+
             // Copy data to work buffer
             memcpy(bufStart, in, count * sizeof(D));
             
@@ -82,6 +147,22 @@ namespace dsp::filter {
             return count;
         }
 
+        void reserve(int maxInputSize) {
+            if (maxInputSize == capacity) { return; }
+            capacity = maxInputSize;
+            resizeBuffer(capacity + _taps.size - 1, _taps.size - 1);
+            bufStart = &buffer[_taps.size - 1];
+        }
+
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return (size_t)bufferSize * sizeof(D) + fft.getMemoryUsage() + spareFFT.getMemoryUsage();
+        }
+
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         virtual int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -94,8 +175,46 @@ namespace dsp::filter {
         }
 
     protected:
+        // Reallocate the work buffer, keeping its first samples
+        void resizeBuffer(int size, int keep) {
+            D* newBuffer = buffer::alloc<D>(size);
+            memcpy(newBuffer, buffer, keep * sizeof(D));
+            buffer::free(buffer);
+            buffer = newBuffer;
+            bufferSize = size;
+        }
+
+        // FFT convolution for the taps, made in the spare one to be swapped in by swapFFT()
+        void planFFT(tap<T>& taps, int minTaps) {
+            spareFFT.destroy();
+            nextTaps = taps;
+            if constexpr (OverlapSave<D, T>::supported) {
+                if (fftAllowed && taps.size >= minTaps) { spareFFT.init(taps); }
+            }
+        }
+
+        // Switch between direct form and FFT convolution as planned, the history goes along. The replaced FFT
+        // convolution is left in the spare one.
+        void swapFFT() {
+            fft.swap(spareFFT);
+            useFFT = fft.isReady();
+            if (useFFT) { fft.setHistory(buffer); }
+            nextTaps.taps = NULL;
+            nextTaps.size = 0;
+        }
+
         tap<T> _taps;
         D* buffer;
         D* bufStart;
+        int bufferSize;
+        int capacity;               // Input samples the buffer holds after the history
+
+        // Cleared by subclasses that work on the direct form buffer
+        bool fftAllowed = true;
+        int fftMinTaps = FIR_FFT_MIN_TAPS;
+        bool useFFT = false;
+        OverlapSave<D, T> fft;
+        OverlapSave<D, T> spareFFT;
+        tap<T> nextTaps;                // Taps the spare FFT convolution was planned for
     };
 }
\ No newline at end of file
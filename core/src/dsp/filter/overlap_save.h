@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+#include <fftw3.h>
+#include "../fft/plan_cache.h"
+#include "../types.h"
+#include "../taps/tap.h"
+
+namespace dsp::filter {
+    // FFT convolution by the overlap-save method. Output is the same as the direct form FIR sample for sample,
+    // with no added latency, at a cost per sample that grows with log(taps) instead of taps.
+    template <class D, class T>
+    class OverlapSave {
+    public:
+        // Real data uses real FFTs, stereo data is filtered as complex data which is only valid with real taps
+        static constexpr bool supported = (std::is_same_v<D, float> && std::is_same_v<T, float>) ||
+                                          (std::is_same_v<D, complex_t> && (std::is_same_v<T, float> || std::is_same_v<T, complex_t>)) ||
+                                          (std::is_same_v<D, stereo_t> && std::is_same_v<T, float>);
+
+        OverlapSave() {}
+
+        ~OverlapSave() {
+            destroy();
+        }
+
+        void init(const tap<T>& taps) {
+            static_assert(supported, "Unsupported data and tap types");
+            destroy();
+
+            // Each FFT yields blockSize valid outputs, the rest is taken by the history
+            tapCount = taps.size;
+            fftSize = 256;
+            while (fftSize < 4 * tapCount) { fftSize <<= 1; }
+            blockSize = fftSize - (tapCount - 1);
+            bins = isReal ? (fftSize / 2 + 1) : fftSize;
+
+            timeBuf = (S*)fftwf_malloc(fftSize * sizeof(S));
+            resultBuf = (S*)fftwf_malloc(fftSize * sizeof(S));
+            freqBuf = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
+            tapsFreq = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
+            std::unique_lock<std::mutex> plck(fft::plannerMtx());
+            if constexpr (isReal) {
+                forwardPlan = fftwf_plan_dft_r2c_1d(fftSize, timeBuf, (fftwf_complex*)freqBuf, FFTW_ESTIMATE);
+                backwardPlan = fftwf_plan_dft_c2r_1d(fftSize, (fftwf_complex*)freqBuf, resultBuf, FFTW_ESTIMATE);
+            }
+            else {
+                forwardPlan = fftwf_plan_dft_1d(fftSize, (fftwf_complex*)timeBuf, (fftwf_complex*)freqBuf, FFTW_FORWARD, FFTW_ESTIMATE);
+                backwardPlan = fftwf_plan_dft_1d(fftSize, (fftwf_complex*)freqBuf, (fftwf_complex*)resultBuf, FFTW_BACKWARD, FFTW_ESTIMATE);
+            }
+            plck.unlock();
+
+            // The direct form correlates with the taps, so convolve with them reversed. The IFFT scaling is folded in.
+            memset(timeBuf, 0, fftSize * sizeof(S));
+            for (int i = 0; i < tapCount; i++) {
+                if constexpr (std::is_same_v<S, complex_t> && std::is_same_v<T, float>) {
+                    timeBuf[i] = { taps.taps[tapCount - 1 - i], 0.0f };
+                }
+                else {
+                    timeBuf[i] = taps.taps[tapCount - 1 - i];
+                }
+            }
+            fftwf_execute(forwardPlan);
+            float scale = 1.0f / (float)fftSize;
+            for (int i = 0; i < bins; i++) {
+                tapsFreq[i] = freqBuf[i] * scale;
+            }
+
+            reset();
+        }
+
+        void destroy() {
+            if (!timeBuf) { return; }
+            {
+                std::lock_guard<std::mutex> lck(fft::plannerMtx());
+                fftwf_destroy_plan(forwardPlan);
+                fftwf_destroy_plan(backwardPlan);
+            }
+            fftwf_free(timeBuf);
+            fftwf_free(resultBuf);
+            fftwf_free(freqBuf);
+            fftwf_free(tapsFreq);
+            timeBuf = NULL;
+        }
+
+        inline bool isReady() { return timeBuf != NULL; }
+
+        // Exchange the plans and buffers, lets a filter be planned ahead and switched to without planning
+        void swap(OverlapSave& other) {
+            std::swap(tapCount, other.tapCount);
+            std::swap(fftSize, other.fftSize);
+            std::swap(blockSize, other.blockSize);
+            std::swap(bins, other.bins);
+            std::swap(timeBuf, other.timeBuf);
+            std::swap(resultBuf, other.resultBuf);
+            std::swap(freqBuf, other.freqBuf);
+            std::swap(tapsFreq, other.tapsFreq);
+            std::swap(forwardPlan, other.forwardPlan);
+            std::swap(backwardPlan, other.backwardPlan);
+        }
+
+        void reset() {
+            memset(timeBuf, 0, fftSize * sizeof(S));
+        }
+
+        // History is the last tapCount - 1 input samples, oldest first, same layout as the direct form FIR buffer
+        void setHistory(const D* history) {
+            memcpy(timeBuf, history, (tapCount - 1) * sizeof(D));
+        }
+
+        void getHistory(D* history) {
+            memcpy(history, timeBuf, (tapCount - 1) * sizeof(D));
+        }
+
+        inline int process(int count, const D* in, D* out) {
+            for (int i = 0; i < count;) {
+                // Only the outputs that don't wrap around are kept so what's after the new samples doesn't matter
+                int n = std::min<int>(blockSize, count - i);
+                memcpy(&timeBuf[tapCount - 1], &in[i], n * sizeof(D));
+
+                fftwf_execute(forwardPlan);
+                volk_32fc_x2_multiply_32fc((lv_32fc_t*)freqBuf, (lv_32fc_t*)freqBuf, (lv_32fc_t*)tapsFreq, bins);
+                fftwf_execute(backwardPlan);
+
+                memcpy(&out[i], &resultBuf[tapCount - 1], n * sizeof(D));
+                memmove(timeBuf, &timeBuf[n], (tapCount - 1) * sizeof(D));
+                i += n;
+            }
+            return count;
+        }
+
+        size_t getMemoryUsage() {
+            if (!timeBuf) { return 0; }
+            return (2 * fftSize * sizeof(S)) + (2 * bins * sizeof(complex_t));
+        }
+
+    private:
+        static constexpr bool isReal = std::is_same_v<D, float>;
+        using S = std::conditional_t<isReal, float, complex_t>;
+
+        int tapCount = 0;
+        int fftSize = 0;
+        int blockSize = 0;
+        int bins = 0;
+
+        S* timeBuf = NULL;
+        S* resultBuf = NULL;
+        complex_t* freqBuf = NULL;
+        complex_t* tapsFreq = NULL;
+        fftwf_plan forwardPlan;
+        fftwf_plan backwardPlan;
+    };
+}
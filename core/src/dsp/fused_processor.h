@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include "processor.h"
+
+// Size of the tiles processed by each block in turn, chosen to stay in L2 cache
+#define FUSED_TILE_BYTES    (256 * 1024)
+
+namespace dsp {
+    // Runs a list of blocks back to back on its own thread, calling their process functions
+    // on tiles of the input instead of handing each full buffer to the next block's thread.
+    template <class T>
+    class FusedProcessor : public Processor<T, T> {
+        using base_type = Processor<T, T>;
+    public:
+        FusedProcessor() {}
+
+        FusedProcessor(stream<T>* in) { init(in); }
+
+        ~FusedProcessor() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            for (auto& blk : blocks) { blk->setFusedHost(NULL); }
+        }
+
+        void init(stream<T>* in) {
+            tileSize = FUSED_TILE_BYTES / sizeof(T);
+            base_type::init(in);
+        }
+
+        void setBlocks(const std::vector<Processor<T, T>*>& blks) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            for (auto& blk : blks) {
+                if (!blk->fusable()) {
+                    throw std::runtime_error("[FusedProcessor] Tried to fuse a block that doesn't support it");
+                }
+            }
+            blocks = blks;
+            base_type::tempStart();
+        }
+
+        void setTileSize(int size) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            tileSize = size;
+            base_type::tempStart();
+        }
+
+        inline int process(int count, const T* in, T* out) {
+            // If there is nothing to run, just pass the data through
+            if (blocks.empty()) {
+                memcpy(out, in, count * sizeof(T));
+                return count;
+            }
+
+            // Run each tile through all blocks, the first one writes to the output and all others work in place
+            int outCount = 0;
+            for (int i = 0; i < count; i += tileSize) {
+                int tcount = std::min<int>(tileSize, count - i);
+                T* tout = &out[outCount];
+                tcount = blocks[0]->fusedProcess(tcount, &in[i], tout);
+                for (int j = 1; j < blocks.size() && tcount; j++) {
+                    tcount = blocks[j]->fusedProcess(tcount, tout, tout);
+                }
+                outCount += tcount;
+            }
+            return outCount;
+        }
+
+        int maxOutputSize(int maxInputSize) {
+            if (blocks.empty()) { return maxInputSize; }
+
+            // Each tile is processed separately, in place, so the bound is the largest stage of each tile
+            auto tileOutput = [this](int size) {
+                int largest = 0;
+                for (auto& blk : blocks) {
+                    size = blk->maxOutputSize(size);
+                    if (size < 0) { return -1; }
+                    largest = std::max<int>(largest, size);
+                }
+                return largest;
+            };
+            int fullTiles = maxInputSize / tileSize;
+            int rem = maxInputSize % tileSize;
+            int fullOut = fullTiles ? tileOutput(tileSize) : 0;
+            int remOut = rem ? tileOutput(rem) : 0;
+            if (fullOut < 0 || remOut < 0) { return -1; }
+            return (fullTiles * fullOut) + remOut;
+        }
+
+        void reserve(int maxInputSize) {
+            // Each block is given at most a tile, or what the blocks before it make of one
+            int size = std::min<int>(tileSize, maxInputSize);
+            for (auto& blk : blocks) {
+                blk->reserve(size);
+                size = blk->maxOutputSize(size);
+                if (size < 0) { size = STREAM_BUFFER_SIZE; }
+            }
+        }
+
+        size_t getMemoryUsage() {
+            // The fused blocks aren't started, they're reported along with the processor running them
+            size_t total = 0;
+            for (auto& blk : blocks) { total += blk->getMemoryUsage(); }
+            return total;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            // Swap if some data was generated
+            base_type::_in->flush();
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
+        }
+
+    protected:
+        std::vector<Processor<T, T>*> blocks;
+        int tileSize;
+    };
+}
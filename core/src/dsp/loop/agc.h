@@ -1,7 +1,14 @@
 #pragma once
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <volk/volk.h>
 #include "../processor.h"
 
 namespace dsp::loop {
+    // Works on whole buffers: the envelope and the output gain are computed with SIMD, only the average amplitude is
+    // updated sample by sample. When the output would clip, the average amplitude jumps to the peak of the samples
+    // ahead, which are either the rest of the buffer or a window of look ahead samples that the output is delayed by.
     template <class T>
     class AGC : public Processor<T, T> {
         using base_type = Processor<T, T>;
@@ -61,54 +68,90 @@ namespace dsp::loop {
             _initGain = initGain;
         }
 
+        // Samples looked ahead when clipping, the output being delayed by as much. 0 looks up to the end of the
+        // buffer instead, without any delay.
+        void setLookAhead(int lookAhead) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _lookAhead = std::max<int>(lookAhead, 0);
+            delayed.assign(_lookAhead, T());
+            env.assign(_lookAhead, 0.0f);
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             amp = _setPoint / _initGain;
+            std::fill(delayed.begin(), delayed.end(), T());
+            std::fill(env.begin(), env.end(), 0.0f);
         }
 
         inline int process(int count, T* in, T* out) {
-            for (int i = 0; i < count; i++) {
-                // Get signal amplitude
-                float inAmp, gain;
-                if constexpr (std::is_same_v<T, complex_t>) {
-                    inAmp = in[i].amplitude();
-                }
-                if constexpr (std::is_same_v<T, float>) {
-                    inAmp = fabsf(in[i]);
-                }
+            // The samples of the buffer follow the ones delayed by the previous call, whose envelope is still there
+            const T* src = in;
+            int total = _lookAhead + count;
+            if ((int)env.size() < total) { env.resize(total); }
+            if (_lookAhead) {
+                if ((int)delayed.size() < total) { delayed.resize(total); }
+                memcpy(&delayed[_lookAhead], in, count * sizeof(T));
+                src = delayed.data();
+            }
+            if ((int)peak.size() < count) {
+                peak.resize(count);
+                ampBuf.resize(count);
+            }
 
-                // Update average amplitude
-                if (inAmp != 0.0f) {
-                    amp = (inAmp > amp) ? ((amp * _invAttack) + (inAmp * _attack)) : ((amp * _invDecay) + (inAmp * _decay));
-                    gain = std::min<float>(_setPoint / amp, _maxGain);
-                }
-                else {
-                    gain = 1.0f;
+            // Envelope
+            float* e = env.data();
+            if constexpr (std::is_same_v<T, complex_t>) {
+                volk_32fc_magnitude_32f(&e[_lookAhead], (const lv_32fc_t*)in, count);
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                for (int i = 0; i < count; i++) { e[_lookAhead + i] = fabsf(in[i]); }
+            }
+
+            // Average amplitude, the clipping test is the same as inAmp * gain > _maxOutputAmp without dividing
+            bool peaksReady = false;
+            for (int i = 0; i < count; i++) {
+                float inAmp = e[i];
+                if (inAmp == 0.0f) {
+                    // No gain can change a null sample, an infinite amplitude gives a finite one
+                    ampBuf[i] = INFINITY;
+                    continue;
                 }
+                amp = (inAmp > amp) ? ((amp * _invAttack) + (inAmp * _attack)) : ((amp * _invDecay) + (inAmp * _decay));
 
                 // If clipping is detected look ahead and correct
-                if (inAmp*gain > _maxOutputAmp) {
-                    float maxAmp = 0;
-                    for (int j = i; j < count; j++) {
-                        if constexpr (std::is_same_v<T, complex_t>) {
-                            inAmp = in[j].amplitude();
-                        }
-                        if constexpr (std::is_same_v<T, float>) {
-                            inAmp = fabsf(in[j]);
-                        }
-                        if (inAmp > maxAmp) { maxAmp = inAmp; }
+                if (inAmp * _setPoint > _maxOutputAmp * amp && inAmp * _maxGain > _maxOutputAmp) {
+                    if (!peaksReady) {
+                        computePeaks(i, count);
+                        peaksReady = true;
                     }
-                    amp = maxAmp;
-                    gain = std::min<float>(_setPoint / amp, _maxGain);
+                    amp = peak[i];
                 }
-                
-                // Scale output by gain
-                out[i] = in[i] * gain;
+                ampBuf[i] = amp;
+            }
+
+            // Gain and output
+            float* gain = ampBuf.data();
+            for (int i = 0; i < count; i++) { gain[i] = std::min<float>(_setPoint / gain[i], _maxGain); }
+            if constexpr (std::is_same_v<T, complex_t>) {
+                volk_32fc_32f_multiply_32fc((lv_32fc_t*)out, (const lv_32fc_t*)src, gain, count);
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                volk_32f_x2_multiply_32f(out, src, gain, count);
+            }
+
+            // Keep the last samples for the next call
+            if (_lookAhead) {
+                memmove(delayed.data(), &delayed[count], _lookAhead * sizeof(T));
+                memmove(e, &e[count], _lookAhead * sizeof(float));
             }
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -131,6 +174,42 @@ namespace dsp::loop {
         float _initGain;
 
         float amp = 1.0;
+        int _lookAhead = 0;
+
+    private:
+        // Peak of the envelope ahead of the samples first to count - 1, in one pass with a monotonic deque in the
+        // look ahead window or a running max to the end of the buffer
+        void computePeaks(int first, int count) {
+            const float* e = env.data();
+            if (!_lookAhead) {
+                float m = 0.0f;
+                for (int i = count - 1; i >= first; i--) {
+                    m = std::max<float>(m, e[i]);
+                    peak[i] = m;
+                }
+                return;
+            }
+
+            // Indices of decreasing envelope values, the front being the peak of the window
+            int total = count + _lookAhead;
+            if ((int)window.size() < total) { window.resize(total); }
+            int head = 0;
+            int tail = 0;
+            int next = first;
+            for (int i = first; i < count; i++) {
+                for (; next <= i + _lookAhead; next++) {
+                    while (tail > head && e[window[tail - 1]] <= e[next]) { tail--; }
+                    window[tail++] = next;
+                }
+                while (window[head] < i) { head++; }
+                peak[i] = e[window[head]];
+            }
+        }
 
+        std::vector<T> delayed;
+        std::vector<float> env;
+        std::vector<float> peak;
+        std::vector<float> ampBuf;
+        std::vector<int> window;
     };
 }
\ No newline at end of file
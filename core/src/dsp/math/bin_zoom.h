@@ -0,0 +1,182 @@
+#pragma once
+#include <math.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include "../cpu.h"
+
+namespace dsp::math {
+    enum ZoomMode {
+        ZOOM_MAX,
+        ZOOM_MEAN,
+        ZOOM_MIN
+    };
+
+    // Resamples a range of a spectrum to a number of display points, each point being the max, mean or min of the bins
+    // it covers. The bin ranges of the points are computed once and reused until the view changes.
+    class BinZoom {
+    public:
+        BinZoom() {}
+
+        // Returns true if the bin table had to be rebuilt
+        bool configure(int offset, int width, int inSize, int outSize) {
+            if (offset == _offset && width == _width && inSize == _inSize && outSize == _outSize) { return false; }
+            _offset = offset;
+            _width = width;
+            _inSize = inSize;
+            _outSize = outSize;
+
+            // Same bin grouping as the display always used, with the ranges clamped to the spectrum
+            starts.resize(outSize);
+            counts.resize(outSize);
+            float factor = (float)width / (float)outSize;
+            float sFactor = ceilf(factor);
+            float id = std::max<int>(offset, 0);
+            maxCount = 0;
+            for (int i = 0; i < outSize; i++) {
+                int start = std::clamp<int>((int)id, 0, inSize);
+                int end = std::clamp<int>(start + (int)sFactor, start, inSize);
+                starts[i] = start;
+                counts[i] = end - start;
+                maxCount = std::max<int>(maxCount, counts[i]);
+                id += factor;
+            }
+            return true;
+        }
+
+        inline int getOutSize() { return _outSize; }
+
+        // Points with no bin in the spectrum are set to -INFINITY. Integer spectra are quantized values that are
+        // converted back to lo + value * step after being combined.
+        template <class T>
+        void process(const T* in, float* out, ZoomMode mode = ZOOM_MAX, float lo = 0.0f, float step = 1.0f) {
+            // Zoomed in far enough that every point is a single bin
+            if (maxCount <= 1) {
+                for (int i = 0; i < _outSize; i++) { out[i] = counts[i] ? toFloat(in[starts[i]], lo, step) : -INFINITY; }
+                return;
+            }
+
+#ifdef DSP_CPU_X86
+            if (cpu::hasAVX2()) {
+                if constexpr (std::is_same_v<T, float>) {
+                    processAVX2(in, out, mode);
+                    return;
+                }
+                else {
+                    if (mode != ZOOM_MEAN) {
+                        processIntAVX2(in, out, mode, lo, step);
+                        return;
+                    }
+                }
+            }
+#endif
+            for (int i = 0; i < _outSize; i++) {
+                out[i] = counts[i] ? reduce(&in[starts[i]], counts[i], mode, lo, step) : -INFINITY;
+            }
+        }
+
+    private:
+        template <class T>
+        static inline float toFloat(T value, float lo, float step) {
+            if constexpr (std::is_same_v<T, float>) { return value; }
+            else { return lo + (float)value * step; }
+        }
+
+        template <class T>
+        static float reduce(const T* x, int count, ZoomMode mode, float lo, float step) {
+            if (mode == ZOOM_MEAN) {
+                float sum = 0.0f;
+                for (int j = 0; j < count; j++) { sum += (float)x[j]; }
+                float mean = sum / (float)count;
+                if constexpr (std::is_same_v<T, float>) { return mean; }
+                else { return lo + mean * step; }
+            }
+            T r = x[0];
+            if (mode == ZOOM_MAX) {
+                for (int j = 1; j < count; j++) { r = std::max<T>(r, x[j]); }
+            }
+            else {
+                for (int j = 1; j < count; j++) { r = std::min<T>(r, x[j]); }
+            }
+            return toFloat(r, lo, step);
+        }
+
+#ifdef DSP_CPU_X86
+        DSP_TARGET_AVX2 void processAVX2(const float* in, float* out, ZoomMode mode) {
+            for (int i = 0; i < _outSize; i++) {
+                int count = counts[i];
+                if (count < 8) {
+                    out[i] = count ? reduce(&in[starts[i]], count, mode, 0.0f, 1.0f) : -INFINITY;
+                    continue;
+                }
+
+                // Reduce 8 lanes at a time, the last vector overlapping the previous one is harmless for min and max
+                const float* x = &in[starts[i]];
+                __m256 acc = _mm256_loadu_ps(x);
+                int j = 8;
+                if (mode == ZOOM_MAX) {
+                    for (; j + 8 <= count; j += 8) { acc = _mm256_max_ps(acc, _mm256_loadu_ps(&x[j])); }
+                    if (j < count) { acc = _mm256_max_ps(acc, _mm256_loadu_ps(&x[count - 8])); }
+                    __m128 r = _mm_max_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                    r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+                    r = _mm_max_ss(r, _mm_movehdup_ps(r));
+                    out[i] = _mm_cvtss_f32(r);
+                }
+                else if (mode == ZOOM_MIN) {
+                    for (; j + 8 <= count; j += 8) { acc = _mm256_min_ps(acc, _mm256_loadu_ps(&x[j])); }
+                    if (j < count) { acc = _mm256_min_ps(acc, _mm256_loadu_ps(&x[count - 8])); }
+                    __m128 r = _mm_min_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                    r = _mm_min_ps(r, _mm_movehl_ps(r, r));
+                    r = _mm_min_ss(r, _mm_movehdup_ps(r));
+                    out[i] = _mm_cvtss_f32(r);
+                }
+                else {
+                    for (; j + 8 <= count; j += 8) { acc = _mm256_add_ps(acc, _mm256_loadu_ps(&x[j])); }
+                    __m128 r = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                    r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+                    r = _mm_add_ss(r, _mm_movehdup_ps(r));
+                    float sum = _mm_cvtss_f32(r);
+                    for (; j < count; j++) { sum += x[j]; }
+                    out[i] = sum / (float)count;
+                }
+            }
+        }
+
+        template <class T>
+        DSP_TARGET_AVX2 static inline __m256i combine(__m256i a, __m256i b, ZoomMode mode) {
+            if constexpr (sizeof(T) == 1) { return (mode == ZOOM_MAX) ? _mm256_max_epu8(a, b) : _mm256_min_epu8(a, b); }
+            else { return (mode == ZOOM_MAX) ? _mm256_max_epu16(a, b) : _mm256_min_epu16(a, b); }
+        }
+
+        // Max and min of 8 or 16 bit quantized spectra
+        template <class T>
+        DSP_TARGET_AVX2 void processIntAVX2(const T* in, float* out, ZoomMode mode, float lo, float step) {
+            constexpr int L = 32 / sizeof(T);
+            for (int i = 0; i < _outSize; i++) {
+                int count = counts[i];
+                if (count < L) {
+                    out[i] = count ? reduce(&in[starts[i]], count, mode, lo, step) : -INFINITY;
+                    continue;
+                }
+
+                const T* x = &in[starts[i]];
+                __m256i acc = _mm256_loadu_si256((const __m256i*)x);
+                int j = L;
+                for (; j + L <= count; j += L) { acc = combine<T>(acc, _mm256_loadu_si256((const __m256i*)&x[j]), mode); }
+                if (j < count) { acc = combine<T>(acc, _mm256_loadu_si256((const __m256i*)&x[count - L]), mode); }
+                T lanes[L];
+                _mm256_storeu_si256((__m256i*)lanes, acc);
+                out[i] = reduce(lanes, L, mode, lo, step);
+            }
+        }
+#endif
+
+        int _offset = -1;
+        int _width = -1;
+        int _inSize = -1;
+        int _outSize = 0;
+        int maxCount = 0;
+        std::vector<int> starts;
+        std::vector<int> counts;
+    };
+}
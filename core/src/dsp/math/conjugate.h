@@ -14,6 +14,10 @@ namespace dsp::math {
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         virtual int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -19,7 +19,10 @@ namespace dsp::math {
         void init(stream<T>* in, int delay) {
             _delay = delay;
 
-            buffer = buffer::alloc<T>(STREAM_BUFFER_SIZE + 64000);
+            // Sized again from the input once started
+            capacity = in ? in->getBufferSize() : STREAM_BUFFER_SIZE;
+            bufferSize = capacity + _delay;
+            buffer = buffer::alloc<T>(bufferSize);
             bufStart = &buffer[_delay];
             buffer::clear(buffer, _delay);
 
@@ -31,6 +34,7 @@ namespace dsp::math {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             _delay = delay;
+            if (capacity + _delay > bufferSize) { resizeBuffer(capacity + _delay, 0); }
             bufStart = &buffer[_delay];
             reset();
             base_type::tempStart();
@@ -57,6 +61,20 @@ namespace dsp::math {
             return count;
         }
 
+        void reserve(int maxInputSize) {
+            if (maxInputSize == capacity) { return; }
+            capacity = maxInputSize;
+            resizeBuffer(capacity + _delay, _delay);
+            bufStart = &buffer[_delay];
+        }
+
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return (size_t)bufferSize * sizeof(T);
+        }
+
+        DEFAULT_PROC_SIZE
+
         virtual int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -69,8 +87,18 @@ namespace dsp::math {
         }
 
     private:
+        void resizeBuffer(int size, int keep) {
+            T* newBuffer = buffer::alloc<T>(size);
+            memcpy(newBuffer, buffer, keep * sizeof(T));
+            buffer::free(buffer);
+            buffer = newBuffer;
+            bufferSize = size;
+        }
+
         int _delay;
         T* buffer;
         T* bufStart;
+        int bufferSize;
+        int capacity;
     };
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+#include "../types.h"
+#include "../cpu.h"
+#include "fast_atan2.h"
+
+namespace dsp::math {
+    // Computes out[i] = arg(in[i] * conj(in[i - 1])) * gain, in[-1] being prev. Unlike taking the difference of the
+    // phases of the samples it needs a single atan2 per sample and no phase unwrapping.
+    using phase_diff_kernel_t = void (*)(const complex_t* in, complex_t prev, float gain, float* out, int count);
+
+    // All kernels compute polyAtan2() so that their outputs only differ by rounding
+    namespace phase_diff {
+        inline float diff(complex_t cur, complex_t prev) {
+            return polyAtan2(cur.re * prev.re + cur.im * prev.im, cur.im * prev.re - cur.re * prev.im);
+        }
+
+        inline void scalar(const complex_t* in, complex_t prev, float gain, float* out, int count) {
+            for (int i = 0; i < count; i++) {
+                out[i] = diff(in[i], prev) * gain;
+                prev = in[i];
+            }
+        }
+
+#ifdef DSP_CPU_X86
+        DSP_TARGET_AVX2 inline __m256 atan2AVX2(__m256 x, __m256 y) {
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+            const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+            __m256 ax = _mm256_and_ps(x, absMask);
+            __m256 ay = _mm256_and_ps(y, absMask);
+            __m256 mn = _mm256_min_ps(ax, ay);
+            __m256 mx = _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(1e-30f));
+            __m256 a = _mm256_div_ps(mn, mx);
+            __m256 s = _mm256_mul_ps(a, a);
+            __m256 r = _mm256_fmadd_ps(_mm256_set1_ps(POLY_ATAN_C11), s, _mm256_set1_ps(POLY_ATAN_C9));
+            r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(POLY_ATAN_C7));
+            r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(POLY_ATAN_C5));
+            r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(POLY_ATAN_C3));
+            r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(POLY_ATAN_C1));
+            r = _mm256_mul_ps(r, a);
+
+            // Back to the right octant then the right half, the sign of y gives the sign of the result
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(FL_M_PI / 2.0f), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(FL_M_PI), r), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+            __m256 neg = _mm256_and_ps(_mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_LT_OQ), signMask);
+            return _mm256_xor_ps(r, neg);
+        }
+
+        DSP_TARGET_AVX2 inline void avx2(const complex_t* in, complex_t prev, float gain, float* out, int count) {
+            if (count <= 0) { return; }
+            out[0] = diff(in[0], prev) * gain;
+            __m256 g = _mm256_set1_ps(gain);
+            int i = 1;
+            for (; i + 8 <= count; i += 8) {
+                // Split real and imaginary parts, the samples end up in the order 0 1 4 5 2 3 6 7
+                __m256 c0 = _mm256_loadu_ps((const float*)&in[i]);
+                __m256 c1 = _mm256_loadu_ps((const float*)&in[i + 4]);
+                __m256 p0 = _mm256_loadu_ps((const float*)&in[i - 1]);
+                __m256 p1 = _mm256_loadu_ps((const float*)&in[i + 3]);
+                __m256 cr = _mm256_shuffle_ps(c0, c1, 0x88);
+                __m256 ci = _mm256_shuffle_ps(c0, c1, 0xDD);
+                __m256 pr = _mm256_shuffle_ps(p0, p1, 0x88);
+                __m256 pi = _mm256_shuffle_ps(p0, p1, 0xDD);
+
+                // cur * conj(prev)
+                __m256 re = _mm256_fmadd_ps(cr, pr, _mm256_mul_ps(ci, pi));
+                __m256 im = _mm256_fmsub_ps(ci, pr, _mm256_mul_ps(cr, pi));
+                __m256 r = _mm256_mul_ps(atan2AVX2(re, im), g);
+                r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), 0xD8));
+                _mm256_storeu_ps(&out[i], r);
+            }
+            for (; i < count; i++) { out[i] = diff(in[i], in[i - 1]) * gain; }
+        }
+
+        DSP_TARGET_AVX512 inline __m512 atan2AVX512(__m512 x, __m512 y) {
+            const __m512i absMask = _mm512_set1_epi32(0x7FFFFFFF);
+            const __m512i signMask = _mm512_set1_epi32(0x80000000);
+            __m512 ax = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), absMask));
+            __m512 ay = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(y), absMask));
+            __m512 mn = _mm512_min_ps(ax, ay);
+            __m512 mx = _mm512_max_ps(_mm512_max_ps(ax, ay), _mm512_set1_ps(1e-30f));
+            __m512 a = _mm512_div_ps(mn, mx);
+            __m512 s = _mm512_mul_ps(a, a);
+            __m512 r = _mm512_fmadd_ps(_mm512_set1_ps(POLY_ATAN_C11), s, _mm512_set1_ps(POLY_ATAN_C9));
+            r = _mm512_fmadd_ps(r, s, _mm512_set1_ps(POLY_ATAN_C7));
+            r = _mm512_fmadd_ps(r, s, _mm512_set1_ps(POLY_ATAN_C5));
+            r = _mm512_fmadd_ps(r, s, _mm512_set1_ps(POLY_ATAN_C3));
+            r = _mm512_fmadd_ps(r, s, _mm512_set1_ps(POLY_ATAN_C1));
+            r = _mm512_mul_ps(r, a);
+
+            r = _mm512_mask_sub_ps(r, _mm512_cmp_ps_mask(ay, ax, _CMP_GT_OQ), _mm512_set1_ps(FL_M_PI / 2.0f), r);
+            r = _mm512_mask_sub_ps(r, _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ), _mm512_set1_ps(FL_M_PI), r);
+            __m512i neg = _mm512_maskz_mov_epi32(_mm512_cmp_ps_mask(y, _mm512_setzero_ps(), _CMP_LT_OQ), signMask);
+            return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(r), neg));
+        }
+
+        DSP_TARGET_AVX512 inline void avx512(const complex_t* in, complex_t prev, float gain, float* out, int count) {
+            if (count <= 0) { return; }
+            out[0] = diff(in[0], prev) * gain;
+            __m512 g = _mm512_set1_ps(gain);
+            const __m512i order = _mm512_setr_epi32(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+            int i = 1;
+            for (; i + 16 <= count; i += 16) {
+                // Split real and imaginary parts, the samples end up in the order 0 1 8 9 2 3 10 11 4 5 12 13 6 7 14 15
+                __m512 c0 = _mm512_loadu_ps((const float*)&in[i]);
+                __m512 c1 = _mm512_loadu_ps((const float*)&in[i + 8]);
+                __m512 p0 = _mm512_loadu_ps((const float*)&in[i - 1]);
+                __m512 p1 = _mm512_loadu_ps((const float*)&in[i + 7]);
+                __m512 cr = _mm512_shuffle_ps(c0, c1, 0x88);
+                __m512 ci = _mm512_shuffle_ps(c0, c1, 0xDD);
+                __m512 pr = _mm512_shuffle_ps(p0, p1, 0x88);
+                __m512 pi = _mm512_shuffle_ps(p0, p1, 0xDD);
+
+                __m512 re = _mm512_fmadd_ps(cr, pr, _mm512_mul_ps(ci, pi));
+                __m512 im = _mm512_fmsub_ps(ci, pr, _mm512_mul_ps(cr, pi));
+                __m512 r = _mm512_mul_ps(atan2AVX512(re, im), g);
+                _mm512_storeu_ps(&out[i], _mm512_permutexvar_ps(order, r));
+            }
+            for (; i < count; i++) { out[i] = diff(in[i], in[i - 1]) * gain; }
+        }
+#endif
+
+#ifdef DSP_CPU_NEON
+        inline float32x4_t atan2NEON(float32x4_t x, float32x4_t y) {
+            float32x4_t ax = vabsq_f32(x);
+            float32x4_t ay = vabsq_f32(y);
+            float32x4_t mn = vminq_f32(ax, ay);
+            float32x4_t mx = vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(1e-30f));
+            float32x4_t a = vdivq_f32(mn, mx);
+            float32x4_t s = vmulq_f32(a, a);
+            float32x4_t r = vfmaq_f32(vdupq_n_f32(POLY_ATAN_C9), vdupq_n_f32(POLY_ATAN_C11), s);
+            r = vfmaq_f32(vdupq_n_f32(POLY_ATAN_C7), r, s);
+            r = vfmaq_f32(vdupq_n_f32(POLY_ATAN_C5), r, s);
+            r = vfmaq_f32(vdupq_n_f32(POLY_ATAN_C3), r, s);
+            r = vfmaq_f32(vdupq_n_f32(POLY_ATAN_C1), r, s);
+            r = vmulq_f32(r, a);
+
+            r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(FL_M_PI / 2.0f), r), r);
+            r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(FL_M_PI), r), r);
+            return vbslq_f32(vcltq_f32(y, vdupq_n_f32(0.0f)), vnegq_f32(r), r);
+        }
+
+        inline void neon(const complex_t* in, complex_t prev, float gain, float* out, int count) {
+            if (count <= 0) { return; }
+            out[0] = diff(in[0], prev) * gain;
+            int i = 1;
+            for (; i + 4 <= count; i += 4) {
+                float32x4x2_t c = vld2q_f32((const float*)&in[i]);
+                float32x4x2_t p = vld2q_f32((const float*)&in[i - 1]);
+                float32x4_t re = vfmaq_f32(vmulq_f32(c.val[1], p.val[1]), c.val[0], p.val[0]);
+                float32x4_t im = vfmsq_f32(vmulq_f32(c.val[1], p.val[0]), c.val[0], p.val[1]);
+                vst1q_f32(&out[i], vmulq_n_f32(atan2NEON(re, im), gain));
+            }
+            for (; i < count; i++) { out[i] = diff(in[i], in[i - 1]) * gain; }
+        }
+#endif
+
+        // Picks the best kernel supported by the CPU
+        inline phase_diff_kernel_t select() {
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX512()) { return avx512; }
+            if (cpu::hasAVX2()) { return avx2; }
+            return scalar;
+#elif defined(DSP_CPU_NEON)
+            return neon;
+#else
+            return scalar;
+#endif
+        }
+    }
+}
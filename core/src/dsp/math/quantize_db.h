@@ -0,0 +1,42 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+// Dynamic range kept below the peak of a quantized row of dB values
+#define QUANTIZE_DB_RANGE   160.0f
+
+namespace dsp::math {
+    // Quantize a row of dB values to the full range of T over the range of the row, down to QUANTIZE_DB_RANGE below
+    // its peak. Values are converted back as lo + value * step. Non finite values and values below the range become zero.
+    template <class T>
+    inline void quantizeDB(const float* in, T* out, int count, float& lo, float& step) {
+        static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "Unsupported quantized type");
+
+        // Range of the row, non finite values are clipped to the bottom
+        float hi = -INFINITY;
+        float mn = INFINITY;
+        for (int i = 0; i < count; i++) {
+            if (!isfinite(in[i])) { continue; }
+            hi = std::max<float>(hi, in[i]);
+            mn = std::min<float>(mn, in[i]);
+        }
+        if (hi < mn) { hi = mn = 0.0f; }
+        float maxValue = (float)std::numeric_limits<T>::max();
+        lo = std::max<float>(mn, hi - QUANTIZE_DB_RANGE);
+        step = (hi > lo) ? ((hi - lo) / maxValue) : 1.0f;
+
+        float invStep = 1.0f / step;
+        for (int i = 0; i < count; i++) {
+            float q = (in[i] - lo) * invStep + 0.5f;
+            out[i] = (q > 0.0f) ? (T)std::min<float>(q, maxValue) : 0;
+        }
+    }
+
+    template <class T>
+    inline void dequantizeDB(const T* in, float* out, int count, float lo, float step) {
+        for (int i = 0; i < count; i++) { out[i] = lo + (float)in[i] * step; }
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <volk/volk.h>
+#include "../types.h"
+#include "../cpu.h"
+
+namespace dsp::math {
+    // Computes out[i] = in[i] * phase * delta^i. Meant to be called on short tiles with a phase recomputed exactly for
+    // each tile, so the kernels don't renormalize the phasor and only step it with single precision multiplications.
+    using rotator_kernel_t = void (*)(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta);
+
+    namespace rotator {
+        inline complex_t mul(complex_t a, complex_t b) {
+            return { (a.re * b.re) - (a.im * b.im), (a.im * b.re) + (a.re * b.im) };
+        }
+
+        inline void scalar(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta) {
+            for (int i = 0; i < count; i++) {
+                out[i] = mul(in[i], phase);
+                phase = mul(phase, delta);
+            }
+        }
+
+        // Through volk, which renormalizes the phasor on its own
+        inline void generic(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta) {
+            lv_32fc_t ph = lv_cmake(phase.re, phase.im);
+            lv_32fc_t dt = lv_cmake(delta.re, delta.im);
+#if VOLK_VERSION >= 030100
+            volk_32fc_s32fc_x2_rotator2_32fc((lv_32fc_t*)out, (const lv_32fc_t*)in, &dt, &ph, count);
+#else
+            volk_32fc_s32fc_x2_rotator_32fc((lv_32fc_t*)out, (const lv_32fc_t*)in, dt, &ph, count);
+#endif
+        }
+
+#ifdef DSP_CPU_X86
+        // Product of interleaved complex numbers
+        DSP_TARGET_AVX2 inline __m256 cmulAVX2(__m256 a, __m256 b) {
+            __m256 br = _mm256_moveldup_ps(b);
+            __m256 bi = _mm256_movehdup_ps(b);
+            __m256 as = _mm256_permute_ps(a, 0xB1);
+            return _mm256_fmaddsub_ps(a, br, _mm256_mul_ps(as, bi));
+        }
+
+        DSP_TARGET_AVX2 inline void avx2(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta) {
+            // One phasor per lane, each lane steps by delta^4
+            complex_t p1 = mul(phase, delta);
+            complex_t p2 = mul(p1, delta);
+            complex_t p3 = mul(p2, delta);
+            complex_t d2 = mul(delta, delta);
+            complex_t d4 = mul(d2, d2);
+            __m256 ph = _mm256_setr_ps(phase.re, phase.im, p1.re, p1.im, p2.re, p2.im, p3.re, p3.im);
+            __m256 step = _mm256_setr_ps(d4.re, d4.im, d4.re, d4.im, d4.re, d4.im, d4.re, d4.im);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm256_storeu_ps((float*)&out[i], cmulAVX2(_mm256_loadu_ps((const float*)&in[i]), ph));
+                ph = cmulAVX2(ph, step);
+            }
+
+            // The first lane holds the phase of the next sample
+            alignas(32) complex_t rem[4];
+            _mm256_store_ps((float*)rem, ph);
+            scalar(&in[i], &out[i], count - i, rem[0], delta);
+        }
+
+        DSP_TARGET_AVX512 inline __m512 cmulAVX512(__m512 a, __m512 b) {
+            __m512 br = _mm512_moveldup_ps(b);
+            __m512 bi = _mm512_movehdup_ps(b);
+            __m512 as = _mm512_permute_ps(a, 0xB1);
+            return _mm512_fmaddsub_ps(a, br, _mm512_mul_ps(as, bi));
+        }
+
+        DSP_TARGET_AVX512 inline void avx512(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta) {
+            // One phasor per lane, each lane steps by delta^8
+            alignas(64) complex_t init[8];
+            alignas(64) complex_t d8[8];
+            init[0] = phase;
+            for (int k = 1; k < 8; k++) { init[k] = mul(init[k - 1], delta); }
+            complex_t d2 = mul(delta, delta);
+            complex_t d4 = mul(d2, d2);
+            d8[0] = mul(d4, d4);
+            for (int k = 1; k < 8; k++) { d8[k] = d8[0]; }
+            __m512 ph = _mm512_load_ps((const float*)init);
+            __m512 step = _mm512_load_ps((const float*)d8);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm512_storeu_ps((float*)&out[i], cmulAVX512(_mm512_loadu_ps((const float*)&in[i]), ph));
+                ph = cmulAVX512(ph, step);
+            }
+
+            _mm512_store_ps((float*)init, ph);
+            scalar(&in[i], &out[i], count - i, init[0], delta);
+        }
+#endif
+
+#ifdef DSP_CPU_NEON
+        inline void neon(const complex_t* in, complex_t* out, int count, complex_t phase, complex_t delta) {
+            // Split phasors, one per lane, each lane steps by delta^4
+            float pr[4], pi[4];
+            complex_t p = phase;
+            for (int k = 0; k < 4; k++) {
+                pr[k] = p.re;
+                pi[k] = p.im;
+                p = mul(p, delta);
+            }
+            complex_t d2 = mul(delta, delta);
+            complex_t d4 = mul(d2, d2);
+            float32x4_t phr = vld1q_f32(pr);
+            float32x4_t phi = vld1q_f32(pi);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                float32x4x2_t x = vld2q_f32((const float*)&in[i]);
+                float32x4x2_t y;
+                y.val[0] = vfmsq_f32(vmulq_f32(x.val[0], phr), x.val[1], phi);
+                y.val[1] = vfmaq_f32(vmulq_f32(x.val[1], phr), x.val[0], phi);
+                vst2q_f32((float*)&out[i], y);
+                float32x4_t nr = vfmsq_n_f32(vmulq_n_f32(phr, d4.re), phi, d4.im);
+                phi = vfmaq_n_f32(vmulq_n_f32(phi, d4.re), phr, d4.im);
+                phr = nr;
+            }
+            scalar(&in[i], &out[i], count - i, { vgetq_lane_f32(phr, 0), vgetq_lane_f32(phi, 0) }, delta);
+        }
+#endif
+
+        // Picks the best kernel supported by the CPU
+        inline rotator_kernel_t select() {
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX512()) { return avx512; }
+            if (cpu::hasAVX2()) { return avx2; }
+            return generic;
+#elif defined(DSP_CPU_NEON)
+            return neon;
+#else
+            return generic;
+#endif
+        }
+    }
+}
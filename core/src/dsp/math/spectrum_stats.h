@@ -0,0 +1,223 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "../cpu.h"
+
+// Bins per block of the tables, the bins of a range that only partly cover a block are scanned directly
+#define SPECTRUM_STATS_BLOCK    64
+
+namespace dsp::math {
+    // Tables built once per spectrum so that the sum and the max of any range of bins take constant time, which keeps
+    // the signal info of any number of VFOs cheap. They hold prefix sums of the block sums along with a count of the
+    // blocks summing to -inf, so that a range with a -inf bin sums to -inf like a plain loop would, and a sparse table
+    // of block maxima. A query only reads the bins of the at most two blocks its range partly covers.
+    class SpectrumStats {
+    public:
+        SpectrumStats() {}
+
+        void build(const float* spectrum, int size) {
+            _spectrum = spectrum;
+            int blocks = size / SPECTRUM_STATS_BLOCK;
+            blockCount = blocks;
+            levels = 1;
+            while ((1 << levels) <= blocks) { levels++; }
+            sums.resize(blocks + 1);
+            negInfs.resize(blocks + 1);
+            table.resize((size_t)levels * blocks);
+
+            // Sum and max of each whole block
+            double acc = 0.0;
+            int infs = 0;
+            sums[0] = 0.0;
+            negInfs[0] = 0;
+            for (int b = 0; b < blocks; b++) {
+                float sum;
+                scanBlock(&spectrum[b * SPECTRUM_STATS_BLOCK], sum, table[b]);
+                if (isfinite(sum)) { acc += sum; }
+                else { infs++; }
+                sums[b + 1] = acc;
+                negInfs[b + 1] = infs;
+            }
+
+            // Max of each power of two run of blocks
+            for (int l = 1; l < levels; l++) {
+                const float* prev = &table[(size_t)(l - 1) * blocks];
+                float* cur = &table[(size_t)l * blocks];
+                int half = 1 << (l - 1);
+                for (int b = 0; b + (1 << l) <= blocks; b++) {
+                    cur[b] = std::max<float>(prev[b], prev[b + half]);
+                }
+            }
+        }
+
+        // Sum of bins first to last - 1
+        double sum(int first, int last) {
+            if (last <= first) { return 0.0; }
+            int firstBlock, lastBlock;
+            if (!wholeBlocks(first, last, firstBlock, lastBlock)) { return scanSum(first, last); }
+            double s = (double)scanSum(first, firstBlock * SPECTRUM_STATS_BLOCK) + (double)scanSum(lastBlock * SPECTRUM_STATS_BLOCK, last);
+            if (negInfs[lastBlock] != negInfs[firstBlock]) { return -INFINITY; }
+            return s + (sums[lastBlock] - sums[firstBlock]);
+        }
+
+        // Max of bins first to last - 1, -INFINITY for an empty range
+        float max(int first, int last) {
+            if (last <= first) { return -INFINITY; }
+            int firstBlock, lastBlock;
+            if (!wholeBlocks(first, last, firstBlock, lastBlock)) { return scanMax(first, last); }
+            float m = std::max<float>(scanMax(first, firstBlock * SPECTRUM_STATS_BLOCK), scanMax(lastBlock * SPECTRUM_STATS_BLOCK, last));
+            int l = 0;
+            while ((2 << l) <= lastBlock - firstBlock) { l++; }
+            const float* row = &table[(size_t)l * blockCount];
+            return std::max<float>(m, std::max<float>(row[firstBlock], row[lastBlock - (1 << l)]));
+        }
+
+    private:
+        // Whole blocks covered by a range, false if there are none
+        inline bool wholeBlocks(int first, int last, int& firstBlock, int& lastBlock) {
+            firstBlock = (first + SPECTRUM_STATS_BLOCK - 1) / SPECTRUM_STATS_BLOCK;
+            lastBlock = std::min<int>(last / SPECTRUM_STATS_BLOCK, blockCount);
+            return lastBlock > firstBlock;
+        }
+
+        void scanBlock(const float* x, float& sum, float& max) {
+#ifdef DSP_CPU_X86
+            if (cpu::hasAVX2()) {
+                scanBlockAVX2(x, sum, max);
+                return;
+            }
+#endif
+            sum = 0.0f;
+            max = -INFINITY;
+            for (int i = 0; i < SPECTRUM_STATS_BLOCK; i++) {
+                sum += x[i];
+                max = std::max<float>(max, x[i]);
+            }
+        }
+
+        float scanSum(int first, int last) {
+            const float* x = &_spectrum[first];
+            int count = last - first;
+            float s = 0.0f;
+            int i = 0;
+#ifdef DSP_CPU_X86
+            if (cpu::hasAVX2()) { i = scanAVX2(x, count, s, false); }
+#endif
+            for (; i < count; i++) { s += x[i]; }
+            return s;
+        }
+
+        float scanMax(int first, int last) {
+            const float* x = &_spectrum[first];
+            int count = last - first;
+            float m = -INFINITY;
+            int i = 0;
+#ifdef DSP_CPU_X86
+            if (cpu::hasAVX2()) { i = scanAVX2(x, count, m, true); }
+#endif
+            for (; i < count; i++) { m = std::max<float>(m, x[i]); }
+            return m;
+        }
+
+#ifdef DSP_CPU_X86
+        DSP_TARGET_AVX2 static inline float hsum(__m256 v) {
+            __m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+            return _mm_cvtss_f32(_mm_add_ss(r, _mm_movehdup_ps(r)));
+        }
+
+        DSP_TARGET_AVX2 static inline float hmax(__m256 v) {
+            __m128 r = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+            return _mm_cvtss_f32(_mm_max_ss(r, _mm_movehdup_ps(r)));
+        }
+
+        DSP_TARGET_AVX2 static void scanBlockAVX2(const float* x, float& sum, float& max) {
+            __m256 s0 = _mm256_loadu_ps(x);
+            __m256 s1 = _mm256_loadu_ps(&x[8]);
+            __m256 m0 = s0;
+            __m256 m1 = s1;
+            for (int i = 16; i < SPECTRUM_STATS_BLOCK; i += 16) {
+                __m256 a = _mm256_loadu_ps(&x[i]);
+                __m256 b = _mm256_loadu_ps(&x[i + 8]);
+                s0 = _mm256_add_ps(s0, a);
+                s1 = _mm256_add_ps(s1, b);
+                m0 = _mm256_max_ps(m0, a);
+                m1 = _mm256_max_ps(m1, b);
+            }
+            sum = hsum(_mm256_add_ps(s0, s1));
+            max = hmax(_mm256_max_ps(m0, m1));
+        }
+
+        // Sum or max of the first count & ~7 values combined into acc, returns how many were read
+        DSP_TARGET_AVX2 static int scanAVX2(const float* x, int count, float& acc, bool max) {
+            if (count < 8) { return 0; }
+            __m256 v = _mm256_loadu_ps(x);
+            int i = 8;
+            if (max) {
+                for (; i + 8 <= count; i += 8) { v = _mm256_max_ps(v, _mm256_loadu_ps(&x[i])); }
+                acc = std::max<float>(acc, hmax(v));
+            }
+            else {
+                for (; i + 8 <= count; i += 8) { v = _mm256_add_ps(v, _mm256_loadu_ps(&x[i])); }
+                acc += hsum(v);
+            }
+            return i;
+        }
+#endif
+
+        const float* _spectrum = NULL;
+        int blockCount = 0;
+        int levels = 0;
+        std::vector<double> sums;
+        std::vector<int> negInfs;
+        std::vector<float> table;
+    };
+
+#ifdef DSP_CPU_X86
+    // Both return how many values were processed, a multiple of 8
+    DSP_TARGET_AVX2 inline int smoothAVX2(float* in, float* avg, float alpha, float beta, int count) {
+        __m256 a = _mm256_set1_ps(alpha);
+        __m256 b = _mm256_set1_ps(beta);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 s = _mm256_fmadd_ps(a, _mm256_loadu_ps(&in[i]), _mm256_mul_ps(b, _mm256_loadu_ps(&avg[i])));
+            _mm256_storeu_ps(&avg[i], s);
+            _mm256_storeu_ps(&in[i], s);
+        }
+        return i;
+    }
+
+    DSP_TARGET_AVX2 inline int holdAVX2(const float* in, float* hold, float decay, int count) {
+        __m256 d = _mm256_set1_ps(decay);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(&hold[i], _mm256_max_ps(_mm256_loadu_ps(&in[i]), _mm256_sub_ps(_mm256_loadu_ps(&hold[i]), d)));
+        }
+        return i;
+    }
+#endif
+
+    // Exponential smoothing in place, avg = alpha * in + beta * avg with the result also written back to in
+    inline void smooth(float* in, float* avg, float alpha, float beta, int count) {
+        int i = 0;
+#ifdef DSP_CPU_X86
+        if (cpu::hasAVX2()) { i = smoothAVX2(in, avg, alpha, beta, count); }
+#endif
+        for (; i < count; i++) {
+            avg[i] = alpha * in[i] + beta * avg[i];
+            in[i] = avg[i];
+        }
+    }
+
+    // Peak hold decaying by a fixed amount per call, hold = max(in, hold - decay)
+    inline void hold(const float* in, float* hold, float decay, int count) {
+        int i = 0;
+#ifdef DSP_CPU_X86
+        if (cpu::hasAVX2()) { i = holdAVX2(in, hold, decay, count); }
+#endif
+        for (; i < count; i++) { hold[i] = std::max<float>(in[i], hold[i] - decay); }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <map>
+#include <stdint.h>
+#include <mutex>
+#include <typeinfo>
+
+namespace dsp {
+    class untyped_stream;
+    class block;
+
+    namespace memory {
+        // Keeps track of all live objects of a type so their memory usage can be reported. Objects must only be listed
+        // while fully built, their type is taken when they're added so that reports don't need to look it up.
+        // Each time an object is added it gets a new id, unlike its address it's never reused by another object.
+        template <class T>
+        class Registry {
+        public:
+            void add(T* obj) {
+                std::lock_guard<std::mutex> lck(mtx);
+                objects[obj] = { &typeid(*obj), nextId++ };
+            }
+
+            void remove(T* obj) {
+                std::lock_guard<std::mutex> lck(mtx);
+                objects.erase(obj);
+            }
+
+            // Objects can't be removed while the function runs
+            template <typename Func>
+            void forEach(Func func) {
+                std::lock_guard<std::mutex> lck(mtx);
+                for (auto& [obj, entry] : objects) { func(obj, *entry.type, entry.id); }
+            }
+
+        private:
+            struct Entry {
+                const std::type_info* type;
+                uint64_t id;
+            };
+
+            std::mutex mtx;
+            std::map<T*, Entry> objects;
+            uint64_t nextId = 0;
+        };
+
+        // Never freed since streams and blocks with static storage may be destroyed after them
+        inline Registry<untyped_stream>& streams() {
+            static Registry<untyped_stream>* reg = new Registry<untyped_stream>();
+            return *reg;
+        }
+
+        inline Registry<block>& blocks() {
+            static Registry<block>* reg = new Registry<block>();
+            return *reg;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <typeinfo>
+#include <algorithm>
+#include <stdlib.h>
+#if defined(__GNUC__) || defined(__clang__)
+#include <cxxabi.h>
+#endif
+#include "block.h"
+
+namespace dsp::memory {
+    struct Usage {
+        std::string name;
+        const void* object;
+        size_t bytes;
+    };
+
+    inline std::string typeName(const std::type_info& info) {
+#if defined(__GNUC__) || defined(__clang__)
+        int status = 0;
+        char* name = abi::__cxa_demangle(info.name(), NULL, NULL, &status);
+        if (status == 0 && name) {
+            std::string str = name;
+            ::free(name);
+            return str;
+        }
+#endif
+        return info.name();
+    }
+
+    // Bytes held by the buffers of every live stream, largest first
+    inline std::vector<Usage> getStreamUsage() {
+        std::vector<Usage> usage;
+        streams().forEach([&](untyped_stream* stream, const std::type_info& type, uint64_t id) {
+            usage.push_back({ typeName(type), stream, stream->getMemoryUsage() });
+        });
+        std::sort(usage.begin(), usage.end(), [](const Usage& a, const Usage& b) { return a.bytes > b.bytes; });
+        return usage;
+    }
+
+    // Bytes held by the work buffers of every running block, including the blocks it runs, largest first.
+    // Blocks that are being reconfigured are left out.
+    inline std::vector<Usage> getBlockUsage() {
+        std::vector<Usage> usage;
+        blocks().forEach([&](block* blk, const std::type_info& type, uint64_t id) {
+            size_t bytes;
+            if (!blk->tryGetMemoryUsage(bytes)) { return; }
+            usage.push_back({ typeName(type), blk, bytes });
+        });
+        std::sort(usage.begin(), usage.end(), [](const Usage& a, const Usage& b) { return a.bytes > b.bytes; });
+        return usage;
+    }
+
+    inline size_t getTotalStreamUsage(int* count = NULL) {
+        size_t total = 0;
+        int n = 0;
+        streams().forEach([&](untyped_stream* stream, const std::type_info& type, uint64_t id) {
+            total += stream->getMemoryUsage();
+            n++;
+        });
+        if (count) { *count = n; }
+        return total;
+    }
+
+    inline size_t getTotalBlockUsage(int* count = NULL) {
+        size_t total = 0;
+        int n = 0;
+        blocks().forEach([&](block* blk, const std::type_info& type, uint64_t id) {
+            size_t bytes = 0;
+            blk->tryGetMemoryUsage(bytes);
+            total += bytes;
+            n++;
+        });
+        if (count) { *count = n; }
+        return total;
+    }
+}
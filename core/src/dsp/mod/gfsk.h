@@ -62,6 +62,14 @@ namespace dsp::mod {
             return count;
         }
 
+        size_t getMemoryUsage() {
+            return interp.getMemoryUsage();
+        }
+
+        void reserve(int maxInputSize) {
+            interp.reserve(maxInputSize);
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -0,0 +1,179 @@
+#pragma once
+#include <type_traits>
+#include "../../types.h"
+#include "../../cpu.h"
+#include "plans.h"
+
+namespace dsp::multirate::decim {
+    // Computes outputs first to last - 1 of a decimating FIR, output j being the dot product of the taps with data[j * decimation]
+    template <class T>
+    using kernel_t = void (*)(const T* data, int first, int last, int decimation, const float* taps, T* out);
+
+    // Kernels for the taps of the decimation plans, which are all symmetric. The tap count is a template parameter so that
+    // the loops are fully known at compile time, and the symmetry is used to add the mirrored samples before multiplying,
+    // halving the number of multiplications. Real samples have one float per sample, complex and stereo samples two.
+    namespace kernels {
+        template <class T>
+        inline constexpr int width = sizeof(T) / sizeof(float);
+
+        template <class T, int N>
+        inline void scalar(const T* data, int first, int last, int decimation, const float* taps, T* out) {
+            constexpr int W = width<T>;
+            const float* in = (const float*)data;
+            float* res = (float*)out;
+            for (int j = first; j < last; j++) {
+                const float* x = &in[W * j * decimation];
+                float acc[W] = {};
+                for (int i = 0; i < N / 2; i++) {
+                    for (int c = 0; c < W; c++) { acc[c] += (x[W * i + c] + x[W * (N - 1 - i) + c]) * taps[i]; }
+                }
+                if constexpr (N % 2) {
+                    for (int c = 0; c < W; c++) { acc[c] += x[W * (N / 2) + c] * taps[N / 2]; }
+                }
+                for (int c = 0; c < W; c++) { res[W * j + c] = acc[c]; }
+            }
+        }
+
+#ifdef DSP_CPU_X86
+        template <class T, int N>
+        DSP_TARGET_AVX2 void avx2(const T* data, int first, int last, int decimation, const float* taps, T* out) {
+            constexpr int W = width<T>;
+            constexpr int S = 8 / W;            // Samples per vector
+            constexpr int H = N / 2;
+            const float* in = (const float*)data;
+            float* res = (float*)out;
+            for (int j = first; j < last; j++) {
+                const float* x = &in[W * j * decimation];
+                __m256 acc = _mm256_setzero_ps();
+                int i = 0;
+                for (; i + S <= H; i += S) {
+                    __m256 a = _mm256_loadu_ps(&x[W * i]);
+                    __m256 b = _mm256_loadu_ps(&x[W * (N - S - i)]);
+                    __m256 h;
+                    if constexpr (W == 2) {
+                        // Reverse the order of the complex samples and give each tap to both parts
+                        b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(b), 0x1B));
+                        __m128 t = _mm_loadu_ps(&taps[i]);
+                        h = _mm256_set_m128(_mm_unpackhi_ps(t, t), _mm_unpacklo_ps(t, t));
+                    }
+                    else {
+                        b = _mm256_permutevar8x32_ps(b, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+                        h = _mm256_loadu_ps(&taps[i]);
+                    }
+                    acc = _mm256_fmadd_ps(_mm256_add_ps(a, b), h, acc);
+                }
+
+                // Horizontal sum, leaving one sample in the lowest lanes
+                __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+                if constexpr (W == 1) { sum = _mm_add_ss(sum, _mm_movehdup_ps(sum)); }
+                float r[4];
+                _mm_storeu_ps(r, sum);
+
+                // Leftover taps and center tap
+                if constexpr (H % S) {
+                    for (; i < H; i++) {
+                        for (int c = 0; c < W; c++) { r[c] += (x[W * i + c] + x[W * (N - 1 - i) + c]) * taps[i]; }
+                    }
+                }
+                if constexpr (N % 2) {
+                    for (int c = 0; c < W; c++) { r[c] += x[W * H + c] * taps[H]; }
+                }
+                for (int c = 0; c < W; c++) { res[W * j + c] = r[c]; }
+            }
+        }
+#endif
+
+#ifdef DSP_CPU_NEON
+        template <class T, int N>
+        void neon(const T* data, int first, int last, int decimation, const float* taps, T* out) {
+            constexpr int W = width<T>;
+            constexpr int S = 4 / W;            // Samples per vector
+            constexpr int H = N / 2;
+            const float* in = (const float*)data;
+            float* res = (float*)out;
+            for (int j = first; j < last; j++) {
+                const float* x = &in[W * j * decimation];
+                float32x4_t acc = vdupq_n_f32(0.0f);
+                int i = 0;
+                for (; i + S <= H; i += S) {
+                    float32x4_t a = vld1q_f32(&x[W * i]);
+                    float32x4_t b = vld1q_f32(&x[W * (N - S - i)]);
+                    float32x4_t h;
+                    if constexpr (W == 2) {
+                        // Reverse the order of the complex samples and give each tap to both parts
+                        b = vextq_f32(b, b, 2);
+                        float32x2_t t = vld1_f32(&taps[i]);
+                        float32x4_t tt = vcombine_f32(t, t);
+                        h = vzip1q_f32(tt, tt);
+                    }
+                    else {
+                        b = vrev64q_f32(b);
+                        b = vextq_f32(b, b, 2);
+                        h = vld1q_f32(&taps[i]);
+                    }
+                    acc = vfmaq_f32(acc, vaddq_f32(a, b), h);
+                }
+
+                float r[2];
+                if constexpr (W == 2) {
+                    vst1_f32(r, vadd_f32(vget_low_f32(acc), vget_high_f32(acc)));
+                }
+                else {
+                    r[0] = vaddvq_f32(acc);
+                }
+
+                // Leftover taps and center tap
+                if constexpr (H % S) {
+                    for (; i < H; i++) {
+                        for (int c = 0; c < W; c++) { r[c] += (x[W * i + c] + x[W * (N - 1 - i) + c]) * taps[i]; }
+                    }
+                }
+                if constexpr (N % 2) {
+                    for (int c = 0; c < W; c++) { r[c] += x[W * H + c] * taps[H]; }
+                }
+                for (int c = 0; c < W; c++) { res[W * j + c] = r[c]; }
+            }
+        }
+#endif
+
+        // Picks the best kernel supported by the CPU
+        template <class T, int N>
+        inline kernel_t<T> select() {
+#if defined(DSP_CPU_X86)
+            if (cpu::hasAVX2()) { return avx2<T, N>; }
+            return scalar<T, N>;
+#elif defined(DSP_CPU_NEON)
+            return neon<T, N>;
+#else
+            return scalar<T, N>;
+#endif
+        }
+    }
+
+    // Kernel for the plan taps with the given tap count, NULL if there is none and the generic FIR must be used
+    template <class T>
+    inline kernel_t<T> getKernel(int tapCount) {
+        if constexpr (!std::is_same_v<T, float> && !std::is_same_v<T, complex_t> && !std::is_same_v<T, stereo_t>) {
+            return NULL;
+        }
+        else {
+            switch (tapCount) {
+                case fir_2_2_len:       return kernels::select<T, fir_2_2_len>();
+                case fir_4_2_len:       return kernels::select<T, fir_4_2_len>();
+                case fir_8_4_len:       return kernels::select<T, fir_8_4_len>();
+                case fir_16_8_len:      return kernels::select<T, fir_16_8_len>();
+                case fir_32_8_len:      return kernels::select<T, fir_32_8_len>();
+                case fir_64_8_len:      return kernels::select<T, fir_64_8_len>();
+                case fir_128_16_len:    return kernels::select<T, fir_128_16_len>();
+                case fir_256_32_len:    return kernels::select<T, fir_256_32_len>();
+                case fir_512_32_len:    return kernels::select<T, fir_512_32_len>();
+                case fir_1024_64_len:   return kernels::select<T, fir_1024_64_len>();
+                case fir_2048_64_len:   return kernels::select<T, fir_2048_64_len>();
+                case fir_4096_64_len:   return kernels::select<T, fir_4096_64_len>();
+                case fir_8192_128_len:  return kernels::select<T, fir_8192_128_len>();
+                default:                return NULL;
+            }
+        }
+    }
+}
@@ -27,8 +27,10 @@ namespace dsp::multirate {
             // Build filter bank
             phases = buildPolyphaseBank(_interp, _taps);
 
-            // Allocate delay buffer
-            buffer = buffer::alloc<T>(STREAM_BUFFER_SIZE + 64000);
+            // Allocate delay buffer, it's sized again from the input once started
+            capacity = in ? in->getBufferSize() : STREAM_BUFFER_SIZE;
+            bufferSize = capacity + phases.tapsPerPhase - 1;
+            buffer = buffer::alloc<T>(bufferSize);
             bufStart = &buffer[phases.tapsPerPhase - 1];
             buffer::clear<T>(buffer, phases.tapsPerPhase - 1);
 
@@ -49,7 +51,8 @@ namespace dsp::multirate {
             freePolyphaseBank(phases);
             phases = buildPolyphaseBank(_interp, _taps);
 
-            // Reset buffer
+            // Reset buffer, the history is cleared anyway
+            if (capacity + phases.tapsPerPhase - 1 > bufferSize) { resizeBuffer(capacity + phases.tapsPerPhase - 1, 0); }
             bufStart = &buffer[phases.tapsPerPhase - 1];
             reset();
 
@@ -98,6 +101,25 @@ namespace dsp::multirate {
             return outCount;
         }
 
+        int maxOutputSize(int maxInputSize) {
+            // The delay carried over from the last call can add up to one output
+            return (int)((((int64_t)maxInputSize + 1) * _interp) / _decim) + 1;
+        }
+
+        void reserve(int maxInputSize) {
+            if (maxInputSize == capacity) { return; }
+            capacity = maxInputSize;
+            resizeBuffer(capacity + phases.tapsPerPhase - 1, phases.tapsPerPhase - 1);
+            bufStart = &buffer[phases.tapsPerPhase - 1];
+        }
+
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return (size_t)bufferSize * sizeof(T);
+        }
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -113,6 +135,15 @@ namespace dsp::multirate {
         }
 
     protected:
+        // Reallocate the delay buffer, keeping its first samples
+        void resizeBuffer(int size, int keep) {
+            T* newBuffer = buffer::alloc<T>(size);
+            memcpy(newBuffer, buffer, keep * sizeof(T));
+            buffer::free(buffer);
+            buffer = newBuffer;
+            bufferSize = size;
+        }
+
         int _interp;
         int _decim;
         tap<float> _taps;
@@ -121,6 +152,8 @@ namespace dsp::multirate {
         int offset = 0;
         T* buffer;
         T* bufStart;
+        int bufferSize;
+        int capacity;
 
     };
 }
\ No newline at end of file
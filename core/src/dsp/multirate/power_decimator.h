@@ -1,7 +1,12 @@
 #pragma once
 #include "../filter/decimating_fir.h"
 #include "../taps/from_array.h"
+#include "../worker_group.h"
 #include "decim/plans.h"
+#include "decim/kernels.h"
+
+// Least number of first stage outputs given to each thread, below this the stage isn't worth splitting
+#define POWER_DECIMATOR_MIN_TILE    256
 
 namespace dsp::multirate {
     template<class T>
@@ -38,6 +43,31 @@ namespace dsp::multirate {
             base_type::tempStart();
         }
 
+        // Number of threads computing the first stage, which does most of the work at high ratios
+        void setThreadCount(int threads) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            workers.setThreadCount(threads);
+            base_type::tempStart();
+        }
+
+        int getThreadCount() {
+            return workers.getThreadCount();
+        }
+
+        // Run the stages with the kernels specialized for the plan taps instead of the generic FIR, on by default
+        void setUseKernels(bool enabled) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            useKernels = enabled;
+            for (int i = 0; i < decimFirs.size(); i++) {
+                decimFirs[i]->setKernel(useKernels ? decim::getKernel<T>(decimTaps[i].size) : NULL);
+            }
+            base_type::tempStart();
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -55,10 +85,25 @@ namespace dsp::multirate {
                 return count;
             }
             
-            // Process data through each stage
-            const T* data = in;
-            int last = stageCount - 1;
-            for (int i = 0; i < stageCount; i++) {
+            // The outputs of the first stage are split into tiles which all read the same input and history
+            auto first = decimFirs[0];
+            int outCount = first->prepare(count, in);
+            int tiles = std::min<int>(workers.getThreadCount(), outCount / POWER_DECIMATOR_MIN_TILE);
+            if (tiles > 1) {
+                workers.run([=](int part) {
+                    if (part >= tiles) { return; }
+                    first->convolve((outCount * part) / tiles, (outCount * (part + 1)) / tiles, out);
+                });
+            }
+            else {
+                first->convolve(0, outCount, out);
+            }
+            first->finish(count, outCount);
+            count = outCount;
+
+            // Process data through the other stages
+            const T* data = out;
+            for (int i = 1; i < stageCount; i++) {
                 auto fir = decimFirs[i];
                 count = fir->process(count, data, out);
                 data = out;
@@ -66,6 +111,25 @@ namespace dsp::multirate {
             return count;
         }
 
+        int maxOutputSize(int maxInputSize) {
+            // Each stage outputs less than the previous one so the first is the largest
+            if (_ratio == 1) { return maxInputSize; }
+            return decimFirs[0]->maxOutputSize(maxInputSize);
+        }
+
+        void reserve(int maxInputSize) {
+            maxInput = maxInputSize;
+            reserveStages();
+        }
+
+        size_t getMemoryUsage() {
+            size_t total = 0;
+            for (auto& fir : decimFirs) { total += fir->getMemoryUsage(); }
+            return total;
+        }
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -101,10 +165,21 @@ namespace dsp::multirate {
                     tap<float> taps = taps::fromArray<float>(plan.stages[i].tapcount, plan.stages[i].taps);
                     auto fir = new filter::DecimatingFIR<T, float>(NULL, taps, plan.stages[i].decimation);
                     fir->out.free();
+                    if (useKernels) { fir->setKernel(decim::getKernel<T>(plan.stages[i].tapcount)); }
                     decimTaps.push_back(taps);
                     decimFirs.push_back(fir);
                 }
             }
+            reserveStages();
+        }
+
+        void reserveStages() {
+            // Each stage is given what the previous one outputs
+            int size = maxInput;
+            for (auto& fir : decimFirs) {
+                fir->reserve(size);
+                size = fir->maxOutputSize(size);
+            }
         }
 
         bool checkRatio(unsigned int ratio) {
@@ -116,5 +191,8 @@ namespace dsp::multirate {
         std::vector<tap<float>> decimTaps;
         unsigned int _ratio;
         int stageCount;
+        int maxInput = STREAM_BUFFER_SIZE;
+        bool useKernels = true;
+        WorkerGroup workers;
     };
 }
\ No newline at end of file
@@ -95,6 +95,32 @@ namespace dsp::multirate {
             return count;
         }
 
+        int maxOutputSize(int maxInputSize) {
+            switch(mode) {
+                case Mode::BOTH:
+                    // The decimator output is stored in the output buffer before resampling
+                    return std::max<int>(decim.maxOutputSize(maxInputSize), resamp.maxOutputSize(decim.maxOutputSize(maxInputSize)));
+                case Mode::DECIM_ONLY:
+                    return decim.maxOutputSize(maxInputSize);
+                case Mode::RESAMP_ONLY:
+                    return resamp.maxOutputSize(maxInputSize);
+                case Mode::NONE:
+                    return maxInputSize;
+            }
+            return -1;
+        }
+
+        void reserve(int maxInputSize) {
+            maxInput = maxInputSize;
+            reserveStages();
+        }
+
+        size_t getMemoryUsage() {
+            return decim.getMemoryUsage() + resamp.getMemoryUsage();
+        }
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -147,6 +173,7 @@ namespace dsp::multirate {
             // If the power decimator already did all the work, don't use the resampler
             if (interp == decim) {
                 mode = useDecim ? Mode::DECIM_ONLY : Mode::NONE;
+                reserveStages();
                 return;
             }
 
@@ -162,6 +189,13 @@ namespace dsp::multirate {
             printf("[Resamp] predec: %d, interp: %d, decim: %d, inacc: %lf%%, taps: %d\n", predecRatio, interp, decim, error, rtaps.size);
 
             mode = useDecim ? Mode::BOTH : Mode::RESAMP_ONLY;
+            reserveStages();
+        }
+
+        void reserveStages() {
+            // The resampler is given the output of the decimator when both are used
+            decim.reserve(maxInput);
+            resamp.reserve((mode == Mode::BOTH) ? decim.maxOutputSize(maxInput) : maxInput);
         }
         
         PowerDecimator<T> decim;
@@ -170,5 +204,6 @@ namespace dsp::multirate {
         double _inSamplerate;
         double _outSamplerate;
         Mode mode;
+        int maxInput = STREAM_BUFFER_SIZE;
     };
 }
\ No newline at end of file
@@ -57,6 +57,14 @@ namespace dsp::multirate {
             return resamp.process(count, in, out);
         }
 
+        void reserve(int maxInputSize) {
+            resamp.reserve(maxInputSize);
+        }
+
+        size_t getMemoryUsage() {
+            return resamp.getMemoryUsage();
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
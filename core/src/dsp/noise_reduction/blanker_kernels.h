@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <volk/volk.h>
+#include "../types.h"
+#include "../cpu.h"
+
+namespace dsp::noise_reduction::blanker {
+    // Blanks count samples and returns the new average amplitude. The average follows
+    // amp = amp * (1 - rate) + |in[i]| * rate, skipping zero samples, and samples more than level times
+    // above it are scaled back down to the average.
+    using kernel_t = float (*)(const complex_t* in, complex_t* out, int count, float amp, float rate, float level);
+
+    // Samples per volk call of the generic kernel
+    inline constexpr int CHUNK_SIZE = 256;
+
+    inline float step(float inAmp, float& amp, float rate, float invRate, float level) {
+        if (inAmp == 0.0f) { return 1.0f; }
+        amp = (amp * invRate) + (inAmp * rate);
+        float excess = inAmp / amp;
+        return (excess > level) ? (1.0f / excess) : 1.0f;
+    }
+
+    inline void stepSample(const complex_t& in, complex_t& out, float& amp, float rate, float invRate, float level) {
+        float gain = step(sqrtf((in.re * in.re) + (in.im * in.im)), amp, rate, invRate, level);
+        out = { in.re * gain, in.im * gain };
+    }
+
+    // Envelope and gain application through volk, only the recurrence itself is scalar
+    inline float generic(const complex_t* in, complex_t* out, int count, float amp, float rate, float level) {
+        float invRate = 1.0f - rate;
+        float env[CHUNK_SIZE];
+        for (int i = 0; i < count; i += CHUNK_SIZE) {
+            int n = std::min<int>(CHUNK_SIZE, count - i);
+            volk_32fc_magnitude_32f(env, (const lv_32fc_t*)&in[i], n);
+            for (int j = 0; j < n; j++) { env[j] = step(env[j], amp, rate, invRate, level); }
+            volk_32fc_32f_multiply_32fc((lv_32fc_t*)&out[i], (const lv_32fc_t*)&in[i], env, n);
+        }
+        return amp;
+    }
+
+#ifdef DSP_CPU_X86
+    // Runs the recurrence on blocks of 8 samples as a prefix scan: with b[k] = rate * |in[k]| and a = 1 - rate,
+    // amp[k] = a^(k+1) * amp[-1] + sum(a^(k-j) * b[j]), the sum being built in three shift and add steps.
+    // Blocks holding a zero sample break the constant decay and go through the scalar step instead.
+    DSP_TARGET_AVX2 inline float avx2(const complex_t* in, complex_t* out, int count, float amp, float rate, float level) {
+        float invRate = 1.0f - rate;
+        float apow[9];
+        apow[0] = 1.0f;
+        for (int k = 1; k <= 8; k++) { apow[k] = apow[k - 1] * invRate; }
+        const __m256 a1 = _mm256_set1_ps(apow[1]);
+        const __m256 a2 = _mm256_set1_ps(apow[2]);
+        const __m256 a4 = _mm256_set1_ps(apow[4]);
+        const __m256 carryPow = _mm256_loadu_ps(&apow[1]);
+        const __m256i shift1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+        const __m256i shift2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+        const __m256i shift4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+        const __m256 keep1 = _mm256_castsi256_ps(_mm256_setr_epi32(0, -1, -1, -1, -1, -1, -1, -1));
+        const __m256 keep2 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, -1, -1, -1, -1, -1, -1));
+        const __m256 keep4 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1));
+        const __m256 r = _mm256_set1_ps(rate);
+        const __m256 lvl = _mm256_set1_ps(level);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 zero = _mm256_setzero_ps();
+
+        __m256 carry = _mm256_set1_ps(amp);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // Magnitude squared then envelope, the shuffles leave the samples in the order 0 1 4 5 2 3 6 7
+            __m256 c0 = _mm256_loadu_ps((const float*)&in[i]);
+            __m256 c1 = _mm256_loadu_ps((const float*)&in[i + 4]);
+            __m256 re = _mm256_shuffle_ps(c0, c1, 0x88);
+            __m256 im = _mm256_shuffle_ps(c0, c1, 0xDD);
+            __m256 pwr = _mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im));
+            pwr = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(pwr), 0xD8));
+            __m256 x = _mm256_sqrt_ps(pwr);
+
+            if (_mm256_movemask_ps(_mm256_cmp_ps(x, zero, _CMP_EQ_OQ))) {
+                amp = _mm_cvtss_f32(_mm256_castps256_ps128(carry));
+                for (int j = i; j < i + 8; j++) { stepSample(in[j], out[j], amp, rate, invRate, level); }
+                carry = _mm256_set1_ps(amp);
+                continue;
+            }
+
+            // Prefix scan of the block then contribution of the previous average
+            __m256 s = _mm256_mul_ps(x, r);
+            s = _mm256_fmadd_ps(a1, _mm256_and_ps(_mm256_permutevar8x32_ps(s, shift1), keep1), s);
+            s = _mm256_fmadd_ps(a2, _mm256_and_ps(_mm256_permutevar8x32_ps(s, shift2), keep2), s);
+            s = _mm256_fmadd_ps(a4, _mm256_and_ps(_mm256_permutevar8x32_ps(s, shift4), keep4), s);
+            __m256 avg = _mm256_fmadd_ps(carryPow, carry, s);
+            carry = _mm256_permutevar8x32_ps(avg, _mm256_set1_epi32(7));
+
+            // Blanked samples get a gain of avg / x, which is 1 / excess
+            __m256 blank = _mm256_cmp_ps(x, _mm256_mul_ps(avg, lvl), _CMP_GT_OQ);
+            __m256 gain = _mm256_blendv_ps(one, _mm256_div_ps(avg, x), blank);
+
+            // Give each gain to both parts of its sample
+            __m256 glo = _mm256_unpacklo_ps(gain, gain);
+            __m256 ghi = _mm256_unpackhi_ps(gain, gain);
+            _mm256_storeu_ps((float*)&out[i], _mm256_mul_ps(c0, _mm256_permute2f128_ps(glo, ghi, 0x20)));
+            _mm256_storeu_ps((float*)&out[i + 4], _mm256_mul_ps(c1, _mm256_permute2f128_ps(glo, ghi, 0x31)));
+        }
+
+        amp = _mm_cvtss_f32(_mm256_castps256_ps128(carry));
+        for (; i < count; i++) { stepSample(in[i], out[i], amp, rate, invRate, level); }
+        return amp;
+    }
+#endif
+
+    // Picks the best kernel supported by the CPU
+    inline kernel_t select() {
+#if defined(DSP_CPU_X86)
+        if (cpu::hasAVX2()) { return avx2; }
+#endif
+        return generic;
+    }
+}
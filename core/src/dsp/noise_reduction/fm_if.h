@@ -2,6 +2,7 @@
 #include "../processor.h"
 #include "../window/nuttall.h"
 #include <fftw3.h>
+#include "../fft/plan_cache.h"
 
 namespace dsp::noise_reduction {
     class FMIF : public Processor<complex_t, complex_t> {
@@ -14,68 +15,94 @@ namespace dsp::noise_reduction {
         ~FMIF() {
             if (!base_type::_block_init) { return; }
             base_type::stop();
-            destroyBuffers();
+            destroyBuffers(bufs);
         }
 
         void init(stream<complex_t>* in, int bins) {
-            _bins = bins;
-            initBuffers();
+            capacity = in ? in->getBufferSize() : STREAM_BUFFER_SIZE;
+            initBuffers(bufs, bins);
             base_type::init(in);
         }
 
         void setBins(int bins) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+
+            // Plan before stopping the block, the planner may be busy with a measurement made in the background
+            Buffers newBufs;
+            initBuffers(newBufs, bins);
+
             base_type::tempStop();
-            _bins = bins;
-            destroyBuffers();
-            initBuffers();
+            std::swap(bufs, newBufs);
             base_type::tempStart();
+
+            destroyBuffers(newBufs);
         }
 
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
-            buffer::clear(buffer, _bins - 1);
-            buffer::clear(backFFTIn, _bins);
+            buffer::clear(bufs.buffer, bufs.bins - 1);
+            buffer::clear(bufs.backFFTIn, bufs.bins);
             base_type::tempStart();
         }
 
         int process(int count, const complex_t* in, complex_t* out) {
+            int bins = bufs.bins;
+
             // Write new input data to buffer buffer
-            memcpy(bufferStart, in, count * sizeof(complex_t));
+            memcpy(bufs.bufferStart, in, count * sizeof(complex_t));
             
             // Iterate the FFT
             for (int i = 0; i < count; i++) {
                 // Apply windows
-                volk_32fc_32f_multiply_32fc((lv_32fc_t*)forwFFTIn, (lv_32fc_t*)&buffer[i], fftWin, _bins);
+                volk_32fc_32f_multiply_32fc((lv_32fc_t*)bufs.forwFFTIn, (lv_32fc_t*)&bufs.buffer[i], bufs.fftWin, bins);
 
                 // Do forward FFT
-                fftwf_execute(forwardPlan);
+                fftwf_execute(bufs.forwardPlan);
 
                 // Process bins here
                 uint32_t idx;
-                volk_32fc_magnitude_32f(ampBuf, (lv_32fc_t*)forwFFTOut, _bins);
-                volk_32f_index_max_32u(&idx, ampBuf, _bins);
+                volk_32fc_magnitude_32f(bufs.ampBuf, (lv_32fc_t*)bufs.forwFFTOut, bins);
+                volk_32f_index_max_32u(&idx, bufs.ampBuf, bins);
 
                 // Keep only the bin of highest amplitude
-                backFFTIn[idx] = forwFFTOut[idx];
+                bufs.backFFTIn[idx] = bufs.forwFFTOut[idx];
 
                 // Do reverse FFT and get first element
-                fftwf_execute(backwardPlan);
-                out[i] = backFFTOut[_bins / 2];
+                fftwf_execute(bufs.backwardPlan);
+                out[i] = bufs.backFFTOut[bins / 2];
 
                 // Reset the input buffer
-                backFFTIn[idx] = { 0, 0 };
+                bufs.backFFTIn[idx] = { 0, 0 };
             }
 
             // Move buffer buffer
-            memmove(buffer, &buffer[count], (_bins - 1) * sizeof(complex_t));
+            memmove(bufs.buffer, &bufs.buffer[count], (bins - 1) * sizeof(complex_t));
 
             return count;
         }
 
+        void reserve(int maxInputSize) {
+            if (maxInputSize == capacity) { return; }
+            capacity = maxInputSize;
+            complex_t* newBuffer = buffer::alloc<complex_t>(capacity + bufs.bins - 1);
+            memcpy(newBuffer, bufs.buffer, (bufs.bins - 1) * sizeof(complex_t));
+            buffer::free(bufs.buffer);
+            bufs.buffer = newBuffer;
+            bufs.bufferStart = &bufs.buffer[bufs.bins - 1];
+        }
+
+        size_t getMemoryUsage() {
+            if (!base_type::_block_init) { return 0; }
+            return ((size_t)(capacity + bufs.bins - 1) * sizeof(complex_t)) + (bufs.bins * ((4 * sizeof(complex_t)) + (2 * sizeof(float))));
+        }
+
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -89,61 +116,73 @@ namespace dsp::noise_reduction {
         }
 
     protected:
-        void initBuffers() {
+        // Everything that depends on the bin count, so that it can be made while the block runs and swapped in
+        struct Buffers {
+            int bins = 0;
+
+            complex_t* forwFFTIn;
+            complex_t* forwFFTOut;
+            complex_t* backFFTIn;
+            complex_t* backFFTOut;
+
+            fftwf_plan forwardPlan;
+            fftwf_plan backwardPlan;
+
+            complex_t* buffer;
+            complex_t* bufferStart;
+
+            float* fftWin;
+
+            float* ampBuf;
+        };
+
+        void initBuffers(Buffers& b, int bins) {
+            b.bins = bins;
+
             // Allocate FFT buffers
-            forwFFTIn = (complex_t*)fftwf_malloc(_bins * sizeof(complex_t));
-            forwFFTOut = (complex_t*)fftwf_malloc(_bins * sizeof(complex_t));
-            backFFTIn = (complex_t*)fftwf_malloc(_bins * sizeof(complex_t));
-            backFFTOut = (complex_t*)fftwf_malloc(_bins * sizeof(complex_t));
+            b.forwFFTIn = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
+            b.forwFFTOut = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
+            b.backFFTIn = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
+            b.backFFTOut = (complex_t*)fftwf_malloc(bins * sizeof(complex_t));
 
             // Allocate and clear delay buffer
-            buffer = buffer::alloc<complex_t>(STREAM_BUFFER_SIZE + 64000);
-            bufferStart = &buffer[_bins - 1];
-            buffer::clear(buffer, _bins - 1);
+            b.buffer = buffer::alloc<complex_t>(capacity + bins - 1);
+            b.bufferStart = &b.buffer[bins - 1];
+            buffer::clear(b.buffer, bins - 1);
 
             // Clear backward FFT input since only one value is changed and reset at a time
-            buffer::clear(backFFTIn, _bins);
+            buffer::clear(b.backFFTIn, bins);
 
             // Allocate amplitude buffer
-            ampBuf = buffer::alloc<float>(_bins);
+            b.ampBuf = buffer::alloc<float>(bins);
 
             // Allocate and generate Window
-            fftWin = buffer::alloc<float>(_bins);
-            for (int i = 0; i < _bins; i++) { fftWin[i] = window::nuttall(i, _bins - 1); }
+            b.fftWin = buffer::alloc<float>(bins);
+            for (int i = 0; i < bins; i++) { b.fftWin[i] = window::nuttall(i, bins - 1); }
 
             // Plan FFTs
-            forwardPlan = fftwf_plan_dft_1d(_bins, (fftwf_complex*)forwFFTIn, (fftwf_complex*)forwFFTOut, FFTW_FORWARD, FFTW_ESTIMATE);
-            backwardPlan = fftwf_plan_dft_1d(_bins, (fftwf_complex*)backFFTIn, (fftwf_complex*)backFFTOut, FFTW_BACKWARD, FFTW_ESTIMATE);
+            std::lock_guard<std::mutex> lck(fft::plannerMtx());
+            b.forwardPlan = fftwf_plan_dft_1d(bins, (fftwf_complex*)b.forwFFTIn, (fftwf_complex*)b.forwFFTOut, FFTW_FORWARD, FFTW_ESTIMATE);
+            b.backwardPlan = fftwf_plan_dft_1d(bins, (fftwf_complex*)b.backFFTIn, (fftwf_complex*)b.backFFTOut, FFTW_BACKWARD, FFTW_ESTIMATE);
         }
 
-        void destroyBuffers() {
-            fftwf_destroy_plan(forwardPlan);
-            fftwf_destroy_plan(backwardPlan);
-            fftwf_free(forwFFTIn);
-            fftwf_free(forwFFTOut);
-            fftwf_free(backFFTIn);
-            fftwf_free(backFFTOut);
-            buffer::free(buffer);
-            buffer::free(ampBuf);
-            buffer::free(fftWin);
+        void destroyBuffers(Buffers& b) {
+            {
+                std::lock_guard<std::mutex> lck(fft::plannerMtx());
+                fftwf_destroy_plan(b.forwardPlan);
+                fftwf_destroy_plan(b.backwardPlan);
+            }
+            fftwf_free(b.forwFFTIn);
+            fftwf_free(b.forwFFTOut);
+            fftwf_free(b.backFFTIn);
+            fftwf_free(b.backFFTOut);
+            buffer::free(b.buffer);
+            buffer::free(b.ampBuf);
+            buffer::free(b.fftWin);
         }
 
-        complex_t* forwFFTIn;
-        complex_t* forwFFTOut;
-        complex_t* backFFTIn;
-        complex_t* backFFTOut;
-
-        fftwf_plan forwardPlan;
-        fftwf_plan backwardPlan;
-
-        complex_t* buffer;
-        complex_t* bufferStart;
-
-        float* fftWin;
-
-        float* ampBuf;
-
-        int _bins;
+        Buffers bufs;
+        int capacity;
 
     }; 
 }
\ No newline at end of file
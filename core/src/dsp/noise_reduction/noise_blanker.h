@@ -1,5 +1,6 @@
 #pragma once
 #include "../processor.h"
+#include "blanker_kernels.h"
 
 namespace dsp::noise_reduction {
     class NoiseBlanker : public Processor<complex_t, complex_t> {
@@ -11,7 +12,6 @@ namespace dsp::noise_reduction {
 
         void init(stream<complex_t>* in, double rate, double level) {
             _rate = rate;
-            _invRate = 1.0f - _rate;
             _level = level;
             base_type::init(in);
         }
@@ -20,7 +20,6 @@ namespace dsp::noise_reduction {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             _rate = rate;
-            _invRate = 1.0f - _rate;
         }
 
         void setLevel(double level) {
@@ -35,27 +34,15 @@ namespace dsp::noise_reduction {
             amp = 1.0f;
         }
 
-        inline int process(int count, complex_t* in, complex_t* out) {
-            for (int i = 0; i < count; i++) {
-                // Get signal amplitude
-                float inAmp = in[i].amplitude();
-
-                // Update average amplitude
-                float gain = 1.0f;
-                if (inAmp != 0.0f) {
-                    amp = (amp * _invRate) + (inAmp * _rate);
-                    float excess = inAmp / amp;
-                    if (excess > _level) {
-                        gain = 1.0f / excess;
-                    }
-                }
-                
-                // Scale output by gain
-                out[i] = in[i] * gain;
-            }
+        inline int process(int count, const complex_t* in, complex_t* out) {
+            amp = kernel(in, out, count, amp, _rate, _level);
             return count;
         }
 
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -69,10 +56,10 @@ namespace dsp::noise_reduction {
 
     protected:
         float _rate;
-        float _invRate;
         float _level;
 
         float amp = 1.0;
 
+        blanker::kernel_t kernel = blanker::select();
     };
 }
\ No newline at end of file
@@ -1,65 +1,92 @@
 #pragma once
+#include <atomic>
 #include "../processor.h"
 
-// TODO: Rewrite better!!!!!
 namespace dsp::noise_reduction {
+    // Mutes the signal when the RMS amplitude of a buffer is below the level, in dB. When gating is enabled a closed
+    // squelch outputs nothing at all, so that the blocks after it are not run until it opens again, and the closed
+    // handler is given the number of samples that were held back instead.
     class Squelch : public Processor<complex_t, complex_t> {
         using base_type = Processor<complex_t, complex_t>;
     public:
         Squelch() {}
 
-        Squelch(stream<complex_t>* in, double level) {}
-
-        ~Squelch() {
-            if (!base_type::_block_init) { return; }
-            base_type::stop();
-            buffer::free(normBuffer);
-        }
+        Squelch(stream<complex_t>* in, double level) { init(in, level); }
 
         void init(stream<complex_t>* in, double level) {
-            _level = level;
-
-            normBuffer = buffer::alloc<float>(STREAM_BUFFER_SIZE);
-
+            setThreshold(level);
             base_type::init(in);
         }
 
         void setLevel(double level) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
-            _level = level;
+            setThreshold(level);
+        }
+
+        void setGating(bool enabled) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            gating = enabled;
+        }
+
+        void setClosedHandler(void (*handler)(int count, void* ctx), void* ctx) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            closedHandler = handler;
+            closedCtx = ctx;
+        }
+
+        bool isOpen() {
+            return open;
         }
 
         inline int process(int count, const complex_t* in, complex_t* out) {
+            if (!count) { return 0; }
+
+            // The sum of the magnitudes squared is the dot product of the samples with themselves
             float sum;
-            volk_32fc_magnitude_32f(normBuffer, (lv_32fc_t*)in, count);
-            volk_32f_accumulator_s32f(&sum, normBuffer, count);
-            sum /= (float)count;
+            volk_32f_x2_dot_prod_32f(&sum, (const float*)in, (const float*)in, count * 2);
+            open = (sum >= threshold * (float)count);
 
-            if (10.0f * log10f(sum) >= _level) {
-                memcpy(out, in, count * sizeof(complex_t));
+            if (open) {
+                if (out != in) { memcpy(out, in, count * sizeof(complex_t)); }
+                return count;
             }
-            else {
-                memset(out, 0, count * sizeof(complex_t));
+            if (gating) {
+                if (closedHandler) { closedHandler(count, closedCtx); }
+                return 0;
             }
-
+            memset(out, 0, count * sizeof(complex_t));
             return count;
         }
 
-        //DEFAULT_PROC_RUN();
+        DEFAULT_PROC_SIZE
+
+        DEFAULT_PROC_FUSED
 
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
             base_type::_in->flush();
-            if (!base_type::out.swap(count)) { return -1; }
-            return count;
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
         }
 
     private:
-        float* normBuffer;
-        float _level = -50.0f;
-                
+        // The level is compared to 10*log10 of the RMS amplitude, that is 5*log10 of the mean power,
+        // so the threshold is kept as a power to avoid a log per buffer
+        void setThreshold(double level) {
+            threshold = powf(10.0f, (float)level / 5.0f);
+        }
+
+        float threshold;
+        bool gating = false;
+        void (*closedHandler)(int count, void* ctx) = NULL;
+        void* closedCtx = NULL;
+        std::atomic<bool> open = false;
     };
-}
\ No newline at end of file
+}
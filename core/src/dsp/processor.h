@@ -37,20 +37,41 @@
 #define DEFAULT_PROC_RUN            OVERRIDE_PROC_RUN(process(count, base_type::_in->readBuf, base_type::out.writeBuf))
 #define DEFAULT_MULTIRATE_PROC_RUN  OVERRIDE_MULTIRATE_PROC_RUN(process(count, base_type::_in->readBuf, base_type::out.writeBuf))
 
+// This macro allows a block to be fused into a single thread with others (see dsp::FusedProcessor)
+// The process function must support being called with the same input and output buffer
+
+#define DEFAULT_PROC_FUSED\
+    bool fusable() { return true; }\
+    int fusedProcess(int count, const typename base_type::in_type* in, typename base_type::out_type* out) {\
+        return process(count, (typename base_type::in_type*)in, out);\
+    }
+
+// This macro declares a block as producing as many samples as it's given, allowing its output buffer to
+// be sized from the input buffer's size
+
+#define DEFAULT_PROC_SIZE\
+    int maxOutputSize(int maxInputSize) { return maxInputSize; }
+
 namespace dsp {
     template <class I, class O>
-    class Processor : public block {
+    class Processor : public block, public stream_resize_listener {
     public:
+        using in_type = I;
+        using out_type = O;
+
         Processor() {}
 
         Processor(stream<I>* in) { init(in); }
 
-        virtual ~Processor() {}
+        virtual ~Processor() {
+            if (_block_init && _in) { _in->clearResizeListener(this); }
+        }
 
         virtual void init(stream<I>* in) {
             _in = in;
             registerInput(_in);
             registerOutput(&out);
+            if (_in) { _in->setResizeListener(this); }
             _block_init = true;
         }
 
@@ -59,16 +80,48 @@ namespace dsp {
             std::lock_guard<std::recursive_mutex> lck(ctrlMtx);
             tempStop();
             unregisterInput(_in);
+            if (_in) { _in->clearResizeListener(this); }
             _in = in;
             registerInput(_in);
+            if (_in) { _in->setResizeListener(this); }
+            tempStart();
+        }
+
+        // Size the output buffer needs for a given number of input samples, -1 if unknown.
+        // This includes any intermediate result the block writes to its output buffer.
+        virtual int maxOutputSize(int maxInputSize) { return -1; }
+
+        // Sizes the work buffers of the block for up to the given number of input samples. Called with the size of the
+        // input buffer when the block starts, blocks run by another one get it from that block instead.
+        virtual void reserve(int maxInputSize) {}
+
+        void inputResized() {
+            // Restarting renegotiates the size of the output buffer
+            std::lock_guard<std::recursive_mutex> lck(ctrlMtx);
+            tempStop();
             tempStart();
         }
 
         virtual int run() = 0;
 
+        virtual bool fusable() { return false; }
+
+        virtual int fusedProcess(int count, const I* in, O* out) { return 0; }
+
         stream<O> out;
 
     protected:
+        void doStart() {
+            // Size the work and output buffers for the largest block the input can hold
+            if (_in) {
+                int inSize = _in->getMaxReadSize();
+                reserve(inSize);
+                int size = maxOutputSize(inSize);
+                if (size > 0) { out.resize(size); }
+            }
+            block::doStart();
+        }
+
         stream<I>* _in;
     };
 }
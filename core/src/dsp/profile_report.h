@@ -0,0 +1,132 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include "memory_report.h"
+
+namespace dsp::profiler {
+    struct BlockProfile {
+        std::string name;
+        const void* object;
+        double sampleRate;          // Samples per second returned by run()
+        double load;                // Fraction of the time spent working, excluding waits
+        double inputWait;           // Fraction of the time spent waiting for input
+        double outputWait;          // Fraction of the time spent waiting for the reader of an output
+        double avgLatencyMs;        // From the origin of the data to the input of the block
+        double maxLatencyMs;
+    };
+
+    // Computes per-block rates between successive calls to update()
+    class Monitor {
+    public:
+        // Returns the profile of every live block that ran since the last update, busiest first
+        std::vector<BlockProfile> update() {
+            uint64_t t = now();
+            double elapsed = (double)(t - lastUpdate);
+            lastUpdate = t;
+
+            std::map<uint64_t, Snapshot> snaps;
+            std::vector<BlockProfile> profiles;
+            memory::blocks().forEach([&](block* blk, const std::type_info& type, uint64_t id) {
+                // Only blocks seen last time have something to compare to. They're told apart by their registration
+                // id, a block allocated where a deleted one was must not inherit its counters.
+                auto it = lastSnaps.find(id);
+                Snapshot snap = takeSnapshot(blk, (it != lastSnaps.end()) ? &it->second : NULL);
+                snaps[id] = snap;
+                if (it == lastSnaps.end() || elapsed <= 0.0) { return; }
+                const Snapshot& prev = it->second;
+                if (snap.runs <= prev.runs) { return; }
+
+                BlockProfile prof;
+                prof.name = memory::typeName(type);
+                prof.object = blk;
+                prof.sampleRate = (double)(snap.samples - prev.samples) * 1e9 / elapsed;
+                double waits = (double)((snap.inputWaitNs - prev.inputWaitNs) + (snap.outputWaitNs - prev.outputWaitNs));
+                prof.load = std::max<double>(((double)(snap.runNs - prev.runNs) - waits) / elapsed, 0.0);
+                prof.inputWait = (double)(snap.inputWaitNs - prev.inputWaitNs) / elapsed;
+                prof.outputWait = (double)(snap.outputWaitNs - prev.outputWaitNs) / elapsed;
+                uint64_t buffers = snap.buffers - prev.buffers;
+                prof.avgLatencyMs = buffers ? ((double)(snap.latencyNs - prev.latencyNs) / (double)buffers / 1e6) : 0.0;
+                prof.maxLatencyMs = (double)snap.maxLatencyNs / 1e6;
+                profiles.push_back(prof);
+            });
+            lastSnaps = snaps;
+
+            std::sort(profiles.begin(), profiles.end(), [](const BlockProfile& a, const BlockProfile& b) { return a.load > b.load; });
+            return profiles;
+        }
+
+    private:
+        struct Snapshot {
+            uint64_t runs;
+            uint64_t samples;
+            uint64_t runNs;
+            uint64_t inputWaitNs;
+            uint64_t outputWaitNs;
+            uint64_t latencyNs;
+            uint64_t buffers;
+            uint64_t maxLatencyNs;
+        };
+
+        static Snapshot takeSnapshot(block* blk, const Snapshot* prev) {
+            Snapshot snap;
+            snap.runs = blk->profile.runs;
+            snap.samples = blk->profile.samples;
+            snap.runNs = blk->profile.runNs;
+            snap.inputWaitNs = blk->profile.inputWaitNs;
+            snap.outputWaitNs = blk->profile.outputWaitNs;
+
+            // The max latency is reset so that it only covers the last interval
+            if (!blk->getInputLatency(snap.latencyNs, snap.buffers, snap.maxLatencyNs)) {
+                // Block busy being reconfigured, report no latency for this interval
+                snap.latencyNs = prev ? prev->latencyNs : 0;
+                snap.buffers = prev ? prev->buffers : 0;
+                snap.maxLatencyNs = 0;
+            }
+            return snap;
+        }
+
+        uint64_t lastUpdate = now();
+        std::map<uint64_t, Snapshot> lastSnaps;
+    };
+
+    // Write the captured trace in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+    // Each block gets its own track.
+    inline bool saveTrace(const std::string& path) {
+        std::ofstream file(path);
+        if (!file.is_open()) { return false; }
+
+        Tracer& t = tracer();
+        uint64_t startTime = t.getStartTime();
+        std::map<const void*, int> tracks;
+        char buf[512];
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        t.forEach([&](const TraceEvent& evt) {
+            if (!first) { file << ",\n"; }
+            first = false;
+
+            // Name the track of a block the first time it shows up
+            auto it = tracks.find(evt.object);
+            if (it == tracks.end()) {
+                int tid = tracks.size() + 1;
+                it = tracks.insert({ evt.object, tid }).first;
+                file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"";
+                file << memory::typeName(*evt.type) << " (" << evt.object << ")\"}},\n";
+            }
+
+            double ts = (evt.start >= startTime) ? (double)(evt.start - startTime) / 1000.0 : 0.0;
+            snprintf(buf, sizeof(buf), "{\"name\":\"run\",\"cat\":\"dsp\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3lf,\"dur\":%.3lf,"
+                                       "\"args\":{\"samples\":%d,\"input_wait_us\":%.3lf,\"output_wait_us\":%.3lf,\"latency_us\":%.3lf}}",
+                     it->second, ts, (double)evt.duration / 1000.0, evt.samples, (double)evt.inputWait / 1000.0,
+                     (double)evt.outputWait / 1000.0, (double)evt.latency / 1000.0);
+            file << buf;
+        });
+        file << "\n]}\n";
+
+        return file.good();
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <typeinfo>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+// Default capacity of a trace capture, about 60 bytes per event
+#define PROFILER_TRACE_MAX_EVENTS 200000
+
+namespace dsp::profiler {
+    // Instrumentation is skipped entirely unless enabled
+    inline std::atomic<bool> enabled = false;
+
+    inline void setEnabled(bool enable) {
+        enabled = enable;
+    }
+
+    inline bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Monotonic time in nanoseconds
+    inline uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Time at which the oldest data read by the current run of a block entered the graph.
+    // Buffers written by the block carry it so that latency can be measured all the way from the source.
+    inline thread_local uint64_t currentOrigin = 0;
+
+    inline void mergeOrigin(uint64_t origin) {
+        if (!currentOrigin || origin < currentOrigin) { currentOrigin = origin; }
+    }
+
+    // Counters only have a single writer so they don't need an atomic read-modify-write
+    inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // Updated by the reader and writer of a stream, each counter only ever has one writer
+    struct StreamStats {
+        std::atomic<uint64_t> readWaitNs = 0;       // Time the reader spent waiting for data
+        std::atomic<uint64_t> writeWaitNs = 0;      // Time the writer spent waiting for the reader
+        std::atomic<uint64_t> latencyNs = 0;        // Sum of source-to-reader latencies of the buffers read
+        std::atomic<uint64_t> maxLatencyNs = 0;
+        std::atomic<uint64_t> buffers = 0;
+
+        inline void addLatency(uint64_t ns) {
+            add(latencyNs, ns);
+            add(buffers, 1);
+            if (ns > maxLatencyNs.load(std::memory_order_relaxed)) { maxLatencyNs.store(ns, std::memory_order_relaxed); }
+        }
+    };
+
+    // Updated by whichever thread runs the block, a block is never run by two threads at once
+    struct BlockStats {
+        std::atomic<uint64_t> runs = 0;
+        std::atomic<uint64_t> samples = 0;          // Sum of the counts returned by run()
+        std::atomic<uint64_t> runNs = 0;            // Total time spent in run(), including waits
+        std::atomic<uint64_t> inputWaitNs = 0;
+        std::atomic<uint64_t> outputWaitNs = 0;
+    };
+
+    struct TraceEvent {
+        const void* object;
+        const std::type_info* type;
+        uint64_t start;
+        uint64_t duration;
+        uint64_t inputWait;
+        uint64_t outputWait;
+        uint64_t latency;       // From the origin of the data to the end of the run
+        int samples;
+    };
+
+    // Records every run of every block while capturing, for export as a Chrome/Perfetto trace
+    class Tracer {
+    public:
+        void start(int maxEvents) {
+            std::lock_guard<std::mutex> lck(mtx);
+            events.clear();
+            events.reserve(maxEvents);
+            capacity = maxEvents;
+            startTime = now();
+            capturing = true;
+        }
+
+        void stop() {
+            capturing = false;
+        }
+
+        bool isCapturing() {
+            return capturing.load(std::memory_order_relaxed);
+        }
+
+        void record(const TraceEvent& evt) {
+            std::lock_guard<std::mutex> lck(mtx);
+            if (!capturing) { return; }
+            if (events.size() >= capacity) {
+                // Buffer full, end the capture
+                capturing = false;
+                return;
+            }
+            events.push_back(evt);
+        }
+
+        template <typename Func>
+        void forEach(Func func) {
+            std::lock_guard<std::mutex> lck(mtx);
+            for (const auto& evt : events) { func(evt); }
+        }
+
+        int getEventCount() {
+            std::lock_guard<std::mutex> lck(mtx);
+            return events.size();
+        }
+
+        uint64_t getStartTime() {
+            return startTime;
+        }
+
+    private:
+        std::mutex mtx;
+        std::vector<TraceEvent> events;
+        size_t capacity = 0;
+        uint64_t startTime = 0;
+        std::atomic<bool> capturing = false;
+    };
+
+    inline Tracer& tracer() {
+        static Tracer* t = new Tracer();
+        return *t;
+    }
+}
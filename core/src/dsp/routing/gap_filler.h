@@ -0,0 +1,52 @@
+#pragma once
+#include <mutex>
+#include "../processor.h"
+
+namespace dsp::routing {
+    // Forwards its input and lets another thread write silence to the output when the input is gated, so that a
+    // sink keeps being fed without the gated blocks running or a thread of its own.
+    template <class T>
+    class GapFiller : public Processor<T, T> {
+        using base_type = Processor<T, T>;
+    public:
+        GapFiller() {}
+
+        GapFiller(stream<T>* in) { base_type::init(in); }
+
+        // Writes count zero samples to the output without ever waiting. Silence is dropped while the input is being
+        // forwarded or while the reader is behind, since it then still has samples to play anyway.
+        void fill(int count) {
+            std::unique_lock<std::mutex> lck(writeMtx, std::try_to_lock);
+            if (!lck.owns_lock()) { return; }
+            int maxCount = base_type::out.getBufferSize();
+            while (count > 0 && base_type::out.writable()) {
+                int n = std::min<int>(count, maxCount);
+                memset(base_type::out.writeBuf, 0, n * sizeof(T));
+                if (!base_type::out.swap(n)) { return; }
+                count -= n;
+            }
+        }
+
+        DEFAULT_PROC_SIZE
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            std::lock_guard<std::mutex> lck(writeMtx);
+            memcpy(base_type::out.writeBuf, base_type::_in->readBuf, count * sizeof(T));
+            base_type::_in->flush();
+            if (!base_type::out.swap(count)) { return -1; }
+            return count;
+        }
+
+    protected:
+        void doStart() {
+            // Starting may resize the output buffer, which must not happen during a fill
+            std::lock_guard<std::mutex> lck(writeMtx);
+            base_type::doStart();
+        }
+
+        std::mutex writeMtx;
+    };
+}
@@ -1,28 +1,66 @@
 #pragma once
+#include <list>
 #include "../sink.h"
+#include "../buffer/shared_pool.h"
 
 namespace dsp::routing {
+    // What the splitter does when an output's reader hasn't given its previous buffer back yet
+    enum SplitterPolicy {
+        SPLITTER_POLICY_BLOCK,  // Wait for the reader, a slow reader slows down every output
+        SPLITTER_POLICY_DROP    // Skip the buffer for that output only
+    };
+
     template <class T>
-    class Splitter : public Sink<T> {
+    class Splitter : public Sink<T>, public stream_resize_listener {
         using base_type = Sink<T>;
     public:
         Splitter() {}
 
-        Splitter(stream<T>* in) { base_type::init(in); }
+        Splitter(stream<T>* in) { init(in); }
+
+        ~Splitter() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+        }
+
+        void init(stream<T>* in) {
+            base_type::init(in);
+            if (in) { in->setResizeListener(this); }
+        }
+
+        void setInput(stream<T>* in) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            if (base_type::_in) { base_type::_in->clearResizeListener(this); }
+            base_type::setInput(in);
+            if (in) { in->setResizeListener(this); }
+            base_type::tempStart();
+        }
+
+        void inputResized() {
+            // Restarting resizes the outputs
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            base_type::tempStart();
+        }
 
-        void bindStream(stream<T>* stream) {
+        // A shared output gets a read-only view of the input buffer instead of a copy, its reader must not write to readBuf
+        void bindStream(stream<T>* stream, bool shared = false, SplitterPolicy policy = SPLITTER_POLICY_BLOCK) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             
             // Check that the stream isn't already bound
-            if (std::find(streams.begin(), streams.end(), stream) != streams.end()) {
+            if (findOutput(stream) != outputs.end()) {
                 throw std::runtime_error("[Splitter] Tried to bind stream to that is already bound");
             }
 
             // Add to the list
             base_type::tempStop();
             base_type::registerOutput(stream);
-            streams.push_back(stream);
+            outputs.emplace_back(stream, shared, policy);
+            if (shared) { sharedCount++; }
             base_type::tempStart();
         }
 
@@ -31,37 +69,122 @@ namespace dsp::routing {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             
             // Check that the stream is bound
-            auto sit = std::find(streams.begin(), streams.end(), stream);
-            if (sit == streams.end()) {
+            auto oit = findOutput(stream);
+            if (oit == outputs.end()) {
                 throw std::runtime_error("[Splitter] Tried to unbind stream to that isn't bound");
             }
 
-            // Add to the list
+            // Remove from the list, the stream may be given to a writer that needs its buffers again
             base_type::tempStop();
-            streams.erase(sit);
+            if (oit->shared) {
+                sharedCount--;
+                stream->setLendOnly(false);
+            }
+            outputs.erase(oit);
             base_type::unregisterOutput(stream);
             base_type::tempStart();
         }
 
+        // Number of buffers an output missed because of the drop policy
+        uint64_t getDropCount(stream<T>* stream) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            auto oit = findOutput(stream);
+            if (oit == outputs.end()) { return 0; }
+            return oit->dropped.load(std::memory_order_relaxed);
+        }
+
+        size_t getMemoryUsage() {
+            return pool.getMemoryUsage();
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
 
-            for (const auto& stream : streams) {
-                memcpy(stream->writeBuf, base_type::_in->readBuf, count * sizeof(T));
-                if (!stream->swap(count)) {
-                    base_type::_in->flush();
+            // Take over the input buffer so it can be lent to the shared outputs. This also lets
+            // the input be refilled right away instead of once the slowest output is done.
+            typename buffer::SharedPool<T>::Buffer* shared = NULL;
+            if (sharedCount) {
+                shared = pool.get(std::max<int>(count, base_type::_in->getBufferSize()));
+                int takenSize;
+                T* taken = base_type::_in->exchangeReadBuf(shared->data, shared->size, &takenSize);
+                if (taken) {
+                    pool.replace(shared, taken, takenSize);
+                }
+                else {
+                    // The input buffer is itself shared, fall back to a single copy
+                    memcpy(shared->data, base_type::_in->readBuf, count * sizeof(T));
+                }
+                base_type::_in->flush();
+            }
+            const T* data = shared ? shared->data : base_type::_in->readBuf;
+
+            for (auto& out : outputs) {
+                // The reader is behind if it still holds the previous buffer now that the next one is there. Being
+                // the only writer, a writable stream is guaranteed to swap without waiting.
+                if (out.policy == SPLITTER_POLICY_DROP && !out.strm->writable()) {
+                    out.dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                bool ok;
+                if (out.shared) {
+                    shared->acquire();
+                    ok = out.strm->swapShared(shared->data, count, shared);
+                    if (!ok) { shared->release(); }
+                }
+                else {
+                    memcpy(out.strm->writeBuf, data, count * sizeof(T));
+                    ok = out.strm->swap(count);
+                }
+
+                if (!ok) {
+                    if (shared) { shared->release(); }
+                    else { base_type::_in->flush(); }
                     return -1;
                 }
             }
 
-            base_type::_in->flush();
+            // The buffer goes back to the pool once the last shared output flushes it
+            if (shared) { shared->release(); }
+            else { base_type::_in->flush(); }
 
             return count;
         }
 
     protected:
-        std::vector<stream<T>*> streams;
+        struct Output {
+            Output(stream<T>* strm, bool shared, SplitterPolicy policy) : strm(strm), shared(shared), policy(policy) {}
+
+            stream<T>* strm;
+            bool shared;
+            SplitterPolicy policy;
+            std::atomic<uint64_t> dropped = 0;   // Read without stopping the splitter
+        };
+
+        typename std::list<Output>::iterator findOutput(stream<T>* stream) {
+            return std::find_if(outputs.begin(), outputs.end(), [stream](const Output& out) { return out.strm == stream; });
+        }
+
+        void doStart() {
+            // Outputs never receive more than the input can hold. Shared outputs only get buffers of the pool.
+            for (const auto& out : outputs) {
+                out.strm->setLendOnly(out.shared);
+                out.strm->resize(base_type::_in->getMaxReadSize());
+            }
+            base_type::doStart();
+        }
+
+        bool waitsOnOutput(untyped_stream* strm) {
+            // Waiting on a dropping output would hold back all the others until its reader catches up
+            auto oit = findOutput((stream<T>*)strm);
+            return oit == outputs.end() || oit->policy != SPLITTER_POLICY_DROP;
+        }
+
+        std::list<Output> outputs;
+        int sharedCount = 0;
+        buffer::SharedPool<T> pool;
 
     };
 }
\ No newline at end of file
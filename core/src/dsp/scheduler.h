@@ -0,0 +1,327 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include "stream.h"
+#include "event_count.h"
+
+// Time given to a running block to finish before its streams are stopped to abort it
+#define SCHEDULER_DETACH_TIMEOUT_MS 500
+
+namespace dsp {
+    struct SchedulerStats {
+        uint64_t runs = 0;
+        double queueTimeUs = 0.0;       // Total time spent ready but waiting for a worker
+        double maxQueueTimeUs = 0.0;
+        double runTimeUs = 0.0;         // Total time spent in run()
+    };
+
+    class Scheduler;
+
+    // A block as seen by the scheduler. It gets queued whenever one of its streams changes state
+    // and its run function is only called once all inputs are readable and all outputs writable.
+    class SchedulerTask : public stream_observer {
+        friend Scheduler;
+    public:
+        void streamEvent();
+
+        SchedulerStats getStats() {
+            SchedulerStats stats;
+            stats.runs = runs.load(std::memory_order_relaxed);
+            stats.queueTimeUs = (double)queueTimeNs.load(std::memory_order_relaxed) / 1000.0;
+            stats.maxQueueTimeUs = (double)maxQueueTimeNs.load(std::memory_order_relaxed) / 1000.0;
+            stats.runTimeUs = (double)runTimeNs.load(std::memory_order_relaxed) / 1000.0;
+            return stats;
+        }
+
+        void resetStats() {
+            runs = 0;
+            queueTimeNs = 0;
+            maxQueueTimeNs = 0;
+            runTimeNs = 0;
+        }
+
+    private:
+        enum {
+            TASK_IDLE,
+            TASK_QUEUED,
+            TASK_RUNNING,
+            TASK_NOTIFIED
+        };
+
+        bool ready() {
+            for (auto& in : inputs) {
+                if (!in->readable()) { return false; }
+            }
+            for (auto& out : outputs) {
+                if (!out->writable()) { return false; }
+            }
+            return true;
+        }
+
+        Scheduler* sched;
+        int (*work)(void* ctx);
+        void* ctx;
+        std::vector<untyped_stream*> inputs;
+        std::vector<untyped_stream*> outputs;
+
+        std::atomic<int> state = TASK_IDLE;
+        std::atomic<bool> attached = false;
+        std::atomic<bool> detaching = false;
+        std::mutex detachMtx;
+        std::condition_variable detachCV;
+        std::chrono::steady_clock::time_point enqueueTime;
+
+        std::atomic<uint64_t> runs = 0;
+        std::atomic<uint64_t> queueTimeNs = 0;
+        std::atomic<uint64_t> maxQueueTimeNs = 0;
+        std::atomic<uint64_t> runTimeNs = 0;
+    };
+
+    // Fixed pool of worker threads running blocks as tasks instead of one thread per block.
+    // Each worker has its own queue, idle workers steal from the others.
+    // NOTE: A block's run() should only block on its own streams, a block that waits on anything
+    // else (audio device, network...) ties up a worker and must keep its own thread through block::schedulable().
+    class Scheduler {
+        friend SchedulerTask;
+    public:
+        Scheduler(int workerCount = 0) {
+            if (workerCount <= 0) { workerCount = std::max<int>(std::thread::hardware_concurrency(), 1); }
+            for (int i = 0; i < workerCount; i++) {
+                queues.push_back(std::make_unique<WorkerQueue>());
+            }
+            for (int i = 0; i < workerCount; i++) {
+                workers.push_back(std::thread(&Scheduler::worker, this, i));
+            }
+        }
+
+        ~Scheduler() {
+            stopWorkers = true;
+            workEvt.notify();
+            for (auto& w : workers) {
+                if (w.joinable()) { w.join(); }
+            }
+        }
+
+        // Tasks are recycled instead of freed since streams may still hold a pointer to them
+        SchedulerTask* createTask() {
+            std::lock_guard<std::mutex> lck(taskMtx);
+            if (!freeTasks.empty()) {
+                SchedulerTask* task = freeTasks.back();
+                freeTasks.pop_back();
+                task->resetStats();
+                return task;
+            }
+            tasks.push_back(std::make_unique<SchedulerTask>());
+            tasks.back()->sched = this;
+            return tasks.back().get();
+        }
+
+        void releaseTask(SchedulerTask* task) {
+            std::lock_guard<std::mutex> lck(taskMtx);
+            freeTasks.push_back(task);
+        }
+
+        // Start scheduling a task, equivalent of starting the block's thread
+        void attach(SchedulerTask* task, int (*work)(void* ctx), void* ctx, const std::vector<untyped_stream*>& inputs, const std::vector<untyped_stream*>& outputs) {
+            task->work = work;
+            task->ctx = ctx;
+            task->inputs = inputs;
+            task->outputs = outputs;
+            task->attached.store(true, std::memory_order_release);
+            for (auto& in : inputs) { in->setReaderObserver(task); }
+            for (auto& out : outputs) { out->setWriterObserver(task); }
+            task->streamEvent();
+        }
+
+        // Stop scheduling a task, equivalent of stopping and joining the block's thread
+        void detach(SchedulerTask* task) {
+            task->attached = false;
+
+            // Let a run in progress complete so that its buffer isn't lost. It was only started once all
+            // streams were ready so it shouldn't block, if it still does, abort it like a thread would be.
+            auto done = [task]() {
+                int s = task->state.load();
+                return (s != SchedulerTask::TASK_RUNNING && s != SchedulerTask::TASK_NOTIFIED);
+            };
+            bool aborted = false;
+            {
+                std::unique_lock<std::mutex> lck(task->detachMtx);
+                task->detaching = true;
+                if (!task->detachCV.wait_for(lck, std::chrono::milliseconds(SCHEDULER_DETACH_TIMEOUT_MS), done)) {
+                    for (auto& in : task->inputs) { in->stopReader(); }
+                    for (auto& out : task->outputs) { out->stopWriter(); }
+                    task->detachCV.wait(lck, done);
+                    aborted = true;
+                }
+                task->detaching = false;
+            }
+
+            for (auto& in : task->inputs) {
+                in->clearReaderObserver(task);
+                if (aborted) { in->clearReadStop(); }
+            }
+            for (auto& out : task->outputs) {
+                out->clearWriterObserver(task);
+                if (aborted) { out->clearWriteStop(); }
+            }
+        }
+
+        int getWorkerCount() {
+            return workers.size();
+        }
+
+        uint64_t getStealCount() {
+            return steals.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct WorkerQueue {
+            std::mutex mtx;
+            std::deque<SchedulerTask*> tasks;
+        };
+
+        void push(SchedulerTask* task, bool yield) {
+            // Tasks woken up by a worker stay on that worker since their input is hot in its cache
+            int id = (workerId >= 0 && workerSched == this) ? workerId : (nextQueue++ % queues.size());
+            {
+                std::lock_guard<std::mutex> lck(queues[id]->mtx);
+                if (yield) {
+                    queues[id]->tasks.push_front(task);
+                }
+                else {
+                    queues[id]->tasks.push_back(task);
+                }
+            }
+            pending.fetch_add(1);
+            workEvt.notify();
+        }
+
+        SchedulerTask* pop(int id) {
+            // Newest task from our own queue first
+            {
+                std::lock_guard<std::mutex> lck(queues[id]->mtx);
+                if (!queues[id]->tasks.empty()) {
+                    SchedulerTask* task = queues[id]->tasks.back();
+                    queues[id]->tasks.pop_back();
+                    pending.fetch_sub(1);
+                    return task;
+                }
+            }
+
+            // Otherwise steal the oldest task of another worker
+            for (int i = 1; i < queues.size(); i++) {
+                WorkerQueue* q = queues[(id + i) % queues.size()].get();
+                std::lock_guard<std::mutex> lck(q->mtx);
+                if (!q->tasks.empty()) {
+                    SchedulerTask* task = q->tasks.front();
+                    q->tasks.pop_front();
+                    pending.fetch_sub(1);
+                    steals.fetch_add(1, std::memory_order_relaxed);
+                    return task;
+                }
+            }
+
+            return NULL;
+        }
+
+        void execute(SchedulerTask* task) {
+            task->state = SchedulerTask::TASK_RUNNING;
+
+            bool again = false;
+            if (task->attached.load(std::memory_order_acquire) && task->ready()) {
+                auto start = std::chrono::steady_clock::now();
+                uint64_t queueTime = std::chrono::duration_cast<std::chrono::nanoseconds>(start - task->enqueueTime).count();
+                int ret = task->work(task->ctx);
+                uint64_t runTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+                // Update stats, only this worker writes them while the task is running
+                task->runs.fetch_add(1, std::memory_order_relaxed);
+                task->queueTimeNs.fetch_add(queueTime, std::memory_order_relaxed);
+                task->runTimeNs.fetch_add(runTime, std::memory_order_relaxed);
+                if (queueTime > task->maxQueueTimeNs.load(std::memory_order_relaxed)) {
+                    task->maxQueueTimeNs.store(queueTime, std::memory_order_relaxed);
+                }
+
+                // A negative return means the block is being stopped
+                again = (ret >= 0 && task->attached.load(std::memory_order_acquire) && task->ready());
+            }
+
+            // Requeue if there is more to do or if a stream changed state while running
+            int s = SchedulerTask::TASK_RUNNING;
+            if (again || !task->state.compare_exchange_strong(s, SchedulerTask::TASK_IDLE)) {
+                task->state = SchedulerTask::TASK_QUEUED;
+                task->enqueueTime = std::chrono::steady_clock::now();
+                push(task, again);
+            }
+
+            // Wake up detach() if it's waiting on this task
+            if (task->detaching) {
+                { std::lock_guard<std::mutex> lck(task->detachMtx); }
+                task->detachCV.notify_all();
+            }
+        }
+
+        void worker(int id) {
+            workerId = id;
+            workerSched = this;
+            while (true) {
+                SchedulerTask* task = pop(id);
+                if (task) {
+                    execute(task);
+                    continue;
+                }
+                workEvt.wait([this]() { return pending.load() > 0 || stopWorkers; });
+                if (stopWorkers) { return; }
+            }
+        }
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<int> pending = 0;
+        std::atomic<bool> stopWorkers = false;
+        std::atomic<uint32_t> nextQueue = 0;
+        std::atomic<uint64_t> steals = 0;
+        EventCount workEvt;
+
+        std::mutex taskMtx;
+        std::vector<std::unique_ptr<SchedulerTask>> tasks;
+        std::vector<SchedulerTask*> freeTasks;
+
+        static inline thread_local int workerId = -1;
+        static inline thread_local Scheduler* workerSched = NULL;
+    };
+
+    inline void SchedulerTask::streamEvent() {
+        int s = state.load();
+        while (true) {
+            if (s == TASK_IDLE) {
+                if (state.compare_exchange_weak(s, TASK_QUEUED)) {
+                    enqueueTime = std::chrono::steady_clock::now();
+                    sched->push(this, false);
+                    return;
+                }
+            }
+            else if (s == TASK_RUNNING) {
+                // Have the worker check again once it's done
+                if (state.compare_exchange_weak(s, TASK_NOTIFIED)) { return; }
+            }
+            else {
+                return;
+            }
+        }
+    }
+
+    // Scheduler given to blocks when they are constructed, NULL means one thread per block
+    inline std::atomic<Scheduler*> defaultScheduler = NULL;
+
+    inline void setDefaultScheduler(Scheduler* sched) {
+        defaultScheduler = sched;
+    }
+}
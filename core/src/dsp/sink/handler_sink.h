@@ -27,6 +27,9 @@ namespace dsp::sink {
         }
 
     protected:
+        // Handlers write to files, sockets or the GUI and may block for long, they get their own thread
+        bool schedulable() { return false; }
+
         void (*_handler)(T* data, int count, void* ctx);
         void* _ctx;
 
@@ -31,6 +31,9 @@ namespace dsp::sink {
         buffer::RingBuffer<T> data;
 
     private:
+        // Writing waits for the reader of the ring buffer, which isn't a stream
+        bool schedulable() { return false; }
+
         void doStop() {
             base_type::_in->stopReader();
             data.stopWriter();
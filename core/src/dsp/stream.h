@@ -1,14 +1,58 @@
 #pragma once
 #include <string.h>
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <volk/volk.h>
 #include "buffer/buffer.h"
+#include "event_count.h"
+#include "memory_registry.h"
+#include "profiler.h"
 
-// 1MSample buffer
+// Default size of stream buffers, also the largest block a writer may produce unless the stream was resized
+#ifndef STREAM_BUFFER_SIZE
 #define STREAM_BUFFER_SIZE 1000000
+#endif
 
 namespace dsp {
+    enum StreamTransport {
+        STREAM_TRANSPORT_CONDVAR,   // Mutex and condition variable per hand-off
+        STREAM_TRANSPORT_SPSC       // Lock-free single producer/single consumer, spins then parks
+    };
+
+    // Transport used by streams when they are constructed
+#ifdef SDRPP_LOCKFREE_STREAMS
+    inline std::atomic<StreamTransport> defaultStreamTransport = STREAM_TRANSPORT_SPSC;
+#else
+    inline std::atomic<StreamTransport> defaultStreamTransport = STREAM_TRANSPORT_CONDVAR;
+#endif
+
+    inline void setDefaultStreamTransport(StreamTransport transport) {
+        defaultStreamTransport = transport;
+    }
+
+    // Gets notified when a stream may have become readable or writable
+    class stream_observer {
+    public:
+        virtual ~stream_observer() {}
+        virtual void streamEvent() = 0;
+    };
+
+    // Implemented by the reader of a stream so it can adapt when the writer changes the buffer size
+    class stream_resize_listener {
+    public:
+        virtual ~stream_resize_listener() {}
+        virtual void inputResized() = 0;
+    };
+
+    // Reference to a buffer shared by several streams, released by each of them once their reader is done with it
+    class shared_buffer_ref {
+    public:
+        virtual ~shared_buffer_ref() {}
+        virtual void release() = 0;
+    };
+
     class untyped_stream {
     public:
         virtual ~untyped_stream() {}
@@ -19,6 +63,59 @@ namespace dsp {
         virtual void clearWriteStop() {}
         virtual void stopReader() {}
         virtual void clearReadStop() {}
+
+        // True if read() or swap() would return without waiting
+        virtual bool readable() { return true; }
+        virtual bool writable() { return true; }
+
+        // Largest number of samples that can be swapped at once
+        virtual int getBufferSize() { return 0; }
+
+        // Bytes currently allocated for the buffers
+        virtual size_t getMemoryUsage() { return 0; }
+
+        void setResizeListener(stream_resize_listener* listener) {
+            resizeListener = listener;
+        }
+
+        void clearResizeListener(stream_resize_listener* listener) {
+            resizeListener.compare_exchange_strong(listener, NULL);
+        }
+
+        void setReaderObserver(stream_observer* observer) {
+            readerObserver = observer;
+        }
+
+        void setWriterObserver(stream_observer* observer) {
+            writerObserver = observer;
+        }
+
+        // Only detach the observer if it's still the one attached
+        void clearReaderObserver(stream_observer* observer) {
+            readerObserver.compare_exchange_strong(observer, NULL);
+        }
+
+        void clearWriterObserver(stream_observer* observer) {
+            writerObserver.compare_exchange_strong(observer, NULL);
+        }
+
+        // Only updated while the profiler is enabled
+        profiler::StreamStats profile;
+
+    protected:
+        inline void notifyReader() {
+            stream_observer* obs = readerObserver.load(std::memory_order_acquire);
+            if (obs) { obs->streamEvent(); }
+        }
+
+        inline void notifyWriter() {
+            stream_observer* obs = writerObserver.load(std::memory_order_acquire);
+            if (obs) { obs->streamEvent(); }
+        }
+
+        std::atomic<stream_observer*> readerObserver = NULL;
+        std::atomic<stream_observer*> writerObserver = NULL;
+        std::atomic<stream_resize_listener*> resizeListener = NULL;
     };
 
     template <class T>
@@ -27,20 +124,99 @@ namespace dsp {
         stream() {
             writeBuf = buffer::alloc<T>(STREAM_BUFFER_SIZE);
             readBuf = buffer::alloc<T>(STREAM_BUFFER_SIZE);
+            bufferSize = STREAM_BUFFER_SIZE;
+            writeBufSize = STREAM_BUFFER_SIZE;
+            readBufSize = STREAM_BUFFER_SIZE;
+            lockFree = (defaultStreamTransport == STREAM_TRANSPORT_SPSC);
+
+            // Only listed once fully built and until torn down
+            memory::streams().add(this);
         }
 
         virtual ~stream() {
+            memory::streams().remove(this);
             free();
         }
 
+        // NOTE: Must only be called while neither the reader nor the writer are running
         virtual void setBufferSize(int samples) {
+            if (sharedRef) { releaseShared(); }
             buffer::free(writeBuf);
             buffer::free(readBuf);
             writeBuf = buffer::alloc<T>(samples);
             readBuf = buffer::alloc<T>(samples);
+            bufferSize = samples;
+            writeBufSize = samples;
+            readBufSize = samples;
+            lendOnly = false;
+        }
+
+        // A stream only fed with swapShared() has no use for buffers of its own, they're freed as soon as the reader
+        // gives them back and the size set by resize() is only a promise to the reader. Must be called by the writer
+        // while it isn't writing, swap() can only be used again once lending is turned back off.
+        void setLendOnly(bool lend) {
+            if (lend == lendOnly) { return; }
+            lendOnly = lend;
+            if (lend) {
+                buffer::free(writeBuf);
+                writeBuf = NULL;
+                writeBufSize = 0;
+                if (!dataPending()) { freeReadBuf(); }
+                return;
+            }
+            updateWriteBuf();
+            if (!dataPending() && !readBuf) {
+                readBuf = buffer::alloc<T>(bufferSize);
+                readBufSize = bufferSize.load();
+            }
+        }
+
+        // Change the buffer size while the reader may still be running, must be called by the writer
+        // while it isn't writing. The buffer held by the reader is only reallocated once it's given back.
+        void resize(int samples) {
+            if (samples == bufferSize) { return; }
+            bufferSize = samples;
+            if (!lendOnly) { updateWriteBuf(); }
+            if (!dataPending() && !lendOnly) {
+                buffer::free(readBuf);
+                readBuf = buffer::alloc<T>(samples);
+                readBufSize = samples;
+            }
+
+            // Let the reader adapt to the new size
+            stream_resize_listener* listener = resizeListener.load();
+            if (listener) { listener->inputResized(); }
+        }
+
+        int getBufferSize() {
+            return bufferSize;
+        }
+
+        // Largest block the reader can still be given. After shrinking, a block written before the resize may be
+        // pending, the reader must be sized for it until it has been read.
+        int getMaxReadSize() {
+            return std::max<int>(bufferSize, readBufSize);
+        }
+
+        size_t getMemoryUsage() {
+            return ((size_t)writeBufSize + (size_t)readBufSize) * sizeof(T);
+        }
+
+        // NOTE: Must only be changed while neither the reader nor the writer are running
+        void setTransport(StreamTransport transport) {
+            lockFree = (transport == STREAM_TRANSPORT_SPSC);
+            full = false;
+            canSwap = true;
+            dataReady = false;
+        }
+
+        StreamTransport getTransport() {
+            return lockFree ? STREAM_TRANSPORT_SPSC : STREAM_TRANSPORT_CONDVAR;
         }
 
         virtual inline bool swap(int size) {
+            if (lockFree) { return spscSwap(size); }
+            uint64_t waitStart = beginWait();
             {
                 // Wait to either swap or stop
                 std::unique_lock<std::mutex> lck(swapMtx);
@@ -48,12 +224,16 @@ namespace dsp {
 
                        // If writer was stopped, abandon operation
                 if (writerStop) { return false; }
+                endWriteWait(waitStart);
 
                        // Swap buffers
                 dataSize = size;
                 T* temp = writeBuf;
                 writeBuf = readBuf;
                 readBuf = temp;
+                int tempSize = writeBufSize;
+                writeBufSize = readBufSize.load();
+                readBufSize = tempSize;
                 canSwap = false;
             }
 
@@ -63,19 +243,80 @@ namespace dsp {
                 dataReady = true;
             }
             rdyCV.notify_all();
+            notifyReader();
+
+            // Reallocate the buffer given back by the reader if the stream was resized
+            if (writeBufSize != bufferSize) { updateWriteBuf(); }
 
             return true;
         }
 
+        // Give the reader a read-only buffer owned by someone else instead of swapping buffers, the reference is
+        // released once the reader flushes. Returns false without taking the reference if the writer was stopped.
+        inline bool swapShared(T* buf, int size, shared_buffer_ref* ref) {
+            uint64_t waitStart = beginWait();
+            if (lockFree) {
+                writerEvt.wait([this]() { return !full.load(std::memory_order_acquire) || writerStop; });
+                if (writerStop) { return false; }
+                endWriteWait(waitStart);
+                lendReadBuf(buf, size, ref);
+                full.store(true, std::memory_order_release);
+                readerEvt.notify();
+                notifyReader();
+                return true;
+            }
+            {
+                std::unique_lock<std::mutex> lck(swapMtx);
+                swapCV.wait(lck, [this] { return (canSwap || writerStop); });
+                if (writerStop) { return false; }
+                endWriteWait(waitStart);
+                lendReadBuf(buf, size, ref);
+                canSwap = false;
+            }
+            {
+                std::lock_guard<std::mutex> lck(rdyMtx);
+                dataReady = true;
+            }
+            rdyCV.notify_all();
+            notifyReader();
+            return true;
+        }
+
+        // Take ownership of the buffer being read, replacing it with another one of at least getBufferSize() samples.
+        // Must be called by the reader between read() and flush(). Returns NULL if the buffer is shared and can't be taken.
+        T* exchangeReadBuf(T* buf, int size, int* takenSize) {
+            if (sharedRef) { return NULL; }
+            T* taken = readBuf;
+            *takenSize = readBufSize;
+            readBuf = buf;
+            readBufSize = size;
+            return taken;
+        }
+
         virtual inline int read() {
+            if (lockFree) { return spscRead(); }
+
             // Wait for data to be ready or to be stopped
+            uint64_t waitStart = beginWait();
             std::unique_lock<std::mutex> lck(rdyMtx);
             rdyCV.wait(lck, [this] { return (dataReady || readerStop); });
 
-            return (readerStop ? -1 : dataSize);
+            if (readerStop) { return -1; }
+            endReadWait(waitStart);
+            return dataSize;
         }
 
         virtual inline void flush() {
+            // Give back the shared buffer before the writer can hand out a new one
+            if (sharedRef) { releaseShared(); }
+
+            if (lockFree) {
+                full.store(false, std::memory_order_release);
+                writerEvt.notify();
+                notifyWriter();
+                return;
+            }
+
             // Clear data ready
             {
                 std::lock_guard<std::mutex> lck(rdyMtx);
@@ -89,14 +330,22 @@ namespace dsp {
             }
 
             swapCV.notify_all();
+            notifyWriter();
         }
 
         virtual void stopWriter() {
+            if (lockFree) {
+                writerStop = true;
+                writerEvt.notify();
+                notifyWriter();
+                return;
+            }
             {
                 std::lock_guard<std::mutex> lck(swapMtx);
                 writerStop = true;
             }
             swapCV.notify_all();
+            notifyWriter();
         }
 
         virtual void clearWriteStop() {
@@ -104,39 +353,170 @@ namespace dsp {
         }
 
         virtual void stopReader() {
+            if (lockFree) {
+                readerStop = true;
+                readerEvt.notify();
+                notifyReader();
+                return;
+            }
             {
                 std::lock_guard<std::mutex> lck(rdyMtx);
                 readerStop = true;
             }
             rdyCV.notify_all();
+            notifyReader();
         }
 
         virtual void clearReadStop() {
             readerStop = false;
         }
 
+        virtual bool readable() {
+            if (lockFree) { return full.load(std::memory_order_acquire) || readerStop; }
+            return dataReady || readerStop;
+        }
+
+        virtual bool writable() {
+            if (lockFree) { return !full.load(std::memory_order_acquire) || writerStop; }
+            return canSwap || writerStop;
+        }
+
         void free() {
+            if (sharedRef) { releaseShared(); }
             if (writeBuf) { buffer::free(writeBuf); }
             if (readBuf) { buffer::free(readBuf); }
             writeBuf = NULL;
             readBuf = NULL;
+            bufferSize = 0;
+            writeBufSize = 0;
+            readBufSize = 0;
         }
 
         T* writeBuf;
         T* readBuf;
 
     private:
+        inline bool dataPending() {
+            return lockFree ? full.load(std::memory_order_acquire) : dataReady.load();
+        }
+
+        inline uint64_t beginWait() {
+            return profiler::isEnabled() ? profiler::now() : 0;
+        }
+
+        // Called by the writer before publishing a buffer, stamps it with the origin of its data
+        inline void endWriteWait(uint64_t waitStart) {
+            if (!waitStart) {
+                dataOrigin = 0;
+                return;
+            }
+            uint64_t t = profiler::now();
+            profiler::add(profile.writeWaitNs, t - waitStart);
+            dataOrigin = profiler::currentOrigin ? profiler::currentOrigin : t;
+        }
+
+        inline void endReadWait(uint64_t waitStart) {
+            if (!waitStart) { return; }
+            uint64_t t = profiler::now();
+            profiler::add(profile.readWaitNs, t - waitStart);
+            if (dataOrigin) {
+                profile.addLatency(t - dataOrigin);
+                profiler::mergeOrigin(dataOrigin);
+            }
+        }
+
+        inline void lendReadBuf(T* buf, int size, shared_buffer_ref* ref) {
+            // The reader gave its own buffer back, it won't be needed anymore
+            if (lendOnly) { freeReadBuf(); }
+            dataSize = size;
+            ownedReadBuf = readBuf;
+            readBuf = buf;
+            sharedRef = ref;
+        }
+
+        inline void releaseShared() {
+            shared_buffer_ref* ref = sharedRef;
+            readBuf = ownedReadBuf;
+            sharedRef = NULL;
+            ref->release();
+        }
+
+        void freeReadBuf() {
+            buffer::free(readBuf);
+            readBuf = NULL;
+            readBufSize = 0;
+        }
+
+        void updateWriteBuf() {
+            buffer::free(writeBuf);
+            writeBuf = buffer::alloc<T>(bufferSize);
+            writeBufSize = bufferSize.load();
+        }
+
+        inline bool spscSwap(int size) {
+            // Wait for the reader to release the buffer or to be stopped
+            uint64_t waitStart = beginWait();
+            writerEvt.wait([this]() { return !full.load(std::memory_order_acquire) || writerStop; });
+
+            // If writer was stopped, abandon operation
+            if (writerStop) { return false; }
+            endWriteWait(waitStart);
+
+            // Swap buffers and publish them to the reader
+            dataSize = size;
+            T* temp = writeBuf;
+            writeBuf = readBuf;
+            readBuf = temp;
+            int tempSize = writeBufSize;
+            writeBufSize = readBufSize.load();
+            readBufSize = tempSize;
+            full.store(true, std::memory_order_release);
+            readerEvt.notify();
+            notifyReader();
+
+            // Reallocate the buffer given back by the reader if the stream was resized
+            if (writeBufSize != bufferSize) { updateWriteBuf(); }
+
+            return true;
+        }
+
+        inline int spscRead() {
+            // Wait for data to be ready or to be stopped
+            uint64_t waitStart = beginWait();
+            readerEvt.wait([this]() { return full.load(std::memory_order_acquire) || readerStop; });
+            if (readerStop) { return -1; }
+            endReadWait(waitStart);
+            return dataSize;
+        }
+
         std::mutex swapMtx;
         std::condition_variable swapCV;
-        bool canSwap = true;
+        std::atomic<bool> canSwap = true;
 
         std::mutex rdyMtx;
         std::condition_variable rdyCV;
-        bool dataReady = false;
+        std::atomic<bool> dataReady = false;
 
-        bool readerStop = false;
-        bool writerStop = false;
+        std::atomic<bool> readerStop = false;
+        std::atomic<bool> writerStop = false;
+
+        // Lock-free transport
+        bool lockFree;
+        std::atomic<bool> full = false;
+        EventCount readerEvt;
+        EventCount writerEvt;
 
         int dataSize = 0;
+        uint64_t dataOrigin = 0;
+
+        // Shared buffer lent to the reader and the stream's own read buffer put aside meanwhile
+        shared_buffer_ref* sharedRef = NULL;
+        T* ownedReadBuf = NULL;
+        bool lendOnly = false;
+
+        // Size requested by the writer and actual size of each buffer, they differ until the reader gives a buffer back
+        std::atomic<int> bufferSize;
+        std::atomic<int> writeBufSize;
+        std::atomic<int> readBufSize;
     };
 }
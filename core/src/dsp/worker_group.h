@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "event_count.h"
+
+namespace dsp {
+    // Fixed group of threads splitting a job with the thread that runs it, which waits for all parts to be done.
+    // Used by blocks to spread work that can't be pipelined over several cores.
+    class WorkerGroup {
+    public:
+        WorkerGroup() {}
+
+        // Thread count for work split to keep up with the samplerate or the frame rate, up to half the cores so that
+        // the other blocks keep theirs
+        static int defaultThreadCount() {
+            return std::clamp<int>(std::thread::hardware_concurrency() / 2, 1, 4);
+        }
+
+        ~WorkerGroup() {
+            setThreadCount(1);
+        }
+
+        // Total number of threads working on a job, including the caller of run().
+        // NOTE: Must not be called while a job is running
+        void setThreadCount(int count) {
+            stopWorkers = true;
+            startEvt.notify();
+            for (auto& w : workers) {
+                if (w.joinable()) { w.join(); }
+            }
+            workers.clear();
+            stopWorkers = false;
+
+            for (int i = 1; i < count; i++) {
+                workers.push_back(std::thread(&WorkerGroup::worker, this, i, generation.load()));
+            }
+        }
+
+        int getThreadCount() {
+            return workers.size() + 1;
+        }
+
+        // Calls job(part) for every part from 0 to getThreadCount() - 1, part 0 on the calling thread
+        void run(const std::function<void(int)>& job) {
+            if (workers.empty()) {
+                job(0);
+                return;
+            }
+
+            _job = &job;
+            pending.store(workers.size(), std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+            startEvt.notify();
+
+            job(0);
+            doneEvt.wait([this]() { return !pending.load(std::memory_order_acquire); });
+        }
+
+    private:
+        void worker(int part, uint64_t seen) {
+            while (true) {
+                startEvt.wait([&]() { return stopWorkers.load() || generation.load(std::memory_order_acquire) != seen; });
+                if (stopWorkers) { return; }
+                seen = generation.load(std::memory_order_acquire);
+
+                (*_job)(part);
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) { doneEvt.notify(); }
+            }
+        }
+
+        std::vector<std::thread> workers;
+        const std::function<void(int)>* _job = NULL;
+        std::atomic<uint64_t> generation = 0;
+        std::atomic<int> pending = 0;
+        std::atomic<bool> stopWorkers = false;
+        EventCount startEvt;
+        EventCount doneEvt;
+    };
+}
@@ -20,6 +20,7 @@
 #include <gui/menus/vfo_color.h>
 #include <gui/menus/module_manager.h>
 #include <gui/menus/theme.h>
+#include <gui/menus/spectrum_log.h>
 #include <gui/dialogs/credits.h>
 #include <filesystem>
 #include <signal_path/source.h>
@@ -27,6 +28,8 @@
 #include <gui/colormaps.h>
 #include <gui/widgets/snr_meter.h>
 #include <gui/tuner.h>
+#include <dsp/memory_report.h>
+#include <dsp/profile_report.h>
 
 void MainWindow::init() {
     LoadingScreen::show("Initializing UI");
@@ -73,6 +76,7 @@ void MainWindow::init() {
     gui::menu.registerEntry("Source", sourcemenu::draw, NULL);
     gui::menu.registerEntry("Display", displaymenu::draw, NULL);
     gui::menu.registerEntry("Theme", thememenu::draw, NULL);
+    gui::menu.registerEntry("Spectrum Log", spectrum_log_menu::draw, NULL);
     //gui::menu.registerEntry("Sinks", sinkmenu::draw, NULL);
     //gui::menu.registerEntry("Band Plan", bandplanmenu::draw, NULL);
     //gui::menu.registerEntry("VFO Color", vfo_color_menu::draw, NULL);
@@ -169,6 +173,7 @@ void MainWindow::init() {
     displaymenu::init();
     vfo_color_menu::init();
     module_manager_menu::init();
+    spectrum_log_menu::init();
 
     // TODO for 0.2.5
     // Fix gain not updated on startup, soapysdr
@@ -228,10 +233,14 @@ void MainWindow::init() {
 }
 
 float* MainWindow::acquireFFTBuffer(void* ctx) {
-    return gui::waterfall.getFFTBuffer();
+    MainWindow* _this = (MainWindow*)ctx;
+    _this->acquiredFFT = gui::waterfall.getFFTBuffer();
+    return _this->acquiredFFT;
 }
 
 void MainWindow::releaseFFTBuffer(void* ctx) {
+    MainWindow* _this = (MainWindow*)ctx;
+    spectrum_log_menu::pushFFT(_this->acquiredFFT, gui::waterfall.getRawFFTSize());
     gui::waterfall.pushFFT();
 }
 
@@ -504,6 +513,7 @@ void MainWindow::draw() {
         if (ImGui::CollapsingHeader("Debug")) {
             ImGui::Text("Frame time: %.3f ms/frame", ImGui::GetIO().DeltaTime * 1000.0f);
             ImGui::Text("Framerate: %.1f FPS", ImGui::GetIO().Framerate);
+            ImGui::Text("Dropped FFTs: %llu", (unsigned long long)gui::waterfall.getDroppedFFTs());
             ImGui::Text("Center Frequency: %.0f Hz", gui::waterfall.getCenterFrequency());
             ImGui::Text("Source name: %s", sourceName.c_str());
             ImGui::Checkbox("Show demo window", &demoWindow);
@@ -522,6 +532,85 @@ void MainWindow::draw() {
                 firstMenuRender = true;
             }
 
+            int streamCount, blockCount;
+            size_t streamBytes = dsp::memory::getTotalStreamUsage(&streamCount);
+            size_t blockBytes = dsp::memory::getTotalBlockUsage(&blockCount);
+            ImGui::Text("DSP streams: %d (%.1f MB)", streamCount, (double)streamBytes / 1048576.0);
+            ImGui::Text("DSP blocks: %d (%.1f MB)", blockCount, (double)blockBytes / 1048576.0);
+            if (ImGui::Button("Log DSP memory report")) {
+                for (const auto& u : dsp::memory::getStreamUsage()) {
+                    flog::info("[Stream] {0} ({1}): {2} bytes", u.name, u.object, (uint64_t)u.bytes);
+                }
+                for (const auto& u : dsp::memory::getBlockUsage()) {
+                    flog::info("[Block] {0} ({1}): {2} bytes", u.name, u.object, (uint64_t)u.bytes);
+                }
+            }
+
+            bool profiling = dsp::profiler::isEnabled();
+            if (ImGui::Checkbox("Profile DSP blocks", &profiling)) {
+                dsp::profiler::setEnabled(profiling);
+                dspProfiles.clear();
+                dspMonitor.update();
+                dspProfileAge = 0.0;
+            }
+            if (profiling) {
+                // Refresh the stats once per second so that they're readable
+                dspProfileAge += ImGui::GetIO().DeltaTime;
+                if (dspProfileAge >= 1.0) {
+                    dspProfiles = dspMonitor.update();
+                    dspProfileAge = 0.0;
+                }
+
+                if (ImGui::BeginTable("DSP Profile Table", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0, 200.0f * style::uiScale))) {
+                    ImGui::TableSetupColumn("Block");
+                    ImGui::TableSetupColumn("MS/s");
+                    ImGui::TableSetupColumn("Load");
+                    ImGui::TableSetupColumn("In wait");
+                    ImGui::TableSetupColumn("Out wait");
+                    ImGui::TableSetupColumn("Latency");
+                    ImGui::TableSetupScrollFreeze(1, 1);
+                    ImGui::TableHeadersRow();
+                    for (const auto& p : dspProfiles) {
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::TextUnformatted(p.name.c_str());
+                        if (ImGui::IsItemHovered()) { ImGui::SetTooltip("%s (%p)", p.name.c_str(), p.object); }
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::Text("%.3f", p.sampleRate / 1e6);
+                        ImGui::TableSetColumnIndex(2);
+                        ImGui::Text("%.1f%%", p.load * 100.0);
+                        ImGui::TableSetColumnIndex(3);
+                        ImGui::Text("%.1f%%", p.inputWait * 100.0);
+                        ImGui::TableSetColumnIndex(4);
+                        ImGui::Text("%.1f%%", p.outputWait * 100.0);
+                        ImGui::TableSetColumnIndex(5);
+                        ImGui::Text("%.1f/%.1f ms", p.avgLatencyMs, p.maxLatencyMs);
+                    }
+                    ImGui::EndTable();
+                }
+
+                dsp::profiler::Tracer& tracer = dsp::profiler::tracer();
+                if (!tracer.isCapturing()) {
+                    if (ImGui::Button("Start DSP trace")) {
+                        tracer.start(PROFILER_TRACE_MAX_EVENTS);
+                    }
+                }
+                else {
+                    if (ImGui::Button("Stop and save DSP trace")) {
+                        tracer.stop();
+                        std::string path = (std::string)core::args["root"] + "/dsp_trace.json";
+                        if (dsp::profiler::saveTrace(path)) {
+                            flog::info("Saved {0} DSP trace events to {1}", tracer.getEventCount(), path);
+                        }
+                        else {
+                            flog::error("Could not save DSP trace to {0}", path);
+                        }
+                    }
+                    ImGui::SameLine();
+                    ImGui::Text("%d events", tracer.getEventCount());
+                }
+            }
+
             ImGui::Checkbox("WF Single Click", &gui::waterfall.VFOMoveSingleClick);
             ImGui::Checkbox("Lock Menu Order", &gui::menu.locked);
 
@@ -3,6 +3,7 @@
 #include <fftw3.h>
 #include <dsp/types.h>
 #include <dsp/stream.h>
+#include <dsp/profile_report.h>
 #include <signal_path/vfo_manager.h>
 #include <string>
 #include <utils/event.h>
@@ -38,6 +39,7 @@ private:
 
     // FFT Variables
     int fftSize = 8192 * 8;
+    float* acquiredFFT = NULL;
     std::mutex fft_mtx;
     fftwf_complex *fft_in, *fft_out;
     fftwf_plan fftwPlan;
@@ -62,6 +64,11 @@ private:
     bool demoWindow = false;
     int selectedWindow = 0;
 
+    // DSP profiler
+    dsp::profiler::Monitor dspMonitor;
+    std::vector<dsp::profiler::BlockProfile> dspProfiles;
+    double dspProfileAge = 0.0;
+
     bool initComplete = false;
     bool autostart = false;
 
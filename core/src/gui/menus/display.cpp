@@ -20,6 +20,15 @@ namespace displaymenu {
     int selectedWindow = 0;
     int fftRate = 20;
     int fftSizeId = 0;
+    int fftPlanRigor = 0;
+    int fftAveraging = 0;
+    int fftZoomMode = 0;
+    int fftOverlapId = 0;
+    OptionList<int, int> fftOverlaps;
+    int historyFormat = 0;
+    int historyDecimationId = 0;
+    OptionList<int, int> historyDecimations;
+    bool historyMips = false;
     int uiScaleId = 0;
     bool restartRequired = false;
     bool fftHold = false;
@@ -57,6 +66,16 @@ namespace displaymenu {
         fftSizes.define(2048, "2048", 2048);
         fftSizes.define(1024, "1024", 1024);
 
+        fftOverlaps.define(0, "0%", 0);
+        fftOverlaps.define(25, "25%", 25);
+        fftOverlaps.define(50, "50%", 50);
+        fftOverlaps.define(75, "75%", 75);
+
+        historyDecimations.define(1, "Full", 1);
+        historyDecimations.define(2, "1/2", 2);
+        historyDecimations.define(4, "1/4", 4);
+        historyDecimations.define(8, "1/8", 8);
+
         showWaterfall = core::configManager.conf["showWaterfall"];
         showWaterfall ? gui::waterfall.showWaterfall() : gui::waterfall.hideWaterfall();
         std::string colormapName = core::configManager.conf["colorMap"];
@@ -78,6 +97,9 @@ namespace displaymenu {
         fullWaterfallUpdate = core::configManager.conf["fullWaterfallUpdate"];
         gui::waterfall.setFullWaterfallUpdate(fullWaterfallUpdate);
 
+        fftPlanRigor = std::clamp<int>((int)core::configManager.conf["fftPlanRigor"], 0, dsp::fft::PLAN_PATIENT);
+        sigpath::iqFrontEnd.setFFTPlanRigor((dsp::fft::PlanRigor)fftPlanRigor);
+
         fftSizeId = fftSizes.valueId(65536);
         int size = core::configManager.conf["fftSize"];
         if (fftSizes.keyExists(size)) {
@@ -91,6 +113,28 @@ namespace displaymenu {
         selectedWindow = std::clamp<int>((int)core::configManager.conf["fftWindow"], 0, (sizeof(fftWindowList) / sizeof(IQFrontEnd::FFTWindow)) - 1);
         sigpath::iqFrontEnd.setFFTWindow(fftWindowList[selectedWindow]);
 
+        fftOverlapId = fftOverlaps.valueId(50);
+        int overlap = core::configManager.conf["fftOverlap"];
+        if (fftOverlaps.keyExists(overlap)) {
+            fftOverlapId = fftOverlaps.keyId(overlap);
+        }
+        sigpath::iqFrontEnd.setFFTOverlap((double)fftOverlaps.value(fftOverlapId) / 100.0);
+
+        fftZoomMode = std::clamp<int>((int)core::configManager.conf["fftZoomMode"], 0, dsp::math::ZOOM_MIN);
+        gui::waterfall.setZoomMode((dsp::math::ZoomMode)fftZoomMode);
+
+        historyFormat = std::clamp<int>((int)core::configManager.conf["waterfallHistoryFormat"], 0, dsp::buffer::HISTORY_UINT8);
+        historyDecimationId = 0;
+        int decimation = core::configManager.conf["waterfallHistoryDecimation"];
+        if (historyDecimations.keyExists(decimation)) {
+            historyDecimationId = historyDecimations.keyId(decimation);
+        }
+        historyMips = core::configManager.conf["waterfallHistoryMips"];
+        gui::waterfall.setHistoryFormat((dsp::buffer::HistoryFormat)historyFormat, historyDecimations.value(historyDecimationId), historyMips);
+
+        fftAveraging = std::clamp<int>((int)core::configManager.conf["fftAveraging"], 0, IQFrontEnd::FFTAveraging::EXPONENTIAL);
+        sigpath::iqFrontEnd.setFFTAveraging((IQFrontEnd::FFTAveraging)fftAveraging);
+
         gui::menu.locked = core::configManager.conf["lockMenuOrder"];
 
         fftHold = core::configManager.conf["fftHold"];
@@ -230,6 +274,69 @@ namespace displaymenu {
             core::configManager.release(true);
         }
 
+        ImGui::LeftLabel("FFT Planning");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##sdrpp_fft_plan_rigor", &fftPlanRigor, "Estimate\0Measure\0Patient\0")) {
+            sigpath::iqFrontEnd.setFFTPlanRigor((dsp::fft::PlanRigor)fftPlanRigor);
+            core::configManager.acquire();
+            core::configManager.conf["fftPlanRigor"] = fftPlanRigor;
+            core::configManager.release(true);
+        }
+
+        ImGui::LeftLabel("FFT Zoom");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##sdrpp_fft_zoom_mode", &fftZoomMode, "Peak\0Mean\0Min\0")) {
+            gui::waterfall.setZoomMode((dsp::math::ZoomMode)fftZoomMode);
+            core::configManager.acquire();
+            core::configManager.conf["fftZoomMode"] = fftZoomMode;
+            core::configManager.release(true);
+        }
+
+        ImGui::LeftLabel("History Storage");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##sdrpp_wf_history_format", &historyFormat, "Float\0" "16 bit\0" "8 bit\0")) {
+            gui::waterfall.setHistoryFormat((dsp::buffer::HistoryFormat)historyFormat, historyDecimations.value(historyDecimationId), historyMips);
+            core::configManager.acquire();
+            core::configManager.conf["waterfallHistoryFormat"] = historyFormat;
+            core::configManager.release(true);
+        }
+
+        ImGui::LeftLabel("History Resolution");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##sdrpp_wf_history_decim", &historyDecimationId, historyDecimations.txt)) {
+            gui::waterfall.setHistoryFormat((dsp::buffer::HistoryFormat)historyFormat, historyDecimations.value(historyDecimationId), historyMips);
+            core::configManager.acquire();
+            core::configManager.conf["waterfallHistoryDecimation"] = historyDecimations.key(historyDecimationId);
+            core::configManager.release(true);
+        }
+
+        if (ImGui::Checkbox("History Zoom Levels##_sdrpp", &historyMips)) {
+            gui::waterfall.setHistoryFormat((dsp::buffer::HistoryFormat)historyFormat, historyDecimations.value(historyDecimationId), historyMips);
+            core::configManager.acquire();
+            core::configManager.conf["waterfallHistoryMips"] = historyMips;
+            core::configManager.release(true);
+        }
+
+        ImGui::LeftLabel("FFT Averaging");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##sdrpp_fft_averaging", &fftAveraging, "Off\0Linear\0Exponential\0")) {
+            sigpath::iqFrontEnd.setFFTAveraging((IQFrontEnd::FFTAveraging)fftAveraging);
+            core::configManager.acquire();
+            core::configManager.conf["fftAveraging"] = fftAveraging;
+            core::configManager.release(true);
+        }
+
+        if (fftAveraging) {
+            ImGui::LeftLabel("FFT Overlap");
+            ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+            if (ImGui::Combo("##sdrpp_fft_overlap", &fftOverlapId, fftOverlaps.txt)) {
+                sigpath::iqFrontEnd.setFFTOverlap((double)fftOverlaps.value(fftOverlapId) / 100.0);
+                core::configManager.acquire();
+                core::configManager.conf["fftOverlap"] = fftOverlaps.key(fftOverlapId);
+                core::configManager.release(true);
+            }
+        }
+
         if (colorMapNames.size() > 0) {
             ImGui::LeftLabel("Color Map");
             ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
@@ -12,6 +12,8 @@ namespace sourcemenu {
     double customOffset = 0.0;
     double effectiveOffset = 0.0;
     int decimationPower = 0;
+    int channelizerId = 0;
+    bool batchedXlation = false;
     bool iqCorrection = false;
     bool invertIQ = false;
 
@@ -52,6 +54,14 @@ namespace sourcemenu {
                                    "32\0"
                                    "64\0";
 
+    const double channelizerWidths[] = { 0.0, 12500.0, 25000.0, 50000.0, 100000.0, 200000.0 };
+    const char* channelizerWidthsTxt = "Off\0"
+                                       "12.5KHz\0"
+                                       "25KHz\0"
+                                       "50KHz\0"
+                                       "100KHz\0"
+                                       "200KHz\0";
+
     void updateOffset() {
         if (offsetMode == OFFSET_MODE_CUSTOM) { effectiveOffset = customOffset; }
         else if (offsetMode == OFFSET_MODE_SPYVERTER) {
@@ -153,6 +163,14 @@ namespace sourcemenu {
         selectSource(selected);
         sigpath::iqFrontEnd.setDecimation(1 << decimationPower);
 
+        double channelWidth = core::configManager.conf["channelizerWidth"];
+        channelizerId = std::distance(std::begin(channelizerWidths), std::find(std::begin(channelizerWidths), std::end(channelizerWidths), channelWidth));
+        if (channelizerId >= std::size(channelizerWidths)) { channelizerId = 0; }
+        sigpath::iqFrontEnd.setChannelizer(channelizerWidths[channelizerId]);
+
+        batchedXlation = core::configManager.conf["batchedXlation"];
+        sigpath::iqFrontEnd.setBatchedXlation(batchedXlation);
+
         sourceRegisteredHandler.handler = onSourceRegistered;
         sourceUnregisterHandler.handler = onSourceUnregister;
         sourceUnregisteredHandler.handler = onSourceUnregistered;
@@ -230,5 +248,21 @@ namespace sourcemenu {
         //     core::configManager.release(true);
         // }
         // if (running) { style::endDisabled(); }
+
+        ImGui::LeftLabel("Channelizer");
+        ImGui::SetNextItemWidth(itemWidth - ImGui::GetCursorPosX());
+        if (ImGui::Combo("##source_channelizer", &channelizerId, channelizerWidthsTxt)) {
+            sigpath::iqFrontEnd.setChannelizer(channelizerWidths[channelizerId]);
+            core::configManager.acquire();
+            core::configManager.conf["channelizerWidth"] = channelizerWidths[channelizerId];
+            core::configManager.release(true);
+        }
+
+        if (ImGui::Checkbox("Batch VFO translation##_sdrpp_batch_xlat", &batchedXlation)) {
+            sigpath::iqFrontEnd.setBatchedXlation(batchedXlation);
+            core::configManager.acquire();
+            core::configManager.conf["batchedXlation"] = batchedXlation;
+            core::configManager.release(true);
+        }
     }
 }
@@ -0,0 +1,166 @@
+#include <gui/menus/spectrum_log.h>
+#include <imgui.h>
+#include <core.h>
+#include <gui/gui.h>
+#include <gui/style.h>
+#include <gui/widgets/folder_select.h>
+#include <utils/spectrum_log.h>
+#include <utils/flog.h>
+#include <dsp/math/bin_zoom.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <math.h>
+
+namespace spectrum_log_menu {
+    FolderSelect* folderSelect = NULL;
+    spectrum_log::Writer writer;
+    spectrum_log::Reader reader;
+    std::string logPath = "";
+    std::atomic<bool> recording = false;    // Read by the FFT thread
+    float lookBack = 0.0f;
+
+    // Opening the log for reading is only tried again once there may be a log where there wasn't
+    bool readerTried = false;
+
+    void updatePath() {
+        reader.close();
+        readerTried = false;
+        logPath = folderSelect->expandString(folderSelect->path + "/spectrum.spl");
+    }
+
+    void startRecording() {
+        if (!writer.open(logPath)) {
+            flog::error("Could not open spectrum log {0}", logPath);
+            return;
+        }
+        recording = true;
+        if (!reader.isOpen()) { readerTried = false; }
+    }
+
+    void stopRecording() {
+        // Lines pushed meanwhile are dropped by the writer
+        recording = false;
+        writer.close();
+    }
+
+    void init() {
+        folderSelect = new FolderSelect("%ROOT%/recordings");
+        core::configManager.acquire();
+        folderSelect->setPath(core::configManager.conf["spectrumLogFolder"]);
+        bool record = core::configManager.conf["spectrumLogRecord"];
+        core::configManager.release();
+        updatePath();
+
+        if (record && folderSelect->pathIsValid()) { startRecording(); }
+    }
+
+    // Resample a logged line onto the span of the waterfall by its own frequency span, the points it doesn't cover are
+    // left empty so that lines logged at another tuning are drawn at their frequencies
+    void mapLine(dsp::math::BinZoom& zoom, const spectrum_log::LineInfo& info, const std::vector<float>& bins, int size, float* line) {
+        double viewStart = gui::waterfall.getCenterFrequency() - (gui::waterfall.getBandwidth() / 2.0);
+        double pointWidth = gui::waterfall.getBandwidth() / (double)size;
+        double lineStart = info.centerFreq - (info.bandwidth / 2.0);
+        double binWidth = info.bandwidth / (double)bins.size();
+
+        int first = 0;
+        int last = 0;
+        if (binWidth > 0.0 && pointWidth > 0.0) {
+            first = std::clamp<int>(ceil((lineStart - viewStart) / pointWidth - 1e-6), 0, size);
+            last = std::clamp<int>(floor((lineStart + info.bandwidth - viewStart) / pointWidth + 1e-6), first, size);
+        }
+        std::fill(line, line + first, -INFINITY);
+        std::fill(line + last, line + size, -INFINITY);
+        if (last == first) { return; }
+
+        double offset = (viewStart + (first * pointWidth) - lineStart) / binWidth;
+        double width = ((last - first) * pointWidth) / binWidth;
+        zoom.configure(round(offset), std::max<int>(round(width), 1), bins.size(), last - first);
+        zoom.process(bins.data(), &line[first]);
+    }
+
+    // Fill the waterfall with the lines leading up to the look back time, pages of the log are read as needed
+    void replay() {
+        if (!reader.isOpen() && !reader.open(logPath)) { return; }
+        reader.refresh();
+        int64_t last = reader.findLine(reader.getLastTime() - (int64_t)(lookBack * 1e6));
+
+        std::vector<float> bins;
+        dsp::math::BinZoom resample;
+        gui::waterfall.replayHistory([&](int i, float* line) {
+            spectrum_log::LineInfo info;
+            if (!reader.readLine(last - i, info, bins)) { return false; }
+            mapLine(resample, info, bins, gui::waterfall.getRawFFTSize(), line);
+            return true;
+        });
+    }
+
+    void draw(void* ctx) {
+        float menuWidth = ImGui::GetContentRegionAvail().x;
+
+        if (recording) { style::beginDisabled(); }
+        if (folderSelect->render("##_sdrpp_spectrum_log_folder")) {
+            if (folderSelect->pathIsValid()) {
+                updatePath();
+                core::configManager.acquire();
+                core::configManager.conf["spectrumLogFolder"] = folderSelect->path;
+                core::configManager.release(true);
+            }
+        }
+        if (recording) { style::endDisabled(); }
+
+        bool canRecord = folderSelect->pathIsValid();
+        if (!canRecord) { style::beginDisabled(); }
+        bool record = recording;
+        if (ImGui::Checkbox("Record Spectrum##_sdrpp_spectrum_log", &record)) {
+            if (record) {
+                startRecording();
+            }
+            else {
+                stopRecording();
+            }
+            core::configManager.acquire();
+            core::configManager.conf["spectrumLogRecord"] = (bool)recording;
+            core::configManager.release(true);
+        }
+        if (!canRecord) { style::endDisabled(); }
+
+        if (recording) {
+            ImGui::Text("Lines: %llu, dropped: %llu", (unsigned long long)writer.getWrittenLines(), (unsigned long long)writer.getDroppedLines());
+        }
+
+        // Looking back re-reads the history once the slider is released
+        float maxLookBack = 0.0f;
+        if (!reader.isOpen() && !readerTried) {
+            readerTried = true;
+            if (std::filesystem::is_regular_file(logPath)) { reader.open(logPath); }
+        }
+        if (reader.isOpen()) {
+            reader.refresh();
+            maxLookBack = (float)(reader.getLastTime() - reader.getFirstTime()) / 1e6f;
+        }
+        ImGui::LeftLabel("Look Back");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        ImGui::SliderFloat("##_sdrpp_spectrum_log_look_back", &lookBack, 0.0f, std::max<float>(maxLookBack, 1.0f), "%.0f s");
+        if (ImGui::IsItemDeactivatedAfterEdit()) {
+            if (lookBack > 0.0f) {
+                replay();
+            }
+            else {
+                gui::waterfall.resumeLive();
+            }
+        }
+
+        if (gui::waterfall.isReplaying()) {
+            if (ImGui::Button("Back to Live##_sdrpp_spectrum_log", ImVec2(menuWidth, 0))) {
+                lookBack = 0.0f;
+                gui::waterfall.resumeLive();
+            }
+        }
+    }
+
+    void pushFFT(const float* data, int size) {
+        if (!recording || !data) { return; }
+        writer.push(data, size, gui::waterfall.getCenterFrequency(), gui::waterfall.getBandwidth());
+    }
+}
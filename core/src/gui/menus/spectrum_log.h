@@ -0,0 +1,9 @@
+#pragma once
+
+namespace spectrum_log_menu {
+    void init();
+    void draw(void* ctx);
+
+    // Log a raw FFT line if recording, called from the FFT thread
+    void pushFFT(const float* data, int size);
+}
@@ -62,33 +62,6 @@ inline void printAndScale(double freq, char* buf) {
     }
 }
 
-inline void doZoom(int offset, int width, int inSize, int outSize, float* in, float* out) {
-    // NOTE: REMOVE THAT SHIT, IT'S JUST A HACKY FIX
-    if (offset < 0) {
-        offset = 0;
-    }
-    if (width > 524288) {
-        width = 524288;
-    }
-
-    float factor = (float)width / (float)outSize;
-    float sFactor = ceilf(factor);
-    float uFactor;
-    float id = offset;
-    float maxVal;
-    int sId;
-    for (int i = 0; i < outSize; i++) {
-        maxVal = -INFINITY;
-        sId = (int)id;
-        uFactor = (sId + sFactor > inSize) ? sFactor - ((sId + sFactor) - inSize) : sFactor;
-        for (int j = 0; j < uFactor; j++) {
-            if (in[sId + j] > maxVal) { maxVal = in[sId + j]; }
-        }
-        out[i] = maxVal;
-        id += factor;
-    }
-}
-
 namespace ImGui {
     WaterFall::WaterFall() {
         fftMin = -70.0;
@@ -105,6 +78,7 @@ namespace ImGui {
         lastWidgetSize.y = 0;
         latestFFT = new float[dataWidth];
         latestFFTHold = new float[dataWidth];
+        zoomBuf = new float[dataWidth];
         waterfallFb = new uint32_t[1];
 
         viewBandwidth = 1.0;
@@ -115,6 +89,16 @@ namespace ImGui {
 
     void WaterFall::init() {
         glGenTextures(1, &textureId);
+
+        // Redrawing the whole history after a zoom is split over up to half the cores, each with its own zoom buffer.
+        // The threads are never stopped since the waterfall lives until the process exits.
+        std::lock_guard<std::recursive_mutex> lck(latestFFTMtx);
+        int threads = dsp::WorkerGroup::defaultThreadCount();
+        delete[] zoomBuf;
+        zoomBuf = new float[dataWidth * threads];
+        historyWorkers = new dsp::WorkerGroup();
+        historyWorkers->setThreadCount(threads);
+        historyThreads = threads;
     }
 
     void WaterFall::drawFFT() {
@@ -211,8 +195,10 @@ namespace ImGui {
             updateWaterfallTexture();
         }
         {
+            // Scroll the ring texture so that the newest line is at the top
             std::lock_guard<std::mutex> lck(texMtx);
-            window->DrawList->AddImage((void*)(intptr_t)textureId, wfMin, wfMax);
+            float top = (waterfallHeight > 0) ? ((float)fbTopRow / (float)waterfallHeight) : 0.0f;
+            window->DrawList->AddImage((void*)(intptr_t)textureId, wfMin, wfMax, ImVec2(0.0f, top), ImVec2(1.0f, top + 1.0f));
         }
         
         ImVec2 mPos = ImGui::GetMousePos();
@@ -492,7 +478,7 @@ namespace ImGui {
                         ImGui::Text("Bandwidth Locked: %s", _vfo->bandwidthLocked ? "Yes" : "No");
 
                         float strength, snr;
-                        if (calculateVFOSignalInfo(waterfallVisible ? &rawFFTs[currentFFTLine * rawFFTSize] : rawFFTs, _vfo, strength, snr)) {
+                        if (calculateVFOSignalInfo(rawFFT, _vfo, strength, snr)) {
                             ImGui::Text("Strength: %0.1fdBFS", strength);
                             ImGui::Text("SNR: %0.1fdB", snr);
                         }
@@ -568,28 +554,18 @@ namespace ImGui {
         int vfoMaxOffset = std::clamp<int>(((vfoMaxFreq / (wholeBandwidth / 2.0)) * (double)(rawFFTSize / 2)) + (rawFFTSize / 2), 0, rawFFTSize);
         int vfoMaxSideOffset = std::clamp<int>(((vfoMaxSizeFreq / (wholeBandwidth / 2.0)) * (double)(rawFFTSize / 2)) + (rawFFTSize / 2), 0, rawFFTSize);
 
-        double avg = 0;
-        float max = -INFINITY;
-        int avgCount = 0;
-
-        // Calculate Left average
-        for (int i = vfoMinSideOffset; i < vfoMinOffset; i++) {
-            avg += fftLine[i];
-            avgCount++;
-        }
-
-        // Calculate Right average
-        for (int i = vfoMaxOffset + 1; i < vfoMaxSideOffset; i++) {
-            avg += fftLine[i];
-            avgCount++;
+        // Both come from tables of the line built at most once per FFT, whatever the number of VFOs
+        if (signalStatsDirty || fftLine != signalStatsLine) {
+            signalStats.build(fftLine, rawFFTSize);
+            signalStatsLine = fftLine;
+            signalStatsDirty = false;
         }
 
+        // Average of both sides and max of the passband
+        int avgCount = std::max<int>(vfoMinOffset - vfoMinSideOffset, 0) + std::max<int>(vfoMaxSideOffset - (vfoMaxOffset + 1), 0);
+        double avg = signalStats.sum(vfoMinSideOffset, vfoMinOffset) + signalStats.sum(vfoMaxOffset + 1, vfoMaxSideOffset);
         avg /= (double)(avgCount);
-
-        // Calculate max
-        for (int i = vfoMinOffset; i <= vfoMaxOffset; i++) {
-            if (fftLine[i] > max) { max = fftLine[i]; }
-        }
+        float max = signalStats.max(vfoMinOffset, std::min<int>(vfoMaxOffset + 1, rawFFTSize));
 
         strength = max;
         snr = max - avg;
@@ -598,26 +574,31 @@ namespace ImGui {
     }
 
     void WaterFall::updateWaterfallFb() {
-        if (!waterfallVisible || rawFFTs == NULL) {
+        if (!waterfallVisible || rawFFT == NULL) {
             return;
         }
         double offsetRatio = viewOffset / (wholeBandwidth / 2.0);
         int drawDataSize;
         int drawDataStart;
-        // TODO: Maybe put on the stack for faster alloc?
-        float* tempData = new float[dataWidth];
-        float pixel;
-        float dataRange = waterfallMax - waterfallMin;
         int count = std::min<float>(waterfallHeight, fftLines);
-        if (rawFFTs != NULL && fftLines >= 0) {
-            for (int i = 0; i < count; i++) {
-                drawDataSize = (viewBandwidth / wholeBandwidth) * rawFFTSize;
-                drawDataStart = (((double)rawFFTSize / 2.0) * (offsetRatio + 1)) - (drawDataSize / 2);
-                doZoom(drawDataStart, drawDataSize, rawFFTSize, dataWidth, &rawFFTs[((i + currentFFTLine) % waterfallHeight) * rawFFTSize], tempData);
-                for (int j = 0; j < dataWidth; j++) {
-                    pixel = (std::clamp<float>(tempData[j], waterfallMin, waterfallMax) - waterfallMin) / dataRange;
-                    waterfallFb[(i * dataWidth) + j] = waterfallPallet[(int)(pixel * (WATERFALL_RESOLUTION - 1))];
+        if (fftLines >= 0) {
+            // Redraw the whole ring starting from its first row
+            std::lock_guard<std::mutex> lck(texMtx);
+            drawDataSize = (viewBandwidth / wholeBandwidth) * rawFFTSize;
+            drawDataStart = (((double)rawFFTSize / 2.0) * (offsetRatio + 1)) - (drawDataSize / 2);
+            int level = history.prepareZoom(historyZoom, drawDataStart, drawDataSize, dataWidth, zoomMode);
+            auto job = [&](int part) {
+                float* buf = &zoomBuf[part * dataWidth];
+                for (int i = (part * count) / historyThreads; i < ((part + 1) * count) / historyThreads; i++) {
+                    history.zoom(historyZoom, (i + currentFFTLine) % waterfallHeight, level, buf, zoomMode);
+                    drawWaterfallLine(buf, &waterfallFb[i * dataWidth]);
                 }
+            };
+            if (historyWorkers) {
+                historyWorkers->run(job);
+            }
+            else {
+                job(0);
             }
 
             for (int i = count; i < waterfallHeight; i++) {
@@ -625,11 +606,21 @@ namespace ImGui {
                     waterfallFb[(i * dataWidth) + j] = (uint32_t)255 << 24;
                 }
             }
+            fbTopRow = 0;
+            fullTextureUpload = true;
         }
-        delete[] tempData;
         waterfallUpdate = true;
     }
 
+    void WaterFall::drawWaterfallLine(const float* data, uint32_t* line) {
+        float pixel;
+        float dataRange = waterfallMax - waterfallMin;
+        for (int j = 0; j < dataWidth; j++) {
+            pixel = (std::clamp<float>(data[j], waterfallMin, waterfallMax) - waterfallMin) / dataRange;
+            line[j] = waterfallPallet[(int)(pixel * (WATERFALL_RESOLUTION - 1))];
+        }
+    }
+
     void WaterFall::drawBandPlan() {
         int count = bandplan->bands.size();
         double horizScale = (double)dataWidth / viewBandwidth;
@@ -706,8 +697,23 @@ namespace ImGui {
         glBindTexture(GL_TEXTURE_2D, textureId);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dataWidth, waterfallHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, (uint8_t*)waterfallFb);
+
+        // Only upload the new lines unless everything changed
+        if (fullTextureUpload || pendingRows >= waterfallHeight) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dataWidth, waterfallHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, (uint8_t*)waterfallFb);
+        }
+        else if (pendingRows) {
+            // The new lines go down from the top row and may wrap around the end of the ring
+            int end = std::min<int>(fbTopRow + pendingRows, waterfallHeight);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, fbTopRow, dataWidth, end - fbTopRow, GL_RGBA, GL_UNSIGNED_BYTE, (uint8_t*)&waterfallFb[fbTopRow * dataWidth]);
+            if (fbTopRow + pendingRows > waterfallHeight) {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, dataWidth, fbTopRow + pendingRows - waterfallHeight, GL_RGBA, GL_UNSIGNED_BYTE, (uint8_t*)waterfallFb);
+            }
+        }
+        fullTextureUpload = false;
+        pendingRows = 0;
     }
 
     void WaterFall::onPositionChange() {
@@ -738,21 +744,8 @@ namespace ImGui {
         if (waterfallVisible) {
             // Raw FFT resize
             fftLines = std::min<int>(fftLines, waterfallHeight) - 1;
-            if (rawFFTs != NULL) {
-                if (currentFFTLine != 0) {
-                    float* tempWF = new float[currentFFTLine * rawFFTSize];
-                    int moveCount = lastWaterfallHeight - currentFFTLine;
-                    memcpy(tempWF, rawFFTs, currentFFTLine * rawFFTSize * sizeof(float));
-                    memmove(rawFFTs, &rawFFTs[currentFFTLine * rawFFTSize], moveCount * rawFFTSize * sizeof(float));
-                    memcpy(&rawFFTs[moveCount * rawFFTSize], tempWF, currentFFTLine * rawFFTSize * sizeof(float));
-                    delete[] tempWF;
-                }
-                currentFFTLine = 0;
-                rawFFTs = (float*)realloc(rawFFTs, waterfallHeight * rawFFTSize * sizeof(float));
-            }
-            else {
-                rawFFTs = (float*)malloc(waterfallHeight * rawFFTSize * sizeof(float));
-            }
+            history.setLineCount(waterfallHeight, currentFFTLine);
+            currentFFTLine = 0;
             // ==============
         }
 
@@ -768,6 +761,12 @@ namespace ImGui {
         }
         latestFFTHold = new float[dataWidth];
 
+        // Reallocate zoom buffer
+        if (zoomBuf != NULL) {
+            delete[] zoomBuf;
+        }
+        zoomBuf = new float[dataWidth * historyThreads];
+
         // Reallocate smoothing buffer
         if (fftSmoothing) {
             if (smoothingBuf) { delete[] smoothingBuf; }
@@ -781,6 +780,9 @@ namespace ImGui {
             delete[] waterfallFb;
             waterfallFb = new uint32_t[dataWidth * waterfallHeight];
             memset(waterfallFb, 0, dataWidth * waterfallHeight * sizeof(uint32_t));
+            fbTopRow = 0;
+            pendingRows = 0;
+            fullTextureUpload = true;
         }
         for (int i = 0; i < dataWidth; i++) {
             latestFFT[i] = -1000.0f; // Hide everything
@@ -831,6 +833,8 @@ namespace ImGui {
             onResize();
         }
 
+        processFFTs();
+
         //window->DrawList->AddRectFilled(widgetPos, widgetEndPos, IM_COL32( 0, 0, 0, 255 ));
         ImU32 bg = ImGui::ColorConvertFloat4ToU32(gui::themeManager.waterfallBg);
         window->DrawList->AddRectFilled(widgetPos, widgetEndPos, bg);
@@ -874,71 +878,94 @@ namespace ImGui {
     }
 
     float* WaterFall::getFFTBuffer() {
-        if (rawFFTs == NULL) { return NULL; }
-        buf_mtx.lock();
-        if (waterfallVisible) {
-            currentFFTLine--;
-            fftLines++;
-            currentFFTLine = ((currentFFTLine + waterfallHeight) % waterfallHeight);
-            fftLines = std::min<float>(fftLines, waterfallHeight);
-            return &rawFFTs[currentFFTLine * rawFFTSize];
+        int size = rawFFTSize;
+        if (size <= 0) { return NULL; }
+
+        // When the GUI is behind the oldest queued FFTs make room for the new ones. A slot is only refused while the GUI
+        // is still copying it, the FFT is then still computed for the other users of the buffer and dropped.
+        writingFFT = fftQueue.beginWrite();
+        if (!writingFFT) {
+            if ((int)droppedFFT.size() < size) { droppedFFT.resize(size); }
+            return droppedFFT.data();
         }
-        return rawFFTs;
+        if ((int)writingFFT->data.size() < size) { writingFFT->data.resize(size); }
+        writingFFT->size = size;
+        return writingFFT->data.data();
     }
 
     void WaterFall::pushFFT() {
-        if (rawFFTs == NULL) { return; }
+        if (!writingFFT) { return; }
+        fftQueue.endWrite();
+        writingFFT = NULL;
+    }
+
+    uint64_t WaterFall::getDroppedFFTs() {
+        return fftQueue.getDropped();
+    }
+
+    // Called by draw() with buf_mtx held
+    void WaterFall::processFFTs() {
+        while (FFTFrame* frame = fftQueue.beginRead()) {
+            if (frame->size == rawFFTSize && rawFFT != NULL) {
+                memcpy(rawFFT, frame->data.data(), rawFFTSize * sizeof(float));
+                signalStatsDirty = true;
+                processFFT();
+            }
+            fftQueue.endRead();
+        }
+    }
+
+    void WaterFall::processFFT() {
         std::lock_guard<std::recursive_mutex> lck(latestFFTMtx);
         double offsetRatio = viewOffset / (wholeBandwidth / 2.0);
         int drawDataSize = (viewBandwidth / wholeBandwidth) * rawFFTSize;
         int drawDataStart = (((double)rawFFTSize / 2.0) * (offsetRatio + 1)) - (drawDataSize / 2);
 
-        if (waterfallVisible) {
-            doZoom(drawDataStart, drawDataSize, rawFFTSize, dataWidth, &rawFFTs[currentFFTLine * rawFFTSize], latestFFT);
-            memmove(&waterfallFb[dataWidth], waterfallFb, dataWidth * (waterfallHeight - 1) * sizeof(uint32_t));
-            float pixel;
-            float dataRange = waterfallMax - waterfallMin;
-            for (int j = 0; j < dataWidth; j++) {
-                pixel = (std::clamp<float>(latestFFT[j], waterfallMin, waterfallMax) - waterfallMin) / dataRange;
-                int id = (int)(pixel * (WATERFALL_RESOLUTION - 1));
-                waterfallFb[j] = waterfallPallet[id];
+        lineZoom.configure(drawDataStart, drawDataSize, rawFFTSize, dataWidth);
+        lineZoom.process(rawFFT, latestFFT, zoomMode);
+
+        if (waterfallVisible && !replaying) {
+            currentFFTLine--;
+            fftLines++;
+            currentFFTLine = ((currentFFTLine + waterfallHeight) % waterfallHeight);
+            fftLines = std::min<float>(fftLines, waterfallHeight);
+            history.write(currentFFTLine, rawFFT);
+
+            // Draw the new line above the previous one in the ring instead of moving the whole framebuffer down
+            if (waterfallHeight > 0) {
+                std::lock_guard<std::mutex> lck2(texMtx);
+                fbTopRow = (fbTopRow + waterfallHeight - 1) % waterfallHeight;
+                drawWaterfallLine(latestFFT, &waterfallFb[fbTopRow * dataWidth]);
+                pendingRows = std::min<int>(pendingRows + 1, waterfallHeight);
             }
             waterfallUpdate = true;
         }
-        else {
-            doZoom(drawDataStart, drawDataSize, rawFFTSize, dataWidth, rawFFTs, latestFFT);
+        else if (!waterfallVisible) {
             fftLines = 1;
         }
 
         // Apply smoothing if enabled
         if (fftSmoothing && latestFFT != NULL && smoothingBuf != NULL && fftLines != 0) {
             std::lock_guard<std::mutex> lck2(smoothingBufMtx);
-            volk_32f_s32f_multiply_32f(latestFFT, latestFFT, fftSmoothingAlpha, dataWidth);
-            volk_32f_s32f_multiply_32f(smoothingBuf, smoothingBuf, fftSmoothingBeta, dataWidth);
-            volk_32f_x2_add_32f(smoothingBuf, latestFFT, smoothingBuf, dataWidth);
-            memcpy(latestFFT, smoothingBuf, dataWidth * sizeof(float));
+            dsp::math::smooth(latestFFT, smoothingBuf, fftSmoothingAlpha, fftSmoothingBeta, dataWidth);
         }
 
         if (selectedVFO != "" && vfos.size() > 0) {
             float dummy;
             if (snrSmoothing) {
                 float newSNR = 0.0f;
-                calculateVFOSignalInfo(waterfallVisible ? &rawFFTs[currentFFTLine * rawFFTSize] : rawFFTs, vfos[selectedVFO], dummy, newSNR);
+                calculateVFOSignalInfo(rawFFT, vfos[selectedVFO], dummy, newSNR);
                 selectedVFOSNR = (snrSmoothingBeta*selectedVFOSNR) + (snrSmoothingAlpha*newSNR);
             }
             else {
-                calculateVFOSignalInfo(waterfallVisible ? &rawFFTs[currentFFTLine * rawFFTSize] : rawFFTs, vfos[selectedVFO], dummy, selectedVFOSNR);
+                calculateVFOSignalInfo(rawFFT, vfos[selectedVFO], dummy, selectedVFOSNR);
             }
         }
 
         // If FFT hold is enabled, update it
         if (fftHold && latestFFT != NULL && latestFFTHold != NULL && fftLines != 0) {
-            for (int i = 1; i < dataWidth; i++) {
-                latestFFTHold[i] = std::max<float>(latestFFT[i], latestFFTHold[i] - fftHoldSpeed);
-            }
+            dsp::math::hold(&latestFFT[1], &latestFFTHold[1], fftHoldSpeed, dataWidth - 1);
         }
-
-        buf_mtx.unlock();
     }
 
     void WaterFall::updatePallette(float colors[][3], int colorCount) {
@@ -1133,19 +1160,71 @@ namespace ImGui {
 
     void WaterFall::setRawFFTSize(int size) {
         std::lock_guard<std::recursive_mutex> lck(buf_mtx);
+        if (rawFFT != NULL) { delete[] rawFFT; }
+        rawFFT = new float[size];
+        memset(rawFFT, 0, size * sizeof(float));
+        signalStatsDirty = true;
+
+        // Resample the history to the new size instead of clearing the waterfall
+        int lines = waterfallVisible ? std::max<int>(fftLines, 0) : 0;
+        history.configure(history.getLineCount(), size, historyFormat, historyDecimation, historyMips, currentFFTLine, lines);
+        if (!lines) { fftLines = 0; }
         rawFFTSize = size;
-        int wfSize = std::max<int>(1, waterfallHeight);
-        if (rawFFTs != NULL) {
-            rawFFTs = (float*)realloc(rawFFTs, rawFFTSize * wfSize * sizeof(float));
-        }
-        else {
-            rawFFTs = (float*)malloc(rawFFTSize * wfSize * sizeof(float));
+        updateWaterfallFb();
+    }
+
+    int WaterFall::getRawFFTSize() {
+        return rawFFTSize;
+    }
+
+    void WaterFall::setZoomMode(dsp::math::ZoomMode mode) {
+        std::lock_guard<std::recursive_mutex> lck(buf_mtx);
+        zoomMode = mode;
+        updateWaterfallFb();
+    }
+
+    void WaterFall::setHistoryFormat(dsp::buffer::HistoryFormat format, int decimation, bool mips) {
+        std::lock_guard<std::recursive_mutex> lck(buf_mtx);
+        historyFormat = format;
+        historyDecimation = decimation;
+        historyMips = mips;
+        int lines = waterfallVisible ? std::max<int>(fftLines, 0) : 0;
+        history.configure(history.getLineCount(), rawFFTSize, historyFormat, historyDecimation, historyMips, currentFFTLine, lines);
+        updateWaterfallFb();
+    }
+
+    void WaterFall::replayHistory(const std::function<bool(int, float*)>& source) {
+        std::lock_guard<std::recursive_mutex> lck(buf_mtx);
+        if (!waterfallVisible || rawFFT == NULL) { return; }
+        replaying = true;
+
+        std::vector<float> line(rawFFTSize);
+        int count = 0;
+        for (; count < history.getLineCount(); count++) {
+            if (!source(count, line.data())) { break; }
+            history.write(count, line.data());
         }
+        currentFFTLine = 0;
+        fftLines = count;
+        updateWaterfallFb();
+    }
+
+    void WaterFall::resumeLive() {
+        std::lock_guard<std::recursive_mutex> lck(buf_mtx);
+        if (!replaying) { return; }
+        replaying = false;
+
+        // The live lines missed while replaying are gone
+        history.clear();
+        currentFFTLine = 0;
         fftLines = 0;
-        memset(rawFFTs, 0, rawFFTSize * waterfallHeight * sizeof(float));
         updateWaterfallFb();
     }
 
+    bool WaterFall::isReplaying() {
+        return replaying;
+    }
+
     void WaterFall::setBandPlanPos(int pos) {
         bandPlanPos = pos;
     }
@@ -1383,12 +1462,13 @@ namespace ImGui {
 
     void WaterFall::showWaterfall() {
         buf_mtx.lock();
-        if (rawFFTs == NULL) {
+        if (rawFFT == NULL) {
             flog::error("Null rawFFT");
         }
         waterfallVisible = true;
+        replaying = false;
         onResize();
-        memset(rawFFTs, 0, waterfallHeight * rawFFTSize * sizeof(float));
+        history.clear();
         updateWaterfallFb();
         buf_mtx.unlock();
     }
@@ -1,15 +1,24 @@
 #pragma once
 #include <vector>
 #include <mutex>
+#include <functional>
 #include <gui/widgets/bandplan.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
 #include <utils/event.h>
+#include <dsp/math/bin_zoom.h>
+#include <dsp/math/spectrum_stats.h>
+#include <dsp/buffer/spectrum_history.h>
+#include <dsp/buffer/spsc_ring.h>
+#include <dsp/worker_group.h>
 
 #include <utils/opengl_include_code.h>
 
 #define WATERFALL_RESOLUTION 1000000
 
+// FFTs that can be waiting for the GUI, any more are dropped
+#define WATERFALL_FFT_QUEUE  8
+
 namespace ImGui {
     class WaterfallVFO {
     public:
@@ -87,9 +96,13 @@ namespace ImGui {
         void init();
 
         void draw();
+        // Called by the FFT thread, never waits on the GUI. The FFT is processed by the next draw().
         float* getFFTBuffer();
         void pushFFT();
 
+        // FFTs dropped because the GUI didn't keep up
+        uint64_t getDroppedFFTs();
+
         void updatePallette(float colors[][3], int colorCount);
         void updatePalletteFromArray(float* colors, int colorCount);
 
@@ -134,9 +147,22 @@ namespace ImGui {
         int getFFTHeight();
 
         void setRawFFTSize(int size);
+        int getRawFFTSize();
 
         void setFullWaterfallUpdate(bool fullUpdate);
 
+        // How the FFT bins covered by one pixel are combined
+        void setZoomMode(dsp::math::ZoomMode mode);
+
+        // How the raw FFT history is stored, decimation is a power of two and mips add coarser copies for zooming out
+        void setHistoryFormat(dsp::buffer::HistoryFormat format, int decimation, bool mips);
+
+        // Freeze the waterfall and fill it with older lines, source(i, line) writing the i-th line before the newest
+        // at the raw FFT size and returning false once there are no more. New FFTs only update the FFT until resumeLive().
+        void replayHistory(const std::function<bool(int, float*)>& source);
+        void resumeLive();
+        bool isReplaying();
+
         void setBandPlanPos(int pos);
 
         void setFFTHold(bool hold);
@@ -228,6 +254,9 @@ namespace ImGui {
         void onResize();
         void updateWaterfallFb();
         void updateWaterfallTexture();
+        void drawWaterfallLine(const float* data, uint32_t* line);
+        void processFFTs();
+        void processFFT();
         void updateAllVFOs(bool checkRedrawRequired = false);
         bool calculateVFOSignalInfo(float* fftLine, WaterfallVFO* vfo, float& strength, float& snr);
 
@@ -281,16 +310,49 @@ namespace ImGui {
         float waterfallMin;
         float waterfallMax;
 
-        //std::vector<std::vector<float>> rawFFTs;
-        int rawFFTSize;
-        float* rawFFTs = NULL;
+        // The latest raw FFT is kept in full for the FFT and the SNR, older ones in the possibly compact history
+        int rawFFTSize = 0;
+        float* rawFFT = NULL;
+        dsp::buffer::SpectrumHistory history;
+        dsp::buffer::HistoryFormat historyFormat = dsp::buffer::HISTORY_FLOAT32;
+        int historyDecimation = 1;
+        bool historyMips = false;
+        bool replaying = false;
+
+        // FFTs go from the FFT thread to the GUI through a lock free queue, the raw FFT size only changes while the
+        // FFT thread is stopped and frames of another size are skipped
+        struct FFTFrame {
+            std::vector<float> data;
+            int size = 0;
+        };
+        dsp::buffer::SPSCRing<FFTFrame, WATERFALL_FFT_QUEUE> fftQueue;
+        FFTFrame* writingFFT = NULL;
+        std::vector<float> droppedFFT;
         float* latestFFT = NULL;
         float* latestFFTHold = NULL;
         float* smoothingBuf = NULL;
         int currentFFTLine = 0;
         int fftLines = 0;
 
+        // The framebuffer is a ring whose newest line is at fbTopRow, only the lines pushed since the last texture
+        // update are uploaded unless the whole framebuffer was redrawn
         uint32_t* waterfallFb;
+        float* zoomBuf = NULL;
+
+        // Bin tables of the new lines and of the history redraw, which is split between threads
+        dsp::math::BinZoom lineZoom;
+        dsp::math::BinZoom historyZoom;
+        dsp::math::ZoomMode zoomMode = dsp::math::ZOOM_MAX;
+
+        // Range sums and maxima of the raw FFT for the VFO signal info, rebuilt when it changes
+        dsp::math::SpectrumStats signalStats;
+        const float* signalStatsLine = NULL;
+        bool signalStatsDirty = true;
+        dsp::WorkerGroup* historyWorkers = NULL;
+        int historyThreads = 1;
+        int fbTopRow = 0;
+        int pendingRows = 0;
+        bool fullTextureUpload = true;
 
         bool draggingFW = false;
         int FFTAreaHeight;
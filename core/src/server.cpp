@@ -10,10 +10,19 @@
 #include <utils/optionlist.h>
 #include "dsp/compression/sample_stream_compressor.h"
 #include "dsp/sink/handler_sink.h"
+#include "dsp/routing/splitter.h"
+#include "dsp/buffer/reshaper.h"
+#include "dsp/fft/spectrum_engine.h"
+#include "dsp/fft/spectrum_averager.h"
+#include "dsp/math/bin_zoom.h"
+#include "dsp/compression/spectrum_row_encoder.h"
+#include "dsp/window/nuttall.h"
 #include <zstd.h>
 
 namespace server {
     dsp::stream<dsp::complex_t> dummyInput;
+    dsp::routing::Splitter<dsp::complex_t> split;
+    dsp::stream<dsp::complex_t> compIn;
     dsp::compression::SampleStreamCompressor comp;
     dsp::sink::Handler<uint8_t> hnd;
     net::Conn client;
@@ -45,18 +54,44 @@ namespace server {
     bool running = false;
     bool compression = false;
     double sampleRate = 1000000.0;
+    bool baseband = true;
+
+    // FFT branch, only bound to the splitter while a client wants FFT frames
+    std::mutex branchMtx;
+    dsp::stream<dsp::complex_t> fftIn;
+    dsp::buffer::Reshaper<dsp::complex_t> fftReshape;
+    dsp::sink::Handler<dsp::complex_t> fftSink;
+    dsp::fft::SpectrumEngine fftEngine;
+    dsp::fft::SpectrumAverager fftAverager;
+    dsp::math::BinZoom fftZoom;
+    dsp::compression::SpectrumRowEncoder fftEncoder;
+    std::vector<float> fftPower;
+    std::vector<float> fftRow;
+    std::vector<uint8_t> fftPacket;
+    FFTSettings fftSettings = {};
+    int fftFrameSize = 0;
+    int fftFrames = 1;
+    bool fftRunning = false;
 
     int main() {
         flog::info("=====| SERVER MODE |=====");
 
         // Init DSP
-        comp.init(&dummyInput, dsp::compression::PCM_TYPE_I8);
+        split.init(&dummyInput);
+        comp.init(&compIn, dsp::compression::PCM_TYPE_I8);
         hnd.init(&comp.out, _testServerHandler, NULL);
+        fftReshape.init(&fftIn, 1, 0);
+        fftSink.init(&fftReshape.out, _fftHandler, NULL);
+
+        // The compressor only reads the samples
+        split.bindStream(&compIn, true);
+
         rbuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
         sbuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
         bbuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
         comp.start();
         hnd.start();
+        split.start();
 
         // Initialize headers
         r_pkt_hdr = (PacketHeader*)rbuf;
@@ -192,6 +227,8 @@ namespace server {
         sigpath::sourceManager.stop();
         comp.setPCMType(dsp::compression::PCM_TYPE_I16);
         compression = false;
+        setBaseband(true);
+        setFFT({});
 
         sendSampleRate(sampleRate);
 
@@ -242,8 +279,85 @@ namespace server {
         if (client && client->isOpen()) { client->write(bb_pkt_hdr->size, bbuf); }
     }
 
+    void _fftHandler(dsp::complex_t* data, int count, void* ctx) {
+        // Average the consecutive frames of the block if asked to
+        for (int i = 0; i < fftFrames; i++) {
+            fftEngine.push(&data[i * fftFrameSize]);
+            fftEngine.transform();
+            if (fftFrames > 1) { fftAverager.add(fftEngine.getSpectrum(0)); }
+        }
+        if (fftFrames > 1) {
+            fftAverager.output(fftPower.data());
+        }
+        else {
+            fftEngine.power(0, fftPower.data());
+        }
+
+        // Reduce to the width asked by the client and encode the row
+        fftZoom.process(fftPower.data(), fftRow.data());
+        PacketHeader* hdr = (PacketHeader*)fftPacket.data();
+        hdr->type = PACKET_TYPE_FFT;
+        hdr->size = sizeof(PacketHeader) + fftEncoder.encode(fftRow.data(), fftRow.size(), (dsp::compression::SpectrumRowFormat)fftSettings.format, fftSettings.compression, &fftPacket[sizeof(PacketHeader)]);
+
+        // Write to network
+        if (client && client->isOpen()) { client->write(hdr->size, fftPacket.data()); }
+    }
+
     void setInput(dsp::stream<dsp::complex_t>* stream) {
-        comp.setInput(stream);
+        split.setInput(stream);
+    }
+
+    void setBaseband(bool enabled) {
+        std::lock_guard<std::mutex> lck(branchMtx);
+        if (enabled == baseband) { return; }
+        baseband = enabled;
+        if (baseband) {
+            split.bindStream(&compIn, true);
+        }
+        else {
+            split.unbindStream(&compIn);
+        }
+    }
+
+    void setFFT(FFTSettings settings) {
+        std::lock_guard<std::mutex> lck(branchMtx);
+        if (fftRunning) {
+            fftReshape.stop();
+            fftSink.stop();
+            split.unbindStream(&fftIn);
+            fftRunning = false;
+        }
+        fftSettings = settings;
+        if (!fftSettings.size) { return; }
+
+        // The frames averaged into a row are read in one block, the rate drops if there aren't enough samples for them
+        int size = fftSettings.size;
+        int interval = std::max<int>(round(sampleRate / fftSettings.rate), 1);
+        fftFrameSize = std::min<int>(interval, size);
+        fftFrames = std::clamp<int>(fftSettings.averaging, 1, STREAM_BUFFER_SIZE / fftFrameSize);
+        int keep = fftFrameSize * fftFrames;
+        int skip = std::max<int>(interval - keep, 0);
+
+        // Generate the window, alternating the sign to center the spectrum
+        fftEngine.configure(size, fftFrameSize, 1, dsp::fft::PLAN_ESTIMATE);
+        float* window = fftEngine.getWindow();
+        for (int i = 0; i < fftFrameSize; i++) {
+            window[i] = dsp::window::nuttall(i, fftFrameSize) * ((i % 2) ? -1.0f : 1.0f);
+        }
+        if (fftFrames > 1) { fftAverager.configure(size, fftFrames, dsp::fft::AVERAGING_LINEAR); }
+
+        int width = (fftSettings.width && (int)fftSettings.width < size) ? fftSettings.width : size;
+        fftZoom.configure(0, size, size, width);
+        fftPower.resize(size);
+        fftRow.resize(width);
+        fftPacket.resize(sizeof(PacketHeader) + dsp::compression::SpectrumRowEncoder::getMaxSize(width));
+
+        fftReshape.setKeep(keep);
+        fftReshape.setSkip(skip);
+        split.bindStream(&fftIn, true, dsp::routing::SPLITTER_POLICY_DROP);
+        fftReshape.start();
+        fftSink.start();
+        fftRunning = true;
     }
 
     void commandHandler(Command cmd, uint8_t* data, int len) {
@@ -298,6 +412,15 @@ namespace server {
         else if (cmd == COMMAND_SET_COMPRESSION && len == 1) {
             compression = *(uint8_t*)data;
         }
+        else if (cmd == COMMAND_SET_FFT && len == sizeof(FFTSettings)) {
+            FFTSettings* settings = (FFTSettings*)data;
+            bool valid = settings->rate > 0.0f && settings->rate <= SERVER_MAX_FFT_RATE && settings->averaging >= 1 && settings->format <= dsp::compression::SPECTRUM_ROW_UINT16;
+            if (settings->size && (settings->size > SERVER_MAX_FFT_SIZE || !valid)) { sendError(ERROR_INVALID_ARGUMENT); return; }
+            setFFT(*settings);
+        }
+        else if (cmd == COMMAND_SET_BASEBAND && len == 1) {
+            setBaseband(*(uint8_t*)data);
+        }
         else {
             flog::error("Invalid Command: {0} (len = {1})", (int)cmd, len);
             sendError(ERROR_INVALID_COMMAND);
@@ -365,6 +488,7 @@ namespace server {
 
     void setInputSampleRate(double samplerate) {
         sampleRate = samplerate;
+        if (fftSettings.size) { setFFT(fftSettings); }
         if (!client || !client->isOpen()) { return; }
         sendSampleRate(sampleRate);
     }
@@ -11,6 +11,7 @@ namespace server {
     void _clientHandler(net::Conn conn, void* ctx);
     void _packetHandler(int count, uint8_t* buf, void* ctx);
     void _testServerHandler(uint8_t* data, int count, void* ctx);
+    void _fftHandler(dsp::complex_t* data, int count, void* ctx);
 
     void drawMenu();
 
@@ -20,6 +21,8 @@ namespace server {
     void sendError(Error err);
     void sendSampleRate(double sampleRate);
     void setInputSampleRate(double samplerate);
+    void setBaseband(bool enabled);
+    void setFFT(FFTSettings settings);
 
     void sendPacket(PacketType type, int len);
     void sendCommand(Command cmd, int len);
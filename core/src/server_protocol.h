@@ -4,6 +4,8 @@
 #include <dsp/types.h>
 
 #define SERVER_MAX_PACKET_SIZE  (STREAM_BUFFER_SIZE * sizeof(dsp::complex_t) * 2)
+#define SERVER_MAX_FFT_SIZE     524288
+#define SERVER_MAX_FFT_RATE     200.0f
 
 namespace server {
     enum PacketType {
@@ -13,7 +15,7 @@ namespace server {
         PACKET_TYPE_BASEBAND,
         PACKET_TYPE_BASEBAND_COMPRESSED,
         PACKET_TYPE_VFO,
-        PACKET_TYPE_FFT,
+        PACKET_TYPE_FFT,            // A dsp::compression::SpectrumRowEncoder row
         PACKET_TYPE_ERROR
     };
 
@@ -27,6 +29,8 @@ namespace server {
         COMMAND_GET_SAMPLERATE,
         COMMAND_SET_SAMPLE_TYPE,
         COMMAND_SET_COMPRESSION,
+        COMMAND_SET_FFT,
+        COMMAND_SET_BASEBAND,
 
         // Server to client
         COMMAND_SET_SAMPLERATE = 0x80,
@@ -49,5 +53,17 @@ namespace server {
     struct CommandHeader {
         uint32_t cmd;
     };
+
+    // Argument of COMMAND_SET_FFT, FFT frames are computed by the server so that a client can show the spectrum
+    // without pulling the baseband, which COMMAND_SET_BASEBAND can then stop
+    // Only the server implements it, sdrpp_server_source doesn't send it
+    struct FFTSettings {
+        uint32_t size;          // FFT size, 0 stops the frames
+        float rate;             // Frames per second
+        uint32_t averaging;     // Consecutive spectra averaged into each frame
+        uint32_t width;         // Points per frame, the bins are max decimated to it. 0 sends every bin.
+        uint8_t format;         // dsp::compression::SpectrumRowFormat
+        uint8_t compression;    // zstd compress the frames
+    };
 #pragma pack(pop)
 }
\ No newline at end of file
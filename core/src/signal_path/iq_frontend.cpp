@@ -8,10 +8,6 @@
 IQFrontEnd::~IQFrontEnd() {
     if (!_init) { return; }
     stop();
-    dsp::buffer::free(fftWindowBuf);
-    fftwf_destroy_plan(fftwPlan);
-    fftwf_free(fftInBuf);
-    fftwf_free(fftOutBuf);
 }
 
 void IQFrontEnd::init(dsp::stream<dsp::complex_t>* in, double sampleRate, bool buffering, int decimRatio, bool dcBlocking, int fftSize, double fftRate, FFTWindow fftWindow, float* (*acquireFFTBuffer)(void* ctx), void (*releaseFFTBuffer)(void* ctx), void* fftCtx) {
@@ -29,6 +25,7 @@ void IQFrontEnd::init(dsp::stream<dsp::complex_t>* in, double sampleRate, bool b
     inBuf.init(in);
     inBuf.bypass = !buffering;
 
+    // The first decimation stage runs on a single thread, splitting it hasn't been shown to help yet
     decim.init(NULL, _decimRatio);
     dcBlock.init(NULL, genDCBlockRate(effectiveSr));
     conjugate.init(NULL);
@@ -38,33 +35,27 @@ void IQFrontEnd::init(dsp::stream<dsp::complex_t>* in, double sampleRate, bool b
     preproc.addBlock(&dcBlock, dcBlocking);
     preproc.addBlock(&conjugate, false); // TODO: Replace by parameter
 
+    // Run the whole pre-processing chain on a single thread
+    preproc.setFused(true, [](dsp::stream<dsp::complex_t>* out){});
+
     split.init(preproc.out);
 
     // TODO: Do something to avoid basically repeating this code twice
-    int skip;
-    genReshapeParams(effectiveSr, _fftSize, _fftRate, skip, _nzFFTSize);
-    reshape.init(&fftIn, fftSize, skip);
-    fftSink.init(&reshape.out, handler, this);
-
-    fftWindowBuf = dsp::buffer::alloc<float>(_nzFFTSize);
-    if (_fftWindow == FFTWindow::RECTANGULAR) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = 0; }
-    }
-    else if (_fftWindow == FFTWindow::BLACKMAN) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = dsp::window::blackman(i, _nzFFTSize); }
-    }
-    else if (_fftWindow == FFTWindow::NUTTALL) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = dsp::window::nuttall(i, _nzFFTSize); }
-    }
+    // Large FFTs are split over worker threads
+    fftWorkers.setThreadCount(dsp::WorkerGroup::defaultThreadCount());
+    for (auto& path : fftPaths) { path.engine.setWorkers(&fftWorkers); }
 
-    fftInBuf = (fftwf_complex*)fftwf_malloc(_fftSize * sizeof(fftwf_complex));
-    fftOutBuf = (fftwf_complex*)fftwf_malloc(_fftSize * sizeof(fftwf_complex));
-    fftwPlan = fftwf_plan_dft_1d(_fftSize, fftInBuf, fftOutBuf, FFTW_FORWARD, FFTW_ESTIMATE);
+    int keep, skip;
+    prepareFFTPath(fftPath, keep, skip);
+    reshape.init(&fftIn, keep, skip);
+    fftSink.init(&reshape.out, handler, this);
 
-    // Clear the rest of the FFT input buffer
-    dsp::buffer::clear(fftInBuf, _fftSize - _nzFFTSize, _nzFFTSize);
+    // The FFT only reads its input and can miss a buffer rather than hold back the VFOs
+    split.bindStream(&fftIn, true, dsp::routing::SPLITTER_POLICY_DROP);
 
-    split.bindStream(&fftIn);
+    // Only bound to the splitter once enabled
+    channelizer.init(&chanIn, 64, effectiveSr);
+    xlator.init(&xlatorIn);
 
     _init = true;
 }
@@ -84,6 +75,7 @@ void IQFrontEnd::setSampleRate(double sampleRate) {
     _sampleRate = sampleRate;
     effectiveSr = _sampleRate / _decimRatio;
     dcBlock.setRate(genDCBlockRate(effectiveSr));
+    updateChannelizer();
     for (auto& [name, vfo] : vfos) {
         vfo->setInSamplerate(effectiveSr);
     }
@@ -129,8 +121,8 @@ void IQFrontEnd::setInvertIQ(bool enabled) {
     preproc.setBlockEnabled(&conjugate, enabled, [=](dsp::stream<dsp::complex_t>* out){ split.setInput(out); });
 }
 
-void IQFrontEnd::bindIQStream(dsp::stream<dsp::complex_t>* stream) {
-    split.bindStream(stream);
+void IQFrontEnd::bindIQStream(dsp::stream<dsp::complex_t>* stream, bool shared) {
+    split.bindStream(stream, shared);
 }
 
 void IQFrontEnd::unbindIQStream(dsp::stream<dsp::complex_t>* stream) {
@@ -144,14 +136,13 @@ dsp::channel::RxVFO* IQFrontEnd::addVFO(std::string name, double sampleRate, dou
         return NULL;
     }
 
-    // Create VFO and its input stream
+    // Create VFO and its input stream, the VFO binds it to the splitter or the channelizer
     dsp::stream<dsp::complex_t>* vfoIn = new dsp::stream<dsp::complex_t>;
-    dsp::channel::RxVFO* vfo = new dsp::channel::RxVFO(vfoIn, effectiveSr, sampleRate, bandwidth, offset);
+    dsp::channel::ChannelizedVFO* vfo = new dsp::channel::ChannelizedVFO(vfoIn, &split, _channels ? &channelizer : NULL, effectiveSr, sampleRate, bandwidth, offset, _batchedXlation ? &xlator : NULL);
 
     // Register them
     vfoStreams[name] = vfoIn;
     vfos[name] = vfo;
-    bindIQStream(vfoIn);
 
     // Start VFO
     vfo->start();
@@ -168,20 +159,78 @@ void IQFrontEnd::removeVFO(std::string name) {
 
     // Remove the VFO and stream from registry
     dsp::stream<dsp::complex_t>* vfoIn = vfoStreams[name];
-    dsp::channel::RxVFO* vfo = vfos[name];
+    dsp::channel::ChannelizedVFO* vfo = vfos[name];
 
     // Stop the VFO
     vfo->stop();
 
-    unbindIQStream(vfoIn);
     vfoStreams.erase(name);
     vfos.erase(name);
 
-    // Delete the VFO and its input stream
+    // Delete the VFO (which unbinds its input) and its input stream
     delete vfo;
     delete vfoIn;
 }
 
+void IQFrontEnd::setChannelizer(double channelWidth) {
+    _channelWidth = channelWidth;
+    updateChannelizer();
+}
+
+void IQFrontEnd::updateChannelizer() {
+    // Only the reported frequencies change unless the channel count does
+    int channels = (_channelWidth > 0.0) ? genChannelCount(effectiveSr, _channelWidth) : 0;
+    channelizer.setSamplerate(effectiveSr);
+    if (channels == _channels) { return; }
+
+    // Move the VFOs to the full rate IQ while the channelizer is reconfigured
+    for (auto& [name, vfo] : vfos) {
+        vfo->setChannelizer(NULL);
+    }
+    if (_channels) {
+        channelizer.stop();
+        split.unbindStream(&chanIn);
+    }
+
+    _channels = channels;
+    if (!_channels) { return; }
+
+    // The channelizer only reads the IQ and must not drop any of it
+    channelizer.setChannelCount(_channels);
+    channelizer.setSamplerate(effectiveSr);
+    split.bindStream(&chanIn, true);
+    channelizer.start();
+
+    // Move the VFOs that fit in a channel to it
+    for (auto& [name, vfo] : vfos) {
+        vfo->setChannelizer(&channelizer);
+    }
+}
+
+void IQFrontEnd::setBatchedXlation(bool enabled) {
+    if (enabled == _batchedXlation) { return; }
+
+    // Move the VFOs back to their own translator while the shared one is unbound or bound
+    for (auto& [name, vfo] : vfos) {
+        vfo->setXlator(NULL);
+    }
+    if (_batchedXlation) {
+        xlator.stop();
+        split.unbindStream(&xlatorIn);
+    }
+
+    _batchedXlation = enabled;
+    if (!_batchedXlation) { return; }
+
+    // Like the channelizer, the xlator only reads the IQ and must not drop any of it
+    split.bindStream(&xlatorIn, true);
+    xlator.start();
+
+    for (auto& [name, vfo] : vfos) {
+        vfo->setXlator(&xlator);
+    }
+}
+
 void IQFrontEnd::setFFTSize(int size) {
     _fftSize = size;
     updateFFTPath(true);
@@ -197,6 +246,21 @@ void IQFrontEnd::setFFTWindow(FFTWindow fftWindow) {
     updateFFTPath();
 }
 
+void IQFrontEnd::setFFTPlanRigor(dsp::fft::PlanRigor rigor) {
+    _fftPlanRigor = rigor;
+    updateFFTPath();
+}
+
+void IQFrontEnd::setFFTAveraging(FFTAveraging averaging) {
+    _fftAveraging = averaging;
+    updateFFTPath();
+}
+
+void IQFrontEnd::setFFTOverlap(double overlap) {
+    _fftOverlap = std::clamp<double>(overlap, 0.0, 0.95);
+    updateFFTPath();
+}
+
 void IQFrontEnd::flushInputBuffer() {
     inBuf.flush();
 }
@@ -211,6 +275,10 @@ void IQFrontEnd::start() {
     // Start IQ splitter
     split.start();
 
+    // Start channelizer and shared xlator
+    if (_channels) { channelizer.start(); }
+    if (_batchedXlation) { xlator.start(); }
+
     // Start all VFOs
     for (auto& [name, vfo] : vfos) {
         vfo->start();
@@ -231,6 +299,10 @@ void IQFrontEnd::stop() {
     // Stop IQ splitter
     split.stop();
 
+    // Stop channelizer and shared xlator
+    channelizer.stop();
+    xlator.stop();
+
     // Stop all VFOs
     for (auto& [name, vfo] : vfos) {
         vfo->stop();
@@ -247,63 +319,89 @@ double IQFrontEnd::getEffectiveSamplerate() {
 
 void IQFrontEnd::handler(dsp::complex_t* data, int count, void* ctx) {
     IQFrontEnd* _this = (IQFrontEnd*)ctx;
+    FFTPath* path = _this->fftPath;
+    dsp::fft::SpectrumEngine& engine = path->engine;
+
+    if (!path->averaging) {
+        // Apply window, nothing more to do until the batch is complete
+        if (!engine.push(data)) { return; }
+
+        // Execute FFTs
+        engine.transform();
+
+        for (int i = 0; i < engine.getBatchSize(); i++) {
+            // Aquire buffer
+            float* fftBuf = _this->_acquireFFTBuffer(_this->_fftCtx);
 
-    // Apply window
-    volk_32fc_32f_multiply_32fc((lv_32fc_t*)_this->fftInBuf, (lv_32fc_t*)data, _this->fftWindowBuf, _this->_nzFFTSize);
+            // Convert the complex output of the FFT to dB amplitude
+            if (fftBuf) { engine.power(i, fftBuf); }
 
-    // Execute FFT
-    fftwf_execute(_this->fftwPlan);
+            // Release buffer
+            _this->_releaseFFTBuffer(_this->_fftCtx);
+        }
+        return;
+    }
 
-    // Aquire buffer
-    float* fftBuf = _this->_acquireFFTBuffer(_this->_fftCtx);
+    // Welch mode, run the FFT of every overlapping frame of the block and average their power
+    for (int i = 0; i < path->frames; i++) {
+        if (!engine.push(&data[i * path->hop]) && i < path->frames - 1) { continue; }
+        int transformed = engine.transform();
+        for (int j = 0; j < transformed; j++) {
+            if (!path->averager.add(engine.getSpectrum(j))) { continue; }
+            float* fftBuf = _this->_acquireFFTBuffer(_this->_fftCtx);
+            path->averager.output(fftBuf);
+            _this->_releaseFFTBuffer(_this->_fftCtx);
+        }
+    }
+}
 
-    // Convert the complex output of the FFT to dB amplitude
-    if (fftBuf) {
-        volk_32fc_s32f_power_spectrum_32f(fftBuf, (lv_32fc_t*)_this->fftOutBuf, _this->_fftSize, _this->_fftSize);
+void IQFrontEnd::prepareFFTPath(FFTPath* path, int& keep, int& skip) {
+    int nzSize;
+    path->averaging = (_fftAveraging != FFTAveraging::NONE);
+    if (path->averaging) {
+        genWelchParams(effectiveSr, _fftSize, _fftRate, _fftOverlap, keep, skip, nzSize, path->hop, path->frames);
+        path->averager.configure(_fftSize, path->frames, (_fftAveraging == FFTAveraging::EXPONENTIAL) ? dsp::fft::AVERAGING_EXPONENTIAL : dsp::fft::AVERAGING_LINEAR);
+    }
+    else {
+        genReshapeParams(effectiveSr, _fftSize, _fftRate, skip, nzSize);
+        keep = nzSize;
     }
 
-    // Release buffer
-    _this->_releaseFFTBuffer(_this->_fftCtx);
+    // Frames of a block are batched together in Welch mode
+    int batch = genFFTBatchSize(_fftSize, fftWorkers.getThreadCount());
+    if (path->averaging) { batch = std::min<int>(std::max<int>(batch, fftWorkers.getThreadCount()), path->frames); }
+    path->engine.configure(_fftSize, nzSize, batch, _fftPlanRigor);
+
+    // Generate the window, alternating the sign to center the spectrum
+    float* window = path->engine.getWindow();
+    for (int i = 0; i < nzSize; i++) {
+        float w = 1.0f;
+        if (_fftWindow == FFTWindow::BLACKMAN) { w = dsp::window::blackman(i, nzSize); }
+        else if (_fftWindow == FFTWindow::NUTTALL) { w = dsp::window::nuttall(i, nzSize); }
+        window[i] = w * ((i % 2) ? -1.0f : 1.0f);
+    }
 }
 
 void IQFrontEnd::updateFFTPath(bool updateWaterfall) {
+    std::lock_guard<std::mutex> lck(fftPathMtx);
+
+    // Prepare the new path while the FFT keeps running on the current one
+    int keep, skip;
+    prepareFFTPath(spareFFTPath, keep, skip);
+
     // Temp stop branch
     reshape.tempStop();
     fftSink.tempStop();
 
-    // Update reshaper settings
-    int skip;
-    genReshapeParams(effectiveSr, _fftSize, _fftRate, skip, _nzFFTSize);
-    reshape.setKeep(_nzFFTSize);
+    // Update reshaper settings and switch to the new path
+    reshape.setKeep(keep);
     reshape.setSkip(skip);
+    std::swap(fftPath, spareFFTPath);
 
-    // Update window
-    dsp::buffer::free(fftWindowBuf);
-    fftWindowBuf = dsp::buffer::alloc<float>(_nzFFTSize);
-    if (_fftWindow == FFTWindow::RECTANGULAR) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = 1.0f * ((i % 2) ? -1.0f : 1.0f); }
-    }
-    else if (_fftWindow == FFTWindow::BLACKMAN) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = dsp::window::blackman(i, _nzFFTSize) * ((i % 2) ? -1.0f : 1.0f); }
-    }
-    else if (_fftWindow == FFTWindow::NUTTALL) {
-        for (int i = 0; i < _nzFFTSize; i++) { fftWindowBuf[i] = dsp::window::nuttall(i, _nzFFTSize) * ((i % 2) ? -1.0f : 1.0f); }
-    }
-
-    // Update FFT plan
-    fftwf_free(fftInBuf);
-    fftwf_free(fftOutBuf);
-    fftInBuf = (fftwf_complex*)fftwf_malloc(_fftSize * sizeof(fftwf_complex));
-    fftOutBuf = (fftwf_complex*)fftwf_malloc(_fftSize * sizeof(fftwf_complex));
-    fftwPlan = fftwf_plan_dft_1d(_fftSize, fftInBuf, fftOutBuf, FFTW_FORWARD, FFTW_ESTIMATE);
-
-    // Clear the rest of the FFT input buffer
-    dsp::buffer::clear(fftInBuf, _fftSize - _nzFFTSize, _nzFFTSize);
-
-    // Update waterfall (TODO: This is annoying, it makes this module non testable and will constantly clear the waterfall for any reason)
+    // Update waterfall
     if (updateWaterfall) { gui::waterfall.setRawFFTSize(_fftSize); }
 
     // Restart branch
     reshape.tempStart();
     fftSink.tempStart();
-}
\ No newline at end of file
+}
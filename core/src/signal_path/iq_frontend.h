@@ -5,9 +5,11 @@
 #include "../dsp/correction/dc_blocker.h"
 #include "../dsp/chain.h"
 #include "../dsp/routing/splitter.h"
-#include "../dsp/channel/rx_vfo.h"
+#include "../dsp/channel/channelized_vfo.h"
 #include "../dsp/sink/handler_sink.h"
 #include "../dsp/math/conjugate.h"
+#include "../dsp/fft/spectrum_engine.h"
+#include "../dsp/fft/spectrum_averager.h"
 #include <fftw3.h>
 
 class IQFrontEnd {
@@ -20,6 +22,12 @@ public:
         NUTTALL
     };
 
+    enum FFTAveraging {
+        NONE,
+        LINEAR,
+        EXPONENTIAL
+    };
+
     void init(dsp::stream<dsp::complex_t>* in, double sampleRate, bool buffering, int decimRatio, bool dcBlocking, int fftSize, double fftRate, FFTWindow fftWindow, float* (*acquireFFTBuffer)(void* ctx), void (*releaseFFTBuffer)(void* ctx), void* fftCtx);
 
     void setInput(dsp::stream<dsp::complex_t>* in);
@@ -31,16 +39,35 @@ public:
     void setInvertIQ(bool enabled);
     void setDCBlocking(bool enabled);
 
-    void bindIQStream(dsp::stream<dsp::complex_t>* stream);
+    // Shared streams read the IQ without it being copied and must not be written to by their reader
+    void bindIQStream(dsp::stream<dsp::complex_t>* stream, bool shared = false);
     void unbindIQStream(dsp::stream<dsp::complex_t>* stream);
 
     dsp::channel::RxVFO* addVFO(std::string name, double sampleRate, double bandwidth, double offset);
     void removeVFO(std::string name);
 
+    // Serve the VFOs that fit in one channel from a filter bank with channels of the given width, 0 to disable
+    void setChannelizer(double channelWidth);
+    inline double getChannelWidth() { return _channelWidth; }
+
+    // Translate the full rate IQ for all VFOs not served by the channelizer in one pass instead of one per VFO
+    void setBatchedXlation(bool enabled);
+    inline bool getBatchedXlation() { return _batchedXlation; }
+
     void setFFTSize(int size);
     void setFFTRate(double rate);
     void setFFTWindow(FFTWindow fftWindow);
 
+    // Slower planning gives faster FFTs. Plans are measured in the background, cached and the wisdom saved so each size
+    // is only planned once
+    void setFFTPlanRigor(dsp::fft::PlanRigor rigor);
+    inline dsp::fft::PlanRigor getFFTPlanRigor() { return _fftPlanRigor; }
+
+    // Welch mode: instead of skipping the samples between two spectra, average the power of frames overlapping by the
+    // given ratio, from 0 to less than 1
+    void setFFTAveraging(FFTAveraging averaging);
+    void setFFTOverlap(double overlap);
+
     void flushInputBuffer();
 
     void start();
@@ -49,19 +76,52 @@ public:
     double getEffectiveSamplerate();
 
 protected:
+    // Spectrum engine and, in Welch mode, averaging of the frames read from each block of the reshaper
+    struct FFTPath {
+        dsp::fft::SpectrumEngine engine;
+        dsp::fft::SpectrumAverager averager;
+        bool averaging = false;
+        int hop = 0;
+        int frames = 1;
+    };
+
     static void handler(dsp::complex_t* data, int count, void* ctx);
+    void prepareFFTPath(FFTPath* path, int& keep, int& skip);
     void updateFFTPath(bool updateWaterfall = false);
+    void updateChannelizer();
 
     static inline double genDCBlockRate(double sampleRate) {
         return 50.0 / sampleRate;
     }
 
+    // The channel count must be even, the actual channel width is the closest that divides the samplerate
+    static inline int genChannelCount(double sampleRate, double channelWidth) {
+        return std::max<int>(2 * (int)round(sampleRate / (2.0 * channelWidth)), 2);
+    }
+
+    // Very large FFTs are batched so that the frames can be spread over the FFT threads
+    static inline int genFFTBatchSize(int size, int threads) {
+        return (size >= 262144) ? threads : 1;
+    }
+
     static inline void genReshapeParams(double sampleRate, int size, double rate, int& skip, int& nzSampCount) {
         int fftInterval = round(sampleRate / rate);
         nzSampCount = std::min<int>(fftInterval, size);
         skip = fftInterval - nzSampCount;
     }
 
+    // Overlapping frames are read in one block from the reshaper so that no sample is dropped between them. The block
+    // must fit in a stream buffer, at high samplerates and low rates the samples past it are skipped instead.
+    static inline void genWelchParams(double sampleRate, int size, double rate, double overlap, int& keep, int& skip, int& nzSampCount, int& hop, int& frames) {
+        int fftInterval = round(sampleRate / rate);
+        nzSampCount = std::min<int>(fftInterval, size);
+        hop = std::max<int>(round(nzSampCount * (1.0 - overlap)), 1);
+        int maxFrames = std::clamp<int>(1 + (STREAM_BUFFER_SIZE - nzSampCount) / hop, 1, 256);
+        frames = std::clamp<int>(1 + (fftInterval - nzSampCount) / hop, 1, maxFrames);
+        keep = nzSampCount + (frames - 1) * hop;
+        skip = fftInterval - keep;
+    }
+
     // Input buffer
     dsp::buffer::SampleFrameBuffer<dsp::complex_t> inBuf;
 
@@ -79,25 +139,40 @@ protected:
     dsp::buffer::Reshaper<dsp::complex_t> reshape;
     dsp::sink::Handler<dsp::complex_t> fftSink;
 
+    // Channelizer
+    dsp::stream<dsp::complex_t> chanIn;
+    dsp::channel::PFBChannelizer channelizer;
+
+    // Shared translator of the full rate VFOs
+    dsp::stream<dsp::complex_t> xlatorIn;
+    dsp::channel::MultiXlator xlator;
+
     // VFOs
     std::map<std::string, dsp::stream<dsp::complex_t>*> vfoStreams;
-    std::map<std::string, dsp::channel::RxVFO*> vfos;
+    std::map<std::string, dsp::channel::ChannelizedVFO*> vfos;
 
     // Parameters
     double _sampleRate;
     double _decimRatio;
     int _fftSize;
+    double _channelWidth = 0.0;
+    int _channels = 0;
+    bool _batchedXlation = false;
     double _fftRate;
     FFTWindow _fftWindow;
+    dsp::fft::PlanRigor _fftPlanRigor = dsp::fft::PLAN_ESTIMATE;
+    FFTAveraging _fftAveraging = FFTAveraging::NONE;
+    double _fftOverlap = 0.5;
     float* (*_acquireFFTBuffer)(void* ctx);
     void (*_releaseFFTBuffer)(void* ctx);
     void* _fftCtx;
 
-    // Processing data
-    int _nzFFTSize;
-    float* fftWindowBuf;
-    fftwf_complex *fftInBuf, *fftOutBuf;
-    fftwf_plan fftwPlan;
+    // Processing data, the spare FFT path is prepared while the handler keeps running the current one
+    dsp::WorkerGroup fftWorkers;
+    FFTPath fftPaths[2];
+    FFTPath* fftPath = &fftPaths[0];
+    FFTPath* spareFFTPath = &fftPaths[1];
+    std::mutex fftPathMtx;
     float* fftDbOut;
 
     double effectiveSr;
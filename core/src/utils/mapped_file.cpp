@@ -0,0 +1,110 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(std::string path) {
+    close();
+    _path = path;
+
+#ifdef _WIN32
+    // Allow another process or thread to keep writing to the file
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) { return false; }
+    file = h;
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+#endif
+
+    _open = true;
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::isOpen() {
+    return _open;
+}
+
+void MappedFile::close() {
+    if (!_open) { return; }
+    unmap();
+#ifdef _WIN32
+    CloseHandle((HANDLE)file);
+    file = NULL;
+#else
+    ::close(fd);
+    fd = -1;
+#endif
+    _open = false;
+}
+
+bool MappedFile::remap() {
+    if (!_open) { return false; }
+
+    // Only map again if the file grew
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx((HANDLE)file, &size) || (size_t)size.QuadPart <= _size) { return false; }
+#else
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size <= _size) { return false; }
+#endif
+
+    unmap();
+    return map();
+}
+
+bool MappedFile::map() {
+    // An empty file can't be mapped but is still valid
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx((HANDLE)file, &size)) { return false; }
+    if (!size.QuadPart) { return true; }
+    mapping = CreateFileMappingA((HANDLE)file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) { return false; }
+    void* ptr = MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ptr) {
+        CloseHandle((HANDLE)mapping);
+        mapping = NULL;
+        return false;
+    }
+    _data = (const uint8_t*)ptr;
+    _size = (size_t)size.QuadPart;
+#else
+    struct stat st;
+    if (fstat(fd, &st)) { return false; }
+    if (!st.st_size) { return true; }
+    void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) { return false; }
+    _data = (const uint8_t*)ptr;
+    _size = st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (!_data) { return; }
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle((HANDLE)mapping);
+    mapping = NULL;
+#else
+    munmap((void*)_data, _size);
+#endif
+    _data = NULL;
+    _size = 0;
+}
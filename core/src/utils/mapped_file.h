@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// Read only memory mapping of a whole file, the pages are only read from disk when they are accessed
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    bool open(std::string path);
+    bool isOpen();
+    void close();
+
+    // Map the file again if it grew since it was mapped. Pointers given by data() before are invalidated if it returns true.
+    bool remap();
+
+    inline const uint8_t* data() { return _data; }
+    inline size_t size() { return _size; }
+
+private:
+    bool map();
+    void unmap();
+
+    std::string _path;
+    bool _open = false;
+    const uint8_t* _data = NULL;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    void* file = NULL;
+    void* mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
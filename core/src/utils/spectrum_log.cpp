@@ -0,0 +1,395 @@
+#include "spectrum_log.h"
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <utils/flog.h>
+
+namespace spectrum_log {
+    const char* FILE_MAGIC      = "SDRPPSPL";
+    const char* CHUNK_ID        = "SPCK";
+    const uint32_t FILE_VERSION = 1;
+
+    // Bins are stored in hundredths of dB, the lowest value standing for -inf and NaN
+    const float BIN_SCALE       = 100.0f;
+    const int16_t BIN_NONE      = INT16_MIN;
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // === Writer ===
+
+    // Offset after the last whole chunk of a log, its header already checked
+    static uint64_t findEnd(std::ifstream& in, uint64_t size) {
+        uint64_t end = sizeof(FileHeader);
+        ChunkHeader hdr;
+        while (end + sizeof(ChunkHeader) <= size) {
+            in.seekg(end);
+            if (!in.read((char*)&hdr, sizeof(ChunkHeader)) || memcmp(hdr.id, CHUNK_ID, sizeof(hdr.id))) { break; }
+            if (end + sizeof(ChunkHeader) + hdr.size > size) { break; }
+            end += sizeof(ChunkHeader) + hdr.size;
+        }
+        return end;
+    }
+
+    Writer::~Writer() {
+        close();
+    }
+
+    bool Writer::open(std::string path) {
+        std::lock_guard<std::mutex> lck(openMtx);
+        if (file.is_open()) { return false; }
+
+        // Append to an existing log, a new one starts with the file header. Anything else is left alone.
+        std::error_code ec;
+        bool exists = std::filesystem::is_regular_file(path, ec) && std::filesystem::file_size(path, ec) > 0;
+        if (exists) {
+            FileHeader hdr;
+            std::ifstream in(path, std::ios::in | std::ios::binary);
+            if (!in.read((char*)&hdr, sizeof(FileHeader)) || memcmp(hdr.magic, FILE_MAGIC, sizeof(hdr.magic)) || hdr.version != FILE_VERSION) {
+                flog::error("{0} is not a spectrum log of a supported version, refusing to append to it", path);
+                return false;
+            }
+
+            // A chunk cut short by a crash would stop readers before the chunks appended after it, drop it
+            uint64_t size = std::filesystem::file_size(path, ec);
+            uint64_t end = findEnd(in, size);
+            in.close();
+            if (end < size) {
+                flog::warn("Dropping the last {0} bytes of {1}, they aren't a whole chunk", size - end, path);
+                std::filesystem::resize_file(path, end, ec);
+                if (ec) {
+                    flog::error("Could not truncate {0}: {1}", path, ec.message());
+                    return false;
+                }
+            }
+        }
+        file = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::app);
+        if (!file.is_open()) { return false; }
+        if (!exists) {
+            FileHeader hdr;
+            memcpy(hdr.magic, FILE_MAGIC, sizeof(hdr.magic));
+            hdr.version = FILE_VERSION;
+            hdr.reserved = 0;
+            file.write((char*)&hdr, sizeof(FileHeader));
+            file.flush();
+        }
+
+        chunkInfo.clear();
+        chunkBins.clear();
+        chunkBinCount = 0;
+        writtenLines = 0;
+        droppedLines = 0;
+        cctx = ZSTD_createCCtx();
+
+        // All queue slots are allocated here, their bins are only reallocated when the FFT size grows
+        {
+            std::lock_guard<std::mutex> lck2(queueMtx);
+            lines.resize(SPECTRUM_LOG_QUEUE_LINES);
+            freeLines.clear();
+            for (auto& l : lines) { freeLines.push_back(&l); }
+            queue.clear();
+            stopWorker = false;
+        }
+        workerThread = std::thread(&Writer::worker, this);
+        return true;
+    }
+
+    bool Writer::isOpen() {
+        std::lock_guard<std::mutex> lck(openMtx);
+        return file.is_open();
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::mutex> lck(openMtx);
+        if (!file.is_open()) { return; }
+
+        // Lines being copied are given back, the worker then writes what is left in the queue before exiting
+        {
+            std::unique_lock<std::mutex> lck2(queueMtx);
+            stopWorker = true;
+            queueCnd.notify_all();
+            queueCnd.wait(lck2, [this]() { return !pushing; });
+        }
+        if (workerThread.joinable()) { workerThread.join(); }
+        if (!chunkInfo.empty()) { writeChunk(); }
+
+        ZSTD_freeCCtx(cctx);
+        cctx = NULL;
+        file.close();
+    }
+
+    bool Writer::push(const float* bins, int binCount, double centerFreq, double bandwidth) {
+        QueuedLine* line;
+        {
+            std::lock_guard<std::mutex> lck(queueMtx);
+            if (stopWorker) { return false; }
+            if (freeLines.empty()) {
+                droppedLines++;
+                return false;
+            }
+            line = freeLines.back();
+            freeLines.pop_back();
+            pushing++;
+        }
+
+        // The slot belongs to the caller until it's queued
+        line->info.time = now();
+        line->info.centerFreq = centerFreq;
+        line->info.bandwidth = bandwidth;
+        if ((int)line->bins.size() < binCount) { line->bins.resize(binCount); }
+        memcpy(line->bins.data(), bins, binCount * sizeof(float));
+        line->bins.resize(binCount);
+
+        // The writer may have been closed meanwhile, the slot is then given back
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lck(queueMtx);
+            pushing--;
+            queued = !stopWorker;
+            if (queued) {
+                queue.push_back(line);
+            }
+            else {
+                freeLines.push_back(line);
+            }
+        }
+        queueCnd.notify_all();
+        return queued;
+    }
+
+    void Writer::worker() {
+        while (true) {
+            QueuedLine* line;
+            {
+                std::unique_lock<std::mutex> lck(queueMtx);
+                queueCnd.wait(lck, [this]() { return stopWorker || !queue.empty(); });
+                if (queue.empty()) { return; }
+                line = queue.front();
+                queue.pop_front();
+            }
+
+            addLine(*line);
+
+            {
+                std::lock_guard<std::mutex> lck(queueMtx);
+                freeLines.push_back(line);
+            }
+        }
+    }
+
+    void Writer::addLine(const QueuedLine& line) {
+        int binCount = line.bins.size();
+
+        // A chunk only holds lines of the same size
+        if (!chunkInfo.empty() && binCount != chunkBinCount) { writeChunk(); }
+        chunkBinCount = binCount;
+
+        chunkInfo.push_back(line.info);
+        size_t first = chunkBins.size();
+        chunkBins.resize(first + binCount);
+        int16_t* dst = &chunkBins[first];
+        for (int i = 0; i < binCount; i++) {
+            float v = line.bins[i] * BIN_SCALE;
+            dst[i] = (v > (float)INT16_MIN) ? (int16_t)std::min<float>(roundf(v), INT16_MAX) : BIN_NONE;
+        }
+
+        if (chunkInfo.size() >= SPECTRUM_LOG_CHUNK_LINES || line.info.time - chunkInfo[0].time >= SPECTRUM_LOG_CHUNK_TIME_US) {
+            writeChunk();
+        }
+    }
+
+    void Writer::writeChunk() {
+        // Payload is the line infos followed by the bins of all lines
+        size_t infoSize = chunkInfo.size() * sizeof(LineInfo);
+        size_t binsSize = chunkBins.size() * sizeof(int16_t);
+        rawBuf.resize(infoSize + binsSize);
+        memcpy(rawBuf.data(), chunkInfo.data(), infoSize);
+        memcpy(&rawBuf[infoSize], chunkBins.data(), binsSize);
+
+        compBuf.resize(ZSTD_compressBound(rawBuf.size()));
+        size_t compSize = ZSTD_compressCCtx(cctx, compBuf.data(), compBuf.size(), rawBuf.data(), rawBuf.size(), 1);
+        if (ZSTD_isError(compSize)) {
+            flog::error("Could not compress spectrum log chunk");
+        }
+        else {
+            ChunkHeader hdr;
+            memcpy(hdr.id, CHUNK_ID, sizeof(hdr.id));
+            hdr.size = compSize;
+            hdr.rawSize = rawBuf.size();
+            hdr.lineCount = chunkInfo.size();
+            hdr.binCount = chunkBinCount;
+            hdr.reserved = 0;
+            hdr.firstTime = chunkInfo.front().time;
+            hdr.lastTime = chunkInfo.back().time;
+
+            // Flushed right away so that readers of the log see the chunk
+            file.write((char*)&hdr, sizeof(ChunkHeader));
+            file.write((char*)compBuf.data(), compSize);
+            file.flush();
+            writtenLines += chunkInfo.size();
+        }
+
+        chunkInfo.clear();
+        chunkBins.clear();
+    }
+
+    // === Reader ===
+
+    Reader::~Reader() {
+        close();
+    }
+
+    bool Reader::open(std::string path) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        close();
+        if (!file.open(path)) { return false; }
+
+        // Check the file header
+        if (file.size() < sizeof(FileHeader) || memcmp(((const FileHeader*)file.data())->magic, FILE_MAGIC, 8)) {
+            flog::error("{0} is not a spectrum log", path);
+            file.close();
+            return false;
+        }
+
+        dctx = ZSTD_createDCtx();
+        scanned = sizeof(FileHeader);
+        refresh();
+        return true;
+    }
+
+    bool Reader::isOpen() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return file.isOpen();
+    }
+
+    void Reader::close() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+        file.close();
+        chunks.clear();
+        cache.clear();
+        cacheSize = 0;
+        ZSTD_freeDCtx(dctx);
+        dctx = NULL;
+    }
+
+    bool Reader::refresh() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return false; }
+        file.remap();
+
+        // Only the chunk headers are read, a chunk still being written is left for the next refresh
+        bool added = false;
+        while (scanned + sizeof(ChunkHeader) <= file.size()) {
+            const ChunkHeader* hdr = (const ChunkHeader*)&file.data()[scanned];
+            if (memcmp(hdr->id, CHUNK_ID, 4)) {
+                flog::error("Invalid spectrum log chunk at offset {0}", scanned);
+                break;
+            }
+            if (scanned + sizeof(ChunkHeader) + hdr->size > file.size()) { break; }
+
+            ChunkIndex ci;
+            ci.offset = scanned;
+            ci.firstLine = getLineCount();
+            ci.lineCount = hdr->lineCount;
+            ci.binCount = hdr->binCount;
+            ci.firstTime = hdr->firstTime;
+            ci.lastTime = hdr->lastTime;
+            chunks.push_back(ci);
+
+            scanned += sizeof(ChunkHeader) + hdr->size;
+            added = true;
+        }
+        return added;
+    }
+
+    int64_t Reader::getLineCount() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (chunks.empty()) { return 0; }
+        return chunks.back().firstLine + chunks.back().lineCount;
+    }
+
+    int64_t Reader::getFirstTime() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return chunks.empty() ? 0 : chunks.front().firstTime;
+    }
+
+    int64_t Reader::getLastTime() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return chunks.empty() ? 0 : chunks.back().lastTime;
+    }
+
+    int64_t Reader::findLine(int64_t time) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (chunks.empty()) { return 0; }
+
+        // Last chunk starting at or before the time
+        auto it = std::upper_bound(chunks.begin(), chunks.end(), time, [](int64_t t, const ChunkIndex& c) { return t < c.firstTime; });
+        if (it == chunks.begin()) { return 0; }
+        int id = std::distance(chunks.begin(), it) - 1;
+        const ChunkIndex& ci = chunks[id];
+        if (time >= ci.lastTime) { return ci.firstLine + ci.lineCount - 1; }
+
+        // Then the line within it
+        const CachedChunk* cc = load(id);
+        if (!cc) { return ci.firstLine; }
+        const LineInfo* infos = (const LineInfo*)cc->raw.data();
+        auto lit = std::upper_bound(infos, infos + ci.lineCount, time, [](int64_t t, const LineInfo& l) { return t < l.time; });
+        return ci.firstLine + std::max<int64_t>(std::distance(infos, lit) - 1, 0);
+    }
+
+    bool Reader::readLine(int64_t line, LineInfo& info, std::vector<float>& bins) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        int id = findChunk(line);
+        if (id < 0) { return false; }
+        const CachedChunk* cc = load(id);
+        if (!cc) { return false; }
+
+        const ChunkIndex& ci = chunks[id];
+        int l = line - ci.firstLine;
+        info = ((const LineInfo*)cc->raw.data())[l];
+        const int16_t* src = (const int16_t*)&cc->raw[ci.lineCount * sizeof(LineInfo)] + (size_t)l * ci.binCount;
+        bins.resize(ci.binCount);
+        for (int i = 0; i < ci.binCount; i++) {
+            bins[i] = (src[i] == BIN_NONE) ? -INFINITY : ((float)src[i] / BIN_SCALE);
+        }
+        return true;
+    }
+
+    int Reader::findChunk(int64_t line) {
+        if (line < 0 || line >= getLineCount()) { return -1; }
+        auto it = std::upper_bound(chunks.begin(), chunks.end(), line, [](int64_t l, const ChunkIndex& c) { return l < c.firstLine; });
+        return std::distance(chunks.begin(), it) - 1;
+    }
+
+    const Reader::CachedChunk* Reader::load(int id) {
+        // Most recently used chunks are at the front of the cache
+        for (auto it = cache.begin(); it != cache.end(); it++) {
+            if (it->id != id) { continue; }
+            cache.splice(cache.begin(), cache, it);
+            return &cache.front();
+        }
+
+        // Decompress it from the mapping, which is when its pages are read from disk
+        const ChunkHeader* hdr = (const ChunkHeader*)&file.data()[chunks[id].offset];
+        CachedChunk cc;
+        cc.id = id;
+        cc.raw.resize(hdr->rawSize);
+        size_t size = ZSTD_decompressDCtx(dctx, cc.raw.data(), cc.raw.size(), (const uint8_t*)hdr + sizeof(ChunkHeader), hdr->size);
+        if (ZSTD_isError(size) || size != hdr->rawSize || size < (size_t)hdr->lineCount * (sizeof(LineInfo) + hdr->binCount * sizeof(int16_t))) {
+            flog::error("Could not decompress spectrum log chunk {0}", id);
+            return NULL;
+        }
+
+        cacheSize += cc.raw.size();
+        cache.push_front(std::move(cc));
+        while (cacheSize > SPECTRUM_LOG_CACHE_SIZE && cache.size() > 1) {
+            cacheSize -= cache.back().raw.size();
+            cache.pop_back();
+        }
+        return &cache.front();
+    }
+}
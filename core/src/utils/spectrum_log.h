@@ -0,0 +1,158 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+#include <zstd.h>
+#include "mapped_file.h"
+
+// Lines waiting to be written, pushing more than that drops them
+#define SPECTRUM_LOG_QUEUE_LINES    256
+
+// A chunk is written once it has this many lines or spans this long
+#define SPECTRUM_LOG_CHUNK_LINES    64
+#define SPECTRUM_LOG_CHUNK_TIME_US  1000000
+
+// Bytes of decompressed chunks kept by a reader, the chunk last read is kept whatever its size
+#define SPECTRUM_LOG_CACHE_SIZE     (32 * 1024 * 1024)
+
+// Spectrum log files are a header followed by chunks of consecutive FFT lines of the same size. Each chunk is a
+// header giving its time span, followed by the zstd compressed info of its lines and their bins in hundredths of dB.
+namespace spectrum_log {
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+    };
+
+    struct ChunkHeader {
+        char id[4];
+        uint32_t size;          // Compressed size of the payload
+        uint32_t rawSize;
+        uint32_t lineCount;
+        uint32_t binCount;
+        uint32_t reserved;
+        int64_t firstTime;      // Microseconds since the epoch
+        int64_t lastTime;
+    };
+
+    struct LineInfo {
+        int64_t time;
+        double centerFreq;
+        double bandwidth;
+    };
+#pragma pack(pop)
+
+    // Current time in the unit of the log
+    int64_t now();
+
+    // Appends lines to a log from a thread of its own so that pushing a line never waits on the disk
+    class Writer {
+    public:
+        Writer() {}
+        ~Writer();
+
+        // Appends to the log if the file already is one, refuses any other existing file
+        bool open(std::string path);
+        bool isOpen();
+        void close();
+
+        // Copy a line to the queue, returns false if the queue is full and the line was dropped
+        bool push(const float* bins, int binCount, double centerFreq, double bandwidth);
+
+        inline uint64_t getWrittenLines() { return writtenLines; }
+        inline uint64_t getDroppedLines() { return droppedLines; }
+
+    private:
+        struct QueuedLine {
+            LineInfo info;
+            std::vector<float> bins;
+        };
+
+        void worker();
+        void addLine(const QueuedLine& line);
+        void writeChunk();
+
+        std::mutex openMtx;
+        std::ofstream file;
+        std::thread workerThread;
+
+        // Guards the queue and its slots, also waited on by close() for the lines still being copied
+        std::mutex queueMtx;
+        std::condition_variable queueCnd;
+        std::deque<QueuedLine*> queue;
+        std::vector<QueuedLine*> freeLines;
+        std::vector<QueuedLine> lines;
+        int pushing = 0;
+        bool stopWorker = true;
+
+        // Chunk being assembled by the worker
+        std::vector<LineInfo> chunkInfo;
+        std::vector<int16_t> chunkBins;
+        int chunkBinCount = 0;
+        std::vector<uint8_t> rawBuf;
+        std::vector<uint8_t> compBuf;
+        ZSTD_CCtx* cctx = NULL;
+
+        std::atomic<uint64_t> writtenLines = 0;
+        std::atomic<uint64_t> droppedLines = 0;
+    };
+
+    // Reads a log through a memory mapping, only decompressing the chunks that are asked for. The log can still be
+    // written to, refresh() indexes the chunks written since it was opened.
+    class Reader {
+    public:
+        Reader() {}
+        ~Reader();
+
+        bool open(std::string path);
+        bool isOpen();
+        void close();
+
+        // Index new chunks, returns true if there were any
+        bool refresh();
+
+        int64_t getLineCount();
+        int64_t getFirstTime();
+        int64_t getLastTime();
+
+        // Last line written at or before the time, the first line if there is none
+        int64_t findLine(int64_t time);
+
+        // Read a line in dB, bins is resized to its bin count
+        bool readLine(int64_t line, LineInfo& info, std::vector<float>& bins);
+
+    private:
+        struct ChunkIndex {
+            size_t offset;
+            int64_t firstLine;
+            int lineCount;
+            int binCount;
+            int64_t firstTime;
+            int64_t lastTime;
+        };
+
+        struct CachedChunk {
+            int id;
+            std::vector<uint8_t> raw;
+        };
+
+        int findChunk(int64_t line);
+        const CachedChunk* load(int id);
+
+        std::recursive_mutex mtx;
+        MappedFile file;
+        size_t scanned = 0;
+        std::vector<ChunkIndex> chunks;
+        std::list<CachedChunk> cache;
+        size_t cacheSize = 0;
+        ZSTD_DCtx* dctx = NULL;
+    };
+}
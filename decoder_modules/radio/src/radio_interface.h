@@ -9,6 +9,8 @@ enum {
     RADIO_IFACE_CMD_SET_SQUELCH_ENABLED,
     RADIO_IFACE_CMD_GET_SQUELCH_LEVEL,
     RADIO_IFACE_CMD_SET_SQUELCH_LEVEL,
+    RADIO_IFACE_CMD_GET_SQUELCH_GATING,
+    RADIO_IFACE_CMD_SET_SQUELCH_GATING,
 };
 
 enum {
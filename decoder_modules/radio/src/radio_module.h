@@ -9,6 +9,7 @@
 #include <dsp/noise_reduction/noise_blanker.h>
 #include <dsp/noise_reduction/fm_if.h>
 #include <dsp/noise_reduction/squelch.h>
+#include <dsp/routing/gap_filler.h>
 #include <dsp/multirate/rational_resampler.h>
 #include <dsp/filter/deephasis.h>
 #include <core.h>
@@ -57,6 +58,9 @@ public:
             created = true;
         }
         selectedDemodID = config.conf[name]["selectedDemodId"];
+        if (config.conf[name].contains("squelchGating")) {
+            squelchGating = config.conf[name]["squelchGating"];
+        }
         config.release(created);
 
         // Initialize the VFO
@@ -73,6 +77,8 @@ public:
         nb.init(NULL, 500.0 / 24000.0, 10.0);
         fmnr.init(NULL, 32);
         squelch.init(NULL, MIN_SQUELCH);
+        squelch.setGating(squelchGating);
+        squelch.setClosedHandler(squelchClosedHandler, this);
 
         ifChain.addBlock(&nb, false);
         ifChain.addBlock(&squelch, false);
@@ -87,10 +93,13 @@ public:
         afChain.addBlock(&resamp, true);
         afChain.addBlock(&deemp, false);
 
+        // Initialize the gap filler, it feeds the sink with silence while the squelch gates the chains
+        gapFiller.init(afChain.out);
+
         // Initialize the sink
         srChangeHandler.ctx = this;
         srChangeHandler.handler = sampleRateChangeHandler;
-        stream.init(afChain.out, &srChangeHandler, audioSampleRate);
+        stream.init(&gapFiller.out, &srChangeHandler, audioSampleRate);
         sigpath::sinkManager.registerStream(name, &stream);
 
         // Select the demodulator
@@ -101,6 +110,7 @@ public:
 
         // Start AF chain
         afChain.start();
+        gapFiller.start();
 
         // Start stream, the rest was started when selecting the demodulator
         stream.start();
@@ -134,6 +144,7 @@ public:
         ifChain.start();
         selectDemodByID((DemodID)selectedDemodID);
         afChain.start();
+        gapFiller.start();
     }
 
     void disable() {
@@ -141,6 +152,7 @@ public:
         ifChain.stop();
         if (selectedDemod) { selectedDemod->stop(); }
         afChain.stop();
+        gapFiller.stop();
         if (vfo) { sigpath::vfoManager.deleteVFO(vfo); }
         vfo = NULL;
     }
@@ -258,6 +270,9 @@ private:
         if (ImGui::SliderFloat(("##_radio_sqelch_lvl_" + _this->name).c_str(), &_this->squelchLevel, _this->MIN_SQUELCH, _this->MAX_SQUELCH, "%.3fdB")) {
             _this->setSquelchLevel(_this->squelchLevel);
         }
+        if (ImGui::Checkbox(("Sleep while closed##_radio_sqelch_gate_" + _this->name).c_str(), &_this->squelchGating)) {
+            _this->setSquelchGating(_this->squelchGating);
+        }
         if (!_this->squelchEnabled && _this->enabled) { style::endDisabled(); }
 
         // FM IF Noise Reduction
@@ -338,7 +353,7 @@ private:
 
     void selectDemod(demod::Demodulator* demod) {
         // Stopcurrently selected demodulator and select new
-        afChain.setInput(&dummyAudioStream, [=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
+        afChain.setInput(&dummyAudioStream, [=](dsp::stream<dsp::stereo_t>* out){ gapFiller.setInput(out); });
         if (selectedDemod) {
             selectedDemod->stop();
             delete selectedDemod;
@@ -352,7 +367,7 @@ private:
         selectedDemod->setInput(ifChain.out);
 
         // Set AF chain's input
-        afChain.setInput(selectedDemod->getOutput(), [=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
+        afChain.setInput(selectedDemod->getOutput(), [=](dsp::stream<dsp::stereo_t>* out){ gapFiller.setInput(out); });
 
         // Load config
         bandwidth = selectedDemod->getDefaultBandwidth();
@@ -443,16 +458,19 @@ private:
             afChain.stop();
             resamp.setInSamplerate(selectedDemod->getAFSampleRate());
             setAudioSampleRate(audioSampleRate);
-            afChain.enableBlock(&resamp, [=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
+            afChain.enableBlock(&resamp, [=](dsp::stream<dsp::stereo_t>* out){ gapFiller.setInput(out); });
 
             // Configure deemphasis
             setDeemphasisMode(deempModes[deempId]);
         }
         else {
             // Disable everything if post processing is disabled
-            afChain.disableAllBlocks([=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
+            afChain.disableAllBlocks([=](dsp::stream<dsp::stereo_t>* out){ gapFiller.setInput(out); });
         }
 
+        // Match the silence given to the sink while the squelch is closed to the new rates
+        updateSilenceRatio();
+
         // Start new demodulator
         selectedDemod->start();
     }
@@ -481,6 +499,7 @@ private:
             bandwidth = selectedDemod->getIFSampleRate();
             vfo->setBandwidthLimits(minBandwidth, maxBandwidth, selectedDemod->getBandwidthLocked());
             vfo->setSampleRate(selectedDemod->getIFSampleRate(), bandwidth);
+            updateSilenceRatio();
             return;
         }
 
@@ -493,6 +512,13 @@ private:
         deemp.setSamplerate(audioSampleRate);
 
         afChain.start();
+        updateSilenceRatio();
+    }
+
+    void updateSilenceRatio() {
+        if (!selectedDemod) { return; }
+        double outSamplerate = postProcEnabled ? audioSampleRate : selectedDemod->getAFSampleRate();
+        silenceRatio = outSamplerate / selectedDemod->getIFSampleRate();
     }
 
     void setDeemphasisMode(DeemphasisMode mode) {
@@ -500,7 +526,7 @@ private:
         if (!postProcEnabled || !selectedDemod) { return; }
         bool deempEnabled = (mode != DEEMP_MODE_NONE);
         if (deempEnabled) { deemp.setTau(deempTaus[mode]); }
-        afChain.setBlockEnabled(&deemp, deempEnabled, [=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
+        afChain.setBlockEnabled(&deemp, deempEnabled, [=](dsp::stream<dsp::stereo_t>* out){ gapFiller.setInput(out); });
 
         // Save config
         config.acquire();
@@ -550,6 +576,16 @@ private:
         config.release(true);
     }
 
+    void setSquelchGating(bool enable) {
+        squelchGating = enable;
+        squelch.setGating(squelchGating);
+
+        // Save config
+        config.acquire();
+        config.conf[name]["squelchGating"] = squelchGating;
+        config.release(true);
+    }
+
     void setFMIFNREnabled(bool enabled) {
         FMIFNREnabled = enabled;
         if (!selectedDemod) { return; }
@@ -589,6 +625,16 @@ private:
         _this->setAudioSampleRate(sampleRate);
     }
 
+    static void squelchClosedHandler(int count, void* ctx) {
+        RadioModule* _this = (RadioModule*)ctx;
+
+        // Give the sink as much silence as the demodulator and AF chain would have output for the held back samples
+        _this->silencePhase += (double)count * _this->silenceRatio;
+        int silence = (int)_this->silencePhase;
+        _this->silencePhase -= (double)silence;
+        _this->gapFiller.fill(silence);
+    }
+
     static void ifChainOutputChangeHandler(dsp::stream<dsp::complex_t>* output, void* ctx) {
         RadioModule* _this = (RadioModule*)ctx;
         if (!_this->selectedDemod) { return; }
@@ -635,6 +681,14 @@ private:
             float* _in = (float*)in;
             _this->setSquelchLevel(*_in);
         }
+        else if (code == RADIO_IFACE_CMD_GET_SQUELCH_GATING && out) {
+            bool* _out = (bool*)out;
+            *_out = _this->squelchGating;
+        }
+        else if (code == RADIO_IFACE_CMD_SET_SQUELCH_GATING && in && _this->enabled) {
+            bool* _in = (bool*)in;
+            _this->setSquelchGating(*_in);
+        }
         else {
             return;
         }
@@ -663,6 +717,11 @@ private:
     dsp::multirate::RationalResampler<dsp::stereo_t> resamp;
     dsp::filter::Deemphasis<dsp::stereo_t> deemp;
 
+    // Output, fed with silence while the squelch gates the chains
+    dsp::routing::GapFiller<dsp::stereo_t> gapFiller;
+    std::atomic<double> silenceRatio = 0.0;
+    double silencePhase = 0.0;
+
     SinkManager::Stream stream;
 
     demod::Demodulator* selectedDemod = NULL;
@@ -680,6 +739,7 @@ private:
     bool postProcEnabled;
 
     bool squelchEnabled = false;
+    bool squelchGating = false;
     float squelchLevel;
 
     int deempId = 0;